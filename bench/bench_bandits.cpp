@@ -0,0 +1,65 @@
+#include <format>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "rng.hpp"
+#include "ucb.hpp"
+
+namespace {
+
+struct BernoulliReward {
+  RNG rng;
+  std::vector<double> means;
+
+  [[nodiscard]] auto operator()(int i) -> double {
+    return std::bernoulli_distribution(means[i])(rng) ? 1.0 : 0.0;
+  }
+};
+
+[[nodiscard]] auto evenly_spaced(int n) -> std::vector<double> {
+  std::vector<double> means(n);
+  for (int i = 0; i < n; i++) {
+    means[i] = (i + 1.0) / (n + 1.0);
+  }
+  return means;
+}
+
+[[nodiscard]] auto make_ucb(BernoulliReward& reward, int n) {
+  std::vector<LILConfidenceBoundTracker> trackers(
+      n, LILConfidenceBoundTracker(0.03, 0.01 / n, 0.5));
+  return UCB(n, 3.0, 0.05, reward, std::move(trackers));
+}
+
+}  // namespace
+
+TEST_CASE("Confidence bound updates", "[bench][bandits]") {
+  LILConfidenceBoundTracker tracker(0.03, 1e-3, 0.5);
+  RNG rng(1);
+  std::uniform_real_distribution<double> reward(0.0, 1.0);
+
+  BENCHMARK("LILConfidenceBoundTracker add_sample + ucb") {
+    tracker.add_sample(reward(rng));
+    return tracker.ucb();
+  };
+}
+
+// A fresh bandit per iteration, so every call identifies from scratch
+TEST_CASE("Best-arm identification", "[bench][bandits]") {
+  for (auto n : {10, 100}) {
+    BernoulliReward reward{RNG(2), evenly_spaced(n)};
+
+    BENCHMARK_ADVANCED(std::format("UCB best_arm, {} Bernoulli arms", n))
+    (Catch::Benchmark::Chronometer meter) {
+      std::vector<decltype(make_ucb(reward, n))> bandits;
+      bandits.reserve(meter.runs());
+      for (int i = 0; i < meter.runs(); i++) {
+        bandits.push_back(make_ucb(reward, n));
+      }
+      meter.measure([&](int i) { return bandits[i].best_arm(); });
+    };
+  }
+}
@@ -0,0 +1,175 @@
+#include <format>
+#include <span>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "bench_graphs.hpp"
+#include "compressed_graph.hpp"
+#include "diffusion.hpp"
+#include "graph.hpp"
+#include "profiles.hpp"
+#include "reorder.hpp"
+#include "world.hpp"
+
+namespace {
+
+// Edges probed per cascade from the origins 0, 1, ... in turn, which turns
+// the mean time per cascade into edges/s
+auto edges_per_sample(const Graph& g, DiffusionType type) -> double {
+  constexpr int samples = 1000;
+  DiffusionSolver solver(g, 2);
+  for (int i = 0; i < samples; i++) {
+    std::ignore = solver.run(type, {i % g.n});
+  }
+  return static_cast<double>(solver.probes) / samples;
+}
+
+// g's topology under its own probabilities scaled by 1, 0.95, 0.9, ...
+auto scaled_profiles(const Graph& g, int profiles) -> ProfileGraph {
+  ProfileGraph scaled;
+  scaled.graph = g;
+  for (int p = 0; p < profiles; p++) {
+    scaled.names.push_back(std::format("{:.2f}", 1 - 0.05 * p));
+  }
+  size_t m = 0;
+  for (int u = 0; u < g.n; u++) {
+    scaled.first_edge.push_back(m);
+    m += g[u].size();
+    for (const auto& e : g[u]) {
+      for (int p = 0; p < profiles; p++) {
+        scaled.weights.push_back(e.weight * (1 - 0.05 * p));
+      }
+    }
+  }
+  scaled.first_edge.push_back(m);
+  return scaled;
+}
+
+}  // namespace
+
+// One cascade per iteration: samples/s = 1 / mean
+TEST_CASE("Diffusion throughput", "[bench][diffusion]") {
+  for (const auto& [name, g] : bench::bench_graphs()) {
+    DiffusionSolver solver(g, 1);
+    int origin = 0;
+
+    auto ic = std::format(
+        "IC {} ({:.1f} edges/sample)", name,
+        edges_per_sample(g, DiffusionType::IndependentCascade));
+    BENCHMARK(ic) {
+      origin = (origin + 1) % g.n;
+      return solver.run_independent_cascade({origin});
+    };
+
+    auto lt =
+        std::format("LT {} ({:.1f} edges/sample)", name,
+                    edges_per_sample(g, DiffusionType::LinearThreshold));
+    BENCHMARK(lt) {
+      origin = (origin + 1) % g.n;
+      return solver.run_linear_threshold({origin});
+    };
+  }
+}
+
+// One live-edge world per iteration, with the gains of all vertices
+TEST_CASE("Live-edge world throughput", "[bench][diffusion]") {
+  for (const auto& [name, g] : bench::bench_graphs()) {
+    LiveEdgeWorld world(g);
+    RNG rng(3);
+    std::vector<int> arms(g.n);
+    for (int i = 0; i < g.n; i++) {
+      arms[i] = i;
+    }
+    std::vector<double> gains(g.n);
+
+    BENCHMARK(std::format("IC world {} ({} edges)", name, g.m)) {
+      world.sample(rng, DiffusionType::IndependentCascade, {});
+      world.gains(arms, gains);
+      return gains[0];
+    };
+  }
+}
+
+// The same cascades, from the same input vertices, on relabelled copies
+TEST_CASE("Diffusion throughput by vertex order", "[bench][diffusion]") {
+  for (const auto& [name, g] : bench::bench_graphs()) {
+    for (auto [order, label] : {std::pair{VertexOrder::Original, "none"},
+                                std::pair{VertexOrder::Degree, "degree"},
+                                std::pair{VertexOrder::Rcm, "rcm"}}) {
+      auto permutation = im::vertex_order(g, order);
+      auto reordered = im::reorder_graph(g, permutation);
+      DiffusionSolver solver(reordered, 1);
+      int origin = 0;
+
+      BENCHMARK(std::format("IC {} ordered by {}", name, label)) {
+        origin = (origin + 1) % g.n;
+        return solver.run_independent_cascade(
+            {permutation.to_graph[origin]});
+      };
+    }
+  }
+}
+
+// Cascades decoding the edges on the fly, against the same edge order stored
+TEST_CASE("Diffusion throughput on compressed graphs", "[bench][diffusion]") {
+  for (const auto& [name, g] : bench::bench_graphs()) {
+    auto compressed = im::compress_graph(g);
+    auto sorted = compressed.decompress();
+    auto ratio = static_cast<double>(im::graph_memory_bytes(sorted)) /
+                 static_cast<double>(compressed.memory_bytes());
+    int origin = 0;
+
+    DiffusionSolver plain(sorted, 1);
+    BENCHMARK(std::format("IC {} adjacency lists", name)) {
+      origin = (origin + 1) % g.n;
+      return plain.run_independent_cascade({origin});
+    };
+
+    BasicDiffusionSolver solver(compressed, 1);
+    BENCHMARK(std::format("IC {} compressed ({:.1f}x smaller)", name, ratio)) {
+      origin = (origin + 1) % g.n;
+      return solver.run_independent_cascade({origin});
+    };
+  }
+}
+
+// A seed set under 4 profiles: one traversal for all of them, against one
+// cascade per profile
+TEST_CASE("Diffusion throughput under several profiles", "[bench][diffusion]") {
+  constexpr int profiles = 4;
+  for (const auto& [name, g] : bench::bench_graphs()) {
+    auto scaled = scaled_profiles(g, profiles);
+    int origin = 0;
+
+    MultiProfileSolver multi(scaled, 1);
+    std::vector<double> sizes(profiles);
+    BENCHMARK(std::format("IC {} {} profiles in one pass", name, profiles)) {
+      origin = (origin + 1) % g.n;
+      multi.run(DiffusionType::IndependentCascade, std::span(&origin, 1),
+                sizes);
+      return sizes[0];
+    };
+
+    std::vector<ProfileGraph::View> views;
+    for (size_t p = 0; p < profiles; p++) {
+      views.push_back(scaled.profile(p));
+    }
+    std::vector<BasicDiffusionSolver<ProfileGraph::View>> solvers;
+    for (const auto& view : views) {
+      solvers.emplace_back(view, 1);
+    }
+    BENCHMARK(std::format("IC {} {} profiles one by one", name, profiles)) {
+      origin = (origin + 1) % g.n;
+      double total = 0;
+      for (auto& solver : solvers) {
+        total += solver.run_independent_cascade({origin});
+      }
+      return total;
+    };
+  }
+}
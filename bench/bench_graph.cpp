@@ -0,0 +1,33 @@
+#include <format>
+#include <sstream>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "bench_graphs.hpp"
+#include "generate.hpp"
+#include "graph.hpp"
+
+TEST_CASE("Graph loading", "[bench][graph]") {
+  for (auto name : {"karate", "congress"}) {
+    auto path = bench::dataset_path(name);
+    BENCHMARK(std::format("load {}", name)) {
+      return load_graph_expected(path);
+    };
+  }
+
+  // parsed from memory, without the file system
+  std::ostringstream synthetic;
+  im::write_generated_graph(synthetic, bench::synthetic_options(), {});
+  auto text = synthetic.str();
+  BENCHMARK("parse synthetic-1e5") { return load_graph_expected(text); };
+
+  // the same graph in the binary format bandit-im-prep writes
+  std::ostringstream binary;
+  im::write_binary_graph(binary, load_graph(text));
+  auto bytes = binary.str();
+  BENCHMARK("parse binary synthetic-1e5") {
+    std::istringstream is(bytes);
+    return im::parse_binary_graph(is);
+  };
+}
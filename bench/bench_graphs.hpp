@@ -0,0 +1,46 @@
+#pragma once
+
+#include <format>
+#include <map>
+#include <string>
+#include <string_view>
+
+#include "generate.hpp"
+#include "graph.hpp"
+
+// Directory of the bundled datasets, set by CMake
+#ifndef IM_DATA_DIR
+#define IM_DATA_DIR "data"
+#endif
+
+namespace bench {
+
+[[nodiscard]] inline auto dataset_path(std::string_view name) -> std::string {
+  return std::format("{}/{}/{}.txt", IM_DATA_DIR, name, name);
+}
+
+// An Erdos-Renyi graph of 10^4 vertices and 10^5 edges with
+// weighted-cascade probabilities
+[[nodiscard]] inline auto synthetic_options() -> GeneratorOptions {
+  GeneratorOptions options;
+  options.n = 10'000;
+  options.m = 100'000;
+  return options;
+}
+
+// karate, congress and the synthetic graph, loaded once
+[[nodiscard]] inline auto bench_graphs()
+    -> const std::map<std::string, Graph, std::less<>>& {
+  static const auto graphs = [] {
+    std::map<std::string, Graph, std::less<>> loaded;
+    for (auto name : {"karate", "congress"}) {
+      loaded.emplace(name, load_graph(dataset_path(name)));
+    }
+    loaded.emplace("synthetic-1e5",
+                   im::generate_graph(synthetic_options(), {}));
+    return loaded;
+  }();
+  return graphs;
+}
+
+}  // namespace bench
@@ -0,0 +1,25 @@
+#include <format>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "bench_graphs.hpp"
+#include "greedy.hpp"
+#include "log.hpp"
+
+TEST_CASE("CELF", "[bench][greedy]") {
+  constexpr int k = 5;
+  constexpr int repeats = 100;
+  im::set_log_level(LogLevel::Warn);  // one line per step otherwise
+  for (auto name : {"karate", "congress"}) {
+    const auto& g = bench::bench_graphs().find(name)->second;
+
+    BENCHMARK(std::format("greedy_lazy_forward {} (k {}, {} cascades per "
+                          "evaluation)",
+                          name, k, repeats)) {
+      DiffusionSubmodular f(g, DiffusionType::IndependentCascade, repeats);
+      f.seed(4);
+      return greedy_lazy_forward(f, g.n, k);
+    };
+  }
+}
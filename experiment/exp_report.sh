@@ -0,0 +1,16 @@
+#!/bin/bash
+# Runs every algorithm on a dataset, evaluates the seeds and keeps a summary
+# per commit in reports/, to compare time, samples, peak RSS and influence
+# across commits. Usage: exp_report.sh [dataset] [k range]
+
+dataset=${1:-karate}
+range=${2:-1..5}
+
+# one run at a time, so that each records its own peak RSS; the threads
+# work inside the run
+for k in $(seq "${range%..*}" "${range#*..}"); do
+  ./build/bandit-im "$dataset" "$k" 0.1 0.01 --n_top 3 --threads 8 --then_eval
+done
+mkdir -p reports
+./build/bandit-im-results "$dataset" --report json \
+    --output "reports/$dataset-$(git rev-parse --short HEAD).json"
@@ -1,4 +1,4 @@
 #!/bin/bash
 
-seq 1 1024 | parallel -j60 --line-buffer ./build/bandit-im karate {} 0.1 0.01 --n_top 15
-seq 1 1024 | parallel -j60 --line-buffer ./build/bandit-im karate {} 0.0003 0.01 --n_top 15 --eval
+./build/bandit-im karate 1..1024 0.1 0.01 --n_top 15 --threads 60 --then_eval --eval_eps 0.0003
+./build/bandit-im-results karate --output results/karate.csv
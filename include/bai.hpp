@@ -0,0 +1,359 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <concepts>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "log.hpp"
+#include "trace.hpp"
+#include "ucb.hpp"
+
+namespace im {
+
+// A best-arm identification algorithm over arms 0..n-1.
+// Arms can be disabled (e.g. vertices already chosen as seeds) and
+// re-enabled between calls of best_arm().
+template <typename Algo>
+concept BestArmIdentifier = requires(Algo& algo, const Algo& calgo, int arm) {
+  { algo.best_arm() } -> std::convertible_to<int>;
+  { algo.reset() } -> std::same_as<void>;
+  { algo.enable_all_arms() } -> std::same_as<void>;
+  { algo.disable_arm(arm) } -> std::same_as<void>;
+  { calgo.has_enabled_arm() } -> std::same_as<bool>;
+  { calgo.n_pulls() } -> std::convertible_to<int>;
+};
+
+// A best-arm identification algorithm that can also identify the m best
+// enabled arms at once (up to eps).
+template <typename Algo>
+concept TopArmIdentifier =
+    BestArmIdentifier<Algo> && requires(Algo& algo, int m) {
+      { algo.top_arms(m) } -> std::same_as<std::vector<int>>;
+    };
+
+// LUCB (Kalyanakrishnan et al., 2012)
+// Every round pulls both the empirical leader and its strongest challenger
+// (the other arm with the highest UCB), and stops once the leader's LCB
+// clears the challenger's UCB up to eps. top_arms(m) is LUCB1 for the m best
+// arms: the weakest of the empirical top m against the strongest of the rest.
+template <ConfidenceBoundTracker Tracker, ArmReward Reward>
+struct LUCB {
+  int n;
+  double eps;
+  Reward& reward;
+  std::vector<Tracker> trackers;
+  std::vector<char> enabled;
+  LUCB(int n, double eps, Reward& reward, std::vector<Tracker> trackers)
+      : n(n),
+        eps(eps),
+        reward(reward),
+        trackers(std::move(trackers)),
+        enabled(n, true) {
+    assert(this->n >= 1);
+    assert(this->n == static_cast<int>(this->trackers.size()));
+  }
+
+  auto reset() -> void {
+    for (auto& tracker : trackers) {
+      tracker.reset_ucb();
+    }
+  }
+
+  auto enable_all_arms() -> void { std::ranges::fill(enabled, true); }
+
+  auto disable_arm(int i) -> void {
+    assert(0 <= i && i < n);
+    enabled[i] = false;
+  }
+
+  [[nodiscard]] auto n_pulls() const -> int {
+    return std::ranges::fold_left(
+        trackers, 0, [](int total, const auto& tracker) {
+          return total + static_cast<int>(tracker.num_pulls());
+        });
+  }
+
+  [[nodiscard]] auto has_enabled_arm() const -> bool {
+    return std::ranges::any_of(enabled, [](char value) { return value; });
+  }
+
+  [[nodiscard]] auto best_arm() -> int {
+    TraceSpan span("best_arm");
+    assert(has_enabled_arm());
+    std::vector<int> unpulled;
+    for (int i = 0; i < n; i++) {
+      if (enabled[i] && trackers[i].num_pulls() == 0) {
+        unpulled.push_back(i);
+      }
+    }
+    pull_arms(reward, trackers, unpulled);
+
+    for (size_t t = 1;; t++) {
+      int h = leader();
+      int l = challenger(h);
+      if (l == -1) {
+        return h;
+      }
+      if (trackers[h].lcb() > trackers[l].ucb() - eps) {
+        log_debug("LUCB stops at round {} with arm {}, lcb {} vs "
+                  "challenger {} ucb {}",
+                  t, h, trackers[h].lcb(), l, trackers[l].ucb());
+        return h;
+      }
+      pull(h);
+      pull(l);
+    }
+  }
+
+  // Returns the m best enabled arms, ordered by decreasing empirical mean
+  [[nodiscard]] auto top_arms(int m) -> std::vector<int> {
+    TraceSpan span("top_arms", "m", m);
+    assert(m >= 1);
+    std::vector<int> arms;
+    for (int i = 0; i < n; i++) {
+      if (enabled[i]) {
+        arms.push_back(i);
+      }
+    }
+    auto by_mean = [&](int arm) { return trackers[arm].mean(); };
+    if (static_cast<int>(arms.size()) <= m) {
+      std::ranges::sort(arms, std::ranges::greater{}, by_mean);
+      return arms;
+    }
+    std::vector<int> unpulled;
+    for (auto arm : arms) {
+      if (trackers[arm].num_pulls() == 0) {
+        unpulled.push_back(arm);
+      }
+    }
+    pull_arms(reward, trackers, unpulled);
+
+    for (size_t t = 1;; t++) {
+      std::ranges::nth_element(arms, arms.begin() + m, std::ranges::greater{},
+                               by_mean);
+      auto high = std::span(arms).first(m);
+      auto low = std::span(arms).subspan(m);
+      auto h = *std::ranges::min_element(
+          high, {}, [&](int arm) { return trackers[arm].lcb(); });
+      auto l = *std::ranges::max_element(
+          low, {}, [&](int arm) { return trackers[arm].ucb(); });
+      if (trackers[h].lcb() > trackers[l].ucb() - eps) {
+        log_debug("LUCB stops at round {} with top {}, lcb {} vs "
+                  "challenger {} ucb {}",
+                  t, m, trackers[h].lcb(), l, trackers[l].ucb());
+        arms.resize(m);
+        std::ranges::sort(arms, std::ranges::greater{}, by_mean);
+        return arms;
+      }
+      pull(h);
+      pull(l);
+    }
+  }
+
+ private:
+  auto pull(int i) -> void { pull_arm(reward, trackers[i], i); }
+
+  [[nodiscard]] auto leader() const -> int {
+    int h = -1;
+    for (int arm = 0; arm < n; arm++) {
+      if (enabled[arm] &&
+          (h == -1 || trackers[arm].mean() > trackers[h].mean())) {
+        h = arm;
+      }
+    }
+    assert(h != -1);
+    return h;
+  }
+
+  [[nodiscard]] auto challenger(int h) const -> int {
+    int l = -1;
+    for (int arm = 0; arm < n; arm++) {
+      if (enabled[arm] && arm != h &&
+          (l == -1 || trackers[arm].ucb() > trackers[l].ucb())) {
+        l = arm;
+      }
+    }
+    return l;
+  }
+};
+
+// Successive elimination (Even-Dar et al., 2006)
+// Pulls every surviving arm once per round and permanently drops arms whose
+// UCB falls below the leader's LCB. The active set is kept as a compact
+// index list, so later rounds only touch the arms still in the race, and
+// each round is a single bulk pull.
+// top_arms(m) accepts and rejects arms the same way (Bubeck et al., 2013).
+template <ConfidenceBoundTracker Tracker, ArmReward Reward>
+struct SuccessiveElimination {
+  int n;
+  double eps;
+  Reward& reward;
+  std::vector<Tracker> trackers;
+  std::vector<char> enabled;
+  std::vector<int> active;
+  SuccessiveElimination(int n,
+                        double eps,
+                        Reward& reward,
+                        std::vector<Tracker> trackers)
+      : n(n),
+        eps(eps),
+        reward(reward),
+        trackers(std::move(trackers)),
+        enabled(n, true),
+        active() {
+    assert(this->n >= 1);
+    assert(this->n == static_cast<int>(this->trackers.size()));
+  }
+
+  auto reset() -> void {
+    for (auto& tracker : trackers) {
+      tracker.reset_ucb();
+    }
+  }
+
+  auto enable_all_arms() -> void { std::ranges::fill(enabled, true); }
+
+  auto disable_arm(int i) -> void {
+    assert(0 <= i && i < n);
+    enabled[i] = false;
+  }
+
+  [[nodiscard]] auto n_pulls() const -> int {
+    return std::ranges::fold_left(
+        trackers, 0, [](int total, const auto& tracker) {
+          return total + static_cast<int>(tracker.num_pulls());
+        });
+  }
+
+  [[nodiscard]] auto has_enabled_arm() const -> bool {
+    return std::ranges::any_of(enabled, [](char value) { return value; });
+  }
+
+  [[nodiscard]] auto best_arm() -> int {
+    TraceSpan span("best_arm");
+    assert(has_enabled_arm());
+    active.clear();
+    for (int i = 0; i < n; i++) {
+      if (enabled[i]) {
+        active.push_back(i);
+      }
+    }
+
+    for (size_t round = 1;; round++) {
+      pull_arms(reward, trackers, active);
+
+      auto leader = *std::ranges::max_element(active, {}, [&](int arm) {
+        return trackers[arm].mean();
+      });
+      auto leader_lcb = trackers[leader].lcb();
+      std::erase_if(active, [&](int arm) {
+        return arm != leader && trackers[arm].ucb() < leader_lcb;
+      });
+      if (active.size() == 1) {
+        log_debug("Elimination stops at round {} with arm {}", round,
+                  leader);
+        return leader;
+      }
+
+      auto max_other_ucb = -infty;
+      for (auto arm : active) {
+        if (arm != leader) {
+          max_other_ucb = std::max(max_other_ucb, trackers[arm].ucb());
+        }
+      }
+      if (leader_lcb > max_other_ucb - eps) {
+        log_debug("Elimination stops at round {} with arm {}, {} arms left",
+                  round, leader, active.size());
+        return leader;
+      }
+    }
+  }
+
+  // Returns the m best enabled arms, ordered by decreasing empirical mean
+  [[nodiscard]] auto top_arms(int m) -> std::vector<int> {
+    TraceSpan span("top_arms", "m", m);
+    assert(m >= 1);
+    auto by_mean = [&](int arm) { return trackers[arm].mean(); };
+    active.clear();
+    for (int i = 0; i < n; i++) {
+      if (enabled[i]) {
+        active.push_back(i);
+      }
+    }
+    std::vector<int> accepted;
+    std::vector<double> lcbs, ucbs;
+    for (size_t round = 1;; round++) {
+      auto r = m - static_cast<int>(accepted.size());
+      if (static_cast<int>(active.size()) <= r) {
+        std::ranges::sort(active, std::ranges::greater{}, by_mean);
+        accepted.insert(accepted.end(), active.begin(), active.end());
+        break;
+      }
+      pull_arms(reward, trackers, active);
+
+      // the r-th highest bound among the other active arms
+      lcbs.clear();
+      ucbs.clear();
+      for (auto arm : active) {
+        lcbs.push_back(trackers[arm].lcb());
+        ucbs.push_back(trackers[arm].ucb());
+      }
+      std::ranges::nth_element(lcbs, lcbs.begin() + r, std::ranges::greater{});
+      std::ranges::nth_element(ucbs, ucbs.begin() + r, std::ranges::greater{});
+      auto lcb_r = lcbs[r];
+      auto ucb_r = ucbs[r];
+      std::ranges::nth_element(lcbs, lcbs.begin() + (r - 1),
+                               std::ranges::greater{});
+      std::ranges::nth_element(ucbs, ucbs.begin() + (r - 1),
+                               std::ranges::greater{});
+      auto lcb_r1 = lcbs[r - 1];
+      auto ucb_r1 = ucbs[r - 1];
+
+      std::erase_if(active, [&](int arm) {
+        auto& tracker = trackers[arm];
+        auto rival_lcb = tracker.lcb() >= lcb_r1 ? lcb_r : lcb_r1;
+        auto rival_ucb = tracker.ucb() >= ucb_r1 ? ucb_r : ucb_r1;
+        if (static_cast<int>(accepted.size()) < m &&
+            tracker.lcb() > rival_ucb) {
+          accepted.push_back(arm);
+          return true;
+        }
+        return tracker.ucb() < rival_lcb;
+      });
+      r = m - static_cast<int>(accepted.size());
+      if (r == 0) {
+        break;
+      }
+      if (static_cast<int>(active.size()) <= r) {
+        continue;
+      }
+
+      std::ranges::nth_element(active, active.begin() + r,
+                               std::ranges::greater{}, by_mean);
+      auto weakest_lcb = infty;
+      for (auto arm : std::span(active).first(r)) {
+        weakest_lcb = std::min(weakest_lcb, trackers[arm].lcb());
+      }
+      auto strongest_ucb = -infty;
+      for (auto arm : std::span(active).subspan(r)) {
+        strongest_ucb = std::max(strongest_ucb, trackers[arm].ucb());
+      }
+      if (weakest_lcb > strongest_ucb - eps) {
+        accepted.insert(accepted.end(), active.begin(), active.begin() + r);
+        break;
+      }
+    }
+    log_debug("Elimination selects top {}, {} arms left", m,
+              active.size());
+    std::ranges::sort(accepted, std::ranges::greater{}, by_mean);
+    return accepted;
+  }
+};
+
+}  // namespace im
+
+using im::LUCB;
+using im::SuccessiveElimination;
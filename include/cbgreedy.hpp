@@ -1,42 +1,139 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
 #include <concepts>
-#include <format>
+#include <cstdint>
+#include <span>
 #include <vector>
 
+#include "bai.hpp"
+#include "counters.hpp"
 #include "diffusion.hpp"
 #include "graph.hpp"
 #include "log.hpp"
+#include "numa.hpp"
 #include "rng.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
 #include "ucb.hpp"
+#include "world.hpp"
 
 namespace im {
 
 // A wrapper of DiffusionSolver to be used as the reward function for
 // confidence-bound-based algorithms. It exposes a single-arm reward interface.
+// The work of the last sample (edges probed, plus one for the seed) is
+// reported as its cost.
+// pull_many() draws each arm from its own RNG stream derived from the
+// solver's, and with a thread pool spreads the pulls over the workers, so
+// the results do not depend on the pool or its number of workers. A worker's solver is made
+// by the worker, on the graph replica of its NUMA node if there is one.
+// pull_shared() instead samples one live-edge world and reads the marginal
+// gain of every arm off it; a world counts as one sample.
+// When counting, checkpoint() records how often each pulled arm was pulled
+// in the step.
 struct DiffusionReward {
   DiffusionSolver& solver;
   DiffusionType type;
   std::vector<int> fixed_vertices;
   size_t samples;
   std::vector<size_t> used_samples;
+  double sample_cost;
+  ThreadPool* pool;
+  WorkerLocal<DiffusionSolver> worker_solvers;
+  LiveEdgeWorld world;
+  std::vector<std::uint32_t> step_pulls;  // only filled when counting
   DiffusionReward(DiffusionSolver& solver,
                   DiffusionType type,
-                  std::vector<int> fixed_vertices = {})
+                  std::vector<int> fixed_vertices = {},
+                  ThreadPool* pool = nullptr)
       : solver(solver),
         type(type),
         fixed_vertices(fixed_vertices),
         samples(0),
-        used_samples() {}
+        used_samples(),
+        sample_cost(0),
+        pool(pool),
+        worker_solvers(pool,
+                       [&g = solver.g] {
+                         return DiffusionSolver(numa_local(g), 0);
+                       }),
+        world(solver.g),
+        step_pulls() {}
 
   [[nodiscard]] auto operator()(int i) -> double {
     samples++;
-    return solver.run(type, i, fixed_vertices);
+    count_pulls(std::span(&i, 1));
+    auto probes = solver.probes;
+    auto result = solver.run(type, i, fixed_vertices);
+    sample_cost = static_cast<double>(solver.probes - probes + 1);
+    return result;
+  }
+
+  auto pull_many(std::span<const int> arms,
+                 std::span<double> rewards,
+                 std::span<double> costs) -> void {
+    assert(rewards.size() == arms.size() && costs.size() == arms.size());
+    samples += arms.size();
+    count_pulls(arms);
+    auto base = solver.rng();
+    auto pull = [&](size_t worker, size_t k) {
+      auto& local = worker_solvers[worker];
+      local.seed(base + static_cast<seed_type>(arms[k]));
+      auto probes = local.probes;
+      rewards[k] = local.run(type, arms[k], fixed_vertices);
+      costs[k] = static_cast<double>(local.probes - probes + 1);
+    };
+    if (pool == nullptr) {
+      for (size_t k = 0; k < arms.size(); k++) {
+        pull(0, k);
+      }
+    } else {
+      pool->parallel_for(arms.size(), pull);
+    }
+  }
+
+  auto pull_shared(std::span<const int> arms,
+                   std::span<double> rewards,
+                   std::span<double> costs) -> void {
+    assert(rewards.size() == arms.size() && costs.size() == arms.size());
+    samples++;
+    count_pulls(arms);
+    auto probes = world.probes;
+    world.sample(solver.rng, type, fixed_vertices);
+    world.gains(arms, rewards, pool);
+    auto work = static_cast<double>(world.probes - probes + arms.size());
+    solver.probes += world.probes - probes;
+    sample_cost = arms.empty() ? 0.0 : work / arms.size();
+    std::ranges::fill(costs, sample_cost);
   }
 
-  auto checkpoint() -> void { used_samples.push_back(samples); }
+  [[nodiscard]] auto last_cost() const -> double { return sample_cost; }
+
+  auto checkpoint() -> void {
+    used_samples.push_back(samples);
+    if constexpr (counters_enabled) {
+      for (auto& pulls : step_pulls) {
+        if (pulls > 0) {
+          count_value(Histogram::PullsPerArm, pulls);
+          pulls = 0;
+        }
+      }
+    }
+  }
 
   auto add_fixed(int i) -> void { fixed_vertices.push_back(i); }
+
+ private:
+  auto count_pulls(std::span<const int> arms) -> void {
+    if constexpr (counters_enabled) {
+      step_pulls.resize(solver.g.n);
+      for (auto arm : arms) {
+        step_pulls[arm]++;
+      }
+    }
+  }
 };
 
 template <typename Fn>
@@ -48,62 +145,177 @@ concept CBGreedyReward = requires(Fn& fn, int i) {
 
 static_assert(CBGreedyReward<DiffusionReward>,
               "DiffusionReward does not satisfy CBGreedyReward");
+static_assert(CostedReward<DiffusionReward>);
+static_assert(BatchReward<DiffusionReward>);
+static_assert(SharedReward<DiffusionReward>);
 
-template <CBGreedyReward Fn>
-[[nodiscard]] auto greedy_cb(Fn& f, int n, int k, double eps, double delta)
-    -> std::vector<int> {
-  using Tracker = LILConfidenceBoundTracker;
-  std::vector<Tracker> trackers;
+[[nodiscard]] inline auto make_lil_trackers(int n, double delta)
+    -> std::vector<LILConfidenceBoundTracker> {
+  std::vector<LILConfidenceBoundTracker> trackers;
   trackers.reserve(n);
   for (int i = 0; i < n; i++) {
     trackers.emplace_back(0.03, delta / n, n / 2.0, 0.5, 0.0,
                           static_cast<double>(n));
   }
-  UCB<Tracker, Fn> ucb(n, 3.0, eps, f, std::move(trackers), true);
+  return trackers;
+}
+
+// Policies building the best-arm identification algorithm that
+// greedy_cb and greedy_cb_lazy run for every seed.
+struct LILUCBPolicy {
+  template <ArmReward Reward>
+  [[nodiscard]] static auto make(Reward& reward, int n, double eps,
+                                 double delta) {
+    return UCB<LILConfidenceBoundTracker, Reward>(
+        n, 3.0, eps, reward, make_lil_trackers(n, delta), true);
+  }
+};
+
+// lil'UCB pulling only the more informative arm per unit of cascade cost
+struct CostAwareUCBPolicy {
+  template <ArmReward Reward>
+  [[nodiscard]] static auto make(Reward& reward, int n, double eps,
+                                 double delta) {
+    auto ucb = LILUCBPolicy::make(reward, n, eps, delta);
+    ucb.schedule = PullSchedule::CostAware;
+    return ucb;
+  }
+};
+
+// lil'UCB feeding all arms from one live-edge world per round, comparing
+// them by paired differences
+struct SharedWorldUCBPolicy {
+  template <ArmReward Reward>
+    requires SharedReward<Reward>
+  [[nodiscard]] static auto make(Reward& reward, int n, double eps,
+                                 double delta) {
+    auto ucb = LILUCBPolicy::make(reward, n, eps, delta);
+    ucb.schedule = PullSchedule::SharedWorld;
+    // marginal gains lie in [0, n], so their differences in [-n, n]
+    ucb.paired.assign(n, PairedDifferenceTracker(delta / n, 2.0 * n));
+    return ucb;
+  }
+};
+
+struct LUCBPolicy {
+  template <ArmReward Reward>
+  [[nodiscard]] static auto make(Reward& reward, int n, double eps,
+                                 double delta) {
+    return LUCB<LILConfidenceBoundTracker, Reward>(
+        n, eps, reward, make_lil_trackers(n, delta));
+  }
+};
+
+struct EliminationPolicy {
+  template <ArmReward Reward>
+  [[nodiscard]] static auto make(Reward& reward, int n, double eps,
+                                 double delta) {
+    return SuccessiveElimination<LILConfidenceBoundTracker, Reward>(
+        n, eps, reward, make_lil_trackers(n, delta));
+  }
+};
+
+template <typename Policy, typename Reward>
+concept BestArmPolicy =
+    requires(Reward& reward, int n, double eps, double delta) {
+      { Policy::make(reward, n, eps, delta) } -> BestArmIdentifier;
+    };
+
+template <typename Policy, typename Reward>
+concept TopArmPolicy =
+    requires(Reward& reward, int n, double eps, double delta) {
+      { Policy::make(reward, n, eps, delta) } -> TopArmIdentifier;
+    };
+
+static_assert(BestArmPolicy<LILUCBPolicy, DiffusionReward>);
+static_assert(BestArmPolicy<CostAwareUCBPolicy, DiffusionReward>);
+static_assert(BestArmPolicy<SharedWorldUCBPolicy, DiffusionReward>);
+static_assert(BestArmPolicy<LUCBPolicy, DiffusionReward>);
+static_assert(BestArmPolicy<EliminationPolicy, DiffusionReward>);
+static_assert(TopArmPolicy<LUCBPolicy, DiffusionReward>);
+static_assert(TopArmPolicy<EliminationPolicy, DiffusionReward>);
+
+template <CBGreedyReward Fn, BestArmPolicy<Fn> Policy = LILUCBPolicy>
+[[nodiscard]] auto greedy_cb(Fn& f, int n, int k, double eps, double delta)
+    -> std::vector<int> {
+  auto bai = Policy::make(f, n, eps, delta);
   std::vector<char> selected(n, false);
   std::vector<int> result;
   for (int i = 1; i <= k; i++) {
-    my_log(std::format("greedy_cb i: {}", i));
-    ucb.reset();
-    ucb.enable_all_arms();
+    log_info("greedy_cb i: {}", i);
+    TraceSpan span("greedy step", "i", i);
+    bai.reset();
+    bai.enable_all_arms();
     for (int j = 0; j < n; j++) {
       if (selected[j])
-        ucb.disable_arm(j);
+        bai.disable_arm(j);
     }
-    auto x = ucb.best_arm();
+    auto x = bai.best_arm();
     selected[x] = true;
     result.push_back(x);
     f.add_fixed(x);
     f.checkpoint();
+    count_step();
   }
   return result;
 }
 
-template <CBGreedyReward Fn>
+template <CBGreedyReward Fn, BestArmPolicy<Fn> Policy = LILUCBPolicy>
 [[nodiscard]] auto greedy_cb_lazy(Fn& f, int n, int k, double eps, double delta)
     -> std::vector<int> {
-  using Tracker = LILConfidenceBoundTracker;
-  std::vector<Tracker> trackers;
-  trackers.reserve(n);
-  for (int i = 0; i < n; i++) {
-    trackers.emplace_back(0.03, delta / n, n / 2.0, 0.5, 0.0,
-                          static_cast<double>(n));
-  }
-  UCB<Tracker, Fn> ucb(n, 3.0, eps, f, std::move(trackers), true);
+  auto bai = Policy::make(f, n, eps, delta);
   std::vector<char> selected(n, false);
   std::vector<int> result;
   for (int i = 1; i <= k; i++) {
-    my_log(std::format("greedy_cb_lazy i: {}", i));
-    auto x = ucb.best_arm();
+    log_info("greedy_cb_lazy i: {}", i);
+    TraceSpan span("greedy step", "i", i);
+    auto x = bai.best_arm();
     selected[x] = true;
     result.push_back(x);
     f.add_fixed(x);
     f.checkpoint();
-    ucb.disable_arm(x);
+    count_step();
+    bai.disable_arm(x);
   }
   return result;
 }
 
+// Confidence-based greedy that selects `batch` seeds per bandit phase.
+// Each phase identifies the top-m arms under the marginal gain w.r.t. the
+// seeds of earlier phases; seeds within a phase are not conditioned on each
+// other, so the result approximates greedy_cb with k / batch phases.
+template <typename Policy = LUCBPolicy>
+struct GreedyCBBatch {
+  int batch;
+
+  template <CBGreedyReward Fn>
+    requires TopArmPolicy<Policy, Fn>
+  [[nodiscard]] auto operator()(Fn& f, int n, int k, double eps,
+                                double delta) const -> std::vector<int> {
+    assert(batch >= 1);
+    auto bai = Policy::make(f, n, eps, delta);
+    std::vector<int> result;
+    for (int phase = 1; static_cast<int>(result.size()) < k; phase++) {
+      auto m = std::min(batch, k - static_cast<int>(result.size()));
+      log_info("greedy_cb_batch phase: {}, m: {}", phase, m);
+      TraceSpan span("greedy phase", "m", m);
+      bai.reset();
+      auto top = bai.top_arms(m);
+      for (auto x : top) {
+        bai.disable_arm(x);
+        result.push_back(x);
+        f.add_fixed(x);
+        f.checkpoint();
+        count_step();
+      }
+      if (!bai.has_enabled_arm()) {
+        break;
+      }
+    }
+    return result;
+  }
+};
+
 template <typename GreedyCB>
 concept GreedyCBSelector = requires(const GreedyCB& cb,
                                     DiffusionReward& reward,
@@ -123,6 +335,7 @@ struct GreedyCBDiffusion {
   double delta;
   const GreedyCB& cb_fn;
   DiffusionSolver solver;
+  ThreadPool* pool;  // optional, runs bulk pulls in parallel
   size_t total_samples;
   std::vector<size_t> used_samples_;
   GreedyCBDiffusion(const Graph& g,
@@ -138,12 +351,13 @@ struct GreedyCBDiffusion {
         delta(delta),
         cb_fn(cb_fn),
         solver(g, 0),
+        pool(nullptr),
         total_samples(0),
         used_samples_() {}
 
   [[nodiscard]] auto run(seed_type seed) -> std::vector<int> {
     solver.seed(seed);
-    auto reward = DiffusionReward(solver, type);
+    auto reward = DiffusionReward(solver, type, {}, pool);
     auto result = cb_fn(reward, n, k, eps, delta);
     total_samples += reward.samples;
     used_samples_.insert(used_samples_.end(), reward.used_samples.begin(),
@@ -167,7 +381,13 @@ GreedyCBDiffusion(const Graph& g,
 
 }  // namespace im
 
+using im::CostAwareUCBPolicy;
 using im::DiffusionReward;
+using im::EliminationPolicy;
 using im::greedy_cb;
 using im::greedy_cb_lazy;
+using im::GreedyCBBatch;
 using im::GreedyCBDiffusion;
+using im::LILUCBPolicy;
+using im::LUCBPolicy;
+using im::SharedWorldUCBPolicy;
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "graph.hpp"
+
+namespace im {
+
+// A read-only graph in a few bytes per edge, for graphs whose adjacency
+// lists do not fit in memory. Every vertex's out-edges are sorted by target
+// and stored as LEB128 varints: the degree, then the first target as a
+// zigzag gap from the source and the others as gaps from the previous one.
+// Probabilities are coded against a dictionary of the distinct values, most
+// frequent first. When all edges into a vertex share one probability (e.g.
+// weighted cascade, 1 / in-degree) it is coded once per target; otherwise
+// every edge carries its code after its target.
+// g[u] decodes u's edges while they are iterated, so DiffusionSolver runs on
+// it like on a Graph, with the edges in target order.
+struct CompressedGraph {
+  int n = 0;
+  int m = 0;
+  std::vector<std::uint64_t> offsets;  // of every vertex's edges in bytes
+  std::vector<std::uint8_t> bytes;
+  std::vector<weight_t> dictionary;
+  std::vector<std::uint32_t> target_codes;  // per target, or empty
+
+  [[nodiscard]] static auto read_varint(const std::uint8_t*& p)
+      -> std::uint64_t {
+    std::uint64_t value = 0;
+    for (int shift = 0;; shift += 7) {
+      auto byte = *p++;
+      value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        return value;
+      }
+    }
+  }
+
+  // Decodes one edge per step; compares equal to std::default_sentinel
+  // after the last one
+  struct EdgeIterator {
+    using value_type = Edge;
+    using difference_type = std::ptrdiff_t;
+
+    const CompressedGraph* g = nullptr;
+    const std::uint8_t* p = nullptr;
+    std::uint64_t left = 0;
+    Edge edge{};
+
+    EdgeIterator() = default;
+    EdgeIterator(const CompressedGraph* g,
+                 const std::uint8_t* p,
+                 std::uint64_t left,
+                 int source)
+        : g(g), p(p), left(left), edge{source, 0} {
+      if (left > 0) {
+        auto zigzag = read_varint(this->p);
+        auto gap = static_cast<std::int64_t>(zigzag >> 1) ^
+                   -static_cast<std::int64_t>(zigzag & 1);
+        decode(static_cast<int>(source + gap));
+      }
+    }
+
+    [[nodiscard]] auto operator*() const -> const Edge& { return edge; }
+
+    auto operator++() -> EdgeIterator& {
+      if (--left > 0) {
+        decode(edge.to + static_cast<int>(read_varint(p)));
+      }
+      return *this;
+    }
+
+    auto operator++(int) -> EdgeIterator {
+      auto copy = *this;
+      ++*this;
+      return copy;
+    }
+
+    [[nodiscard]] friend auto operator==(const EdgeIterator& it,
+                                         std::default_sentinel_t) -> bool {
+      return it.left == 0;
+    }
+
+   private:
+    auto decode(int target) -> void {
+      edge.to = target;
+      auto code = g->target_codes.empty()
+                      ? static_cast<std::uint32_t>(read_varint(p))
+                      : g->target_codes[target];
+      edge.weight = g->dictionary[code];
+    }
+  };
+
+  struct Edges {
+    const CompressedGraph* g;
+    const std::uint8_t* p;  // past the degree
+    std::uint64_t degree;
+    int source;
+
+    [[nodiscard]] auto size() const -> size_t { return degree; }
+    [[nodiscard]] auto begin() const -> EdgeIterator {
+      return {g, p, degree, source};
+    }
+    [[nodiscard]] auto end() const -> std::default_sentinel_t { return {}; }
+  };
+
+  [[nodiscard]] auto operator[](int u) const -> Edges {
+    const auto* p = bytes.data() + offsets[u];
+    auto degree = read_varint(p);
+    return {this, p, degree, u};
+  }
+
+  // Heap and object bytes
+  [[nodiscard]] auto memory_bytes() const -> size_t;
+
+  // The Graph with the same edges, each adjacency list in target order
+  [[nodiscard]] auto decompress() const -> Graph;
+};
+
+[[nodiscard]] auto compress_graph(const Graph& g) -> CompressedGraph;
+
+// Heap and object bytes of a Graph, to compare with
+// CompressedGraph::memory_bytes()
+[[nodiscard]] auto graph_memory_bytes(const Graph& g) -> size_t;
+
+}  // namespace im
+
+using im::CompressedGraph;
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Work counters in the hot loops, compiled in with -DIM_COUNTERS=1 (CMake
+// option IM_COUNTERS); otherwise every count() is an empty inline call
+#ifndef IM_COUNTERS
+#define IM_COUNTERS 0
+#endif
+
+namespace im {
+
+inline constexpr bool counters_enabled = IM_COUNTERS != 0;
+
+enum class Counter : size_t {
+  EdgesProbed,
+  RngDraws,
+  Cascades,
+  ArmPulls,
+  WorldsSampled,
+  LazyEvaluations,  // marginal gains (re-)evaluated by CELF
+  Size,
+};
+
+// Histograms over power-of-two buckets: bucket 0 holds 0, bucket b holds
+// [2^(b-1), 2^b)
+enum class Histogram : size_t {
+  CascadeSize,
+  PullsPerArm,  // pulls of every arm within one greedy step
+  Size,
+};
+
+inline constexpr size_t n_counters = static_cast<size_t>(Counter::Size);
+inline constexpr size_t n_histograms = static_cast<size_t>(Histogram::Size);
+inline constexpr size_t histogram_buckets = 40;
+
+[[nodiscard]] constexpr auto counter_name(Counter counter) -> std::string_view {
+  constexpr std::array<std::string_view, n_counters> names{
+      "edges_probed", "rng_draws",      "cascades",
+      "arm_pulls",    "worlds_sampled", "lazy_evaluations"};
+  return names[static_cast<size_t>(counter)];
+}
+
+[[nodiscard]] constexpr auto histogram_name(Histogram histogram)
+    -> std::string_view {
+  constexpr std::array<std::string_view, n_histograms> names{"cascade_size",
+                                                             "pulls_per_arm"};
+  return names[static_cast<size_t>(histogram)];
+}
+
+[[nodiscard]] constexpr auto histogram_bucket(std::uint64_t value) -> size_t {
+  return std::min<size_t>(std::bit_width(value), histogram_buckets - 1);
+}
+
+// Summed counts
+struct CounterValues {
+  std::array<std::uint64_t, n_counters> counts{};
+  std::array<std::array<std::uint64_t, histogram_buckets>, n_histograms>
+      histograms{};
+
+  [[nodiscard]] auto operator[](Counter counter) const -> std::uint64_t {
+    return counts[static_cast<size_t>(counter)];
+  }
+
+  // the counts since `earlier`
+  [[nodiscard]] auto since(const CounterValues& earlier) const
+      -> CounterValues;
+  [[nodiscard]] auto to_json() const -> std::string;
+};
+
+// The counts of one thread within one run. Only that thread writes them,
+// so a relaxed load and store replaces a locked increment.
+struct CounterBlock {
+  std::array<std::atomic<std::uint64_t>, n_counters> counts{};
+  std::array<std::array<std::atomic<std::uint64_t>, histogram_buckets>,
+             n_histograms>
+      histograms{};
+
+  auto add(Counter counter, std::uint64_t n) -> void {
+    bump(counts[static_cast<size_t>(counter)], n);
+  }
+
+  auto record(Histogram histogram, std::uint64_t value) -> void {
+    bump(histograms[static_cast<size_t>(histogram)][histogram_bucket(value)],
+         1);
+  }
+
+ private:
+  static auto bump(std::atomic<std::uint64_t>& cell, std::uint64_t n) -> void {
+    cell.store(cell.load(std::memory_order_relaxed) + n,
+               std::memory_order_relaxed);
+  }
+};
+
+// Hardware counters of the calling thread through perf_event_open, if the
+// kernel allows it
+struct PerfEvents {
+  int cycles_fd;
+  int llc_misses_fd;
+
+  PerfEvents();
+  PerfEvents(const PerfEvents&) = delete;
+  auto operator=(const PerfEvents&) -> PerfEvents& = delete;
+  ~PerfEvents();
+
+  struct Sample {
+    std::uint64_t cycles;
+    std::uint64_t llc_misses;
+  };
+
+  [[nodiscard]] auto read() const -> std::optional<Sample>;
+};
+
+// The counters of one selection run, summed over the threads that worked
+// for it, and split per greedy step. A thread counts into the run set by
+// CounterScope; ThreadPool workers count into the run of the thread that
+// started the loop. Hardware counters cover the run's own thread only.
+struct RunCounters {
+  std::uint64_t id;  // tells runs apart even if one reuses another's address
+  std::vector<CounterValues> steps;
+  std::vector<PerfEvents::Sample> hardware_steps;
+
+  explicit RunCounters(bool hardware = true);
+
+  // the calling thread's block, made on its first call
+  [[nodiscard]] auto block() -> CounterBlock&;
+  [[nodiscard]] auto total() -> CounterValues;
+
+  // Closes the current greedy step
+  auto step() -> void;
+
+  [[nodiscard]] auto to_json(int run, std::string_view alg) const
+      -> std::string;
+
+ private:
+  std::mutex mutex;
+  // per thread, so a thread that switches between runs keeps its block
+  std::unordered_map<std::thread::id, CounterBlock> blocks;
+  CounterValues last;
+  std::unique_ptr<PerfEvents> perf;
+  std::optional<PerfEvents::Sample> last_hardware;
+};
+
+extern thread_local RunCounters* current_counters;
+
+namespace detail {
+
+extern thread_local CounterBlock* cached_block;
+extern thread_local std::uint64_t cached_run;
+
+inline auto counter_block() -> CounterBlock* {
+  auto* run = current_counters;
+  if (run == nullptr) {
+    return nullptr;
+  }
+  if (cached_run != run->id) {
+    cached_block = &run->block();
+    cached_run = run->id;
+  }
+  return cached_block;
+}
+
+}  // namespace detail
+
+inline auto count(Counter counter, std::uint64_t n = 1) -> void {
+  if constexpr (counters_enabled) {
+    if (auto* block = detail::counter_block()) {
+      block->add(counter, n);
+    }
+  }
+}
+
+inline auto count_value(Histogram histogram, std::uint64_t value) -> void {
+  if constexpr (counters_enabled) {
+    if (auto* block = detail::counter_block()) {
+      block->record(histogram, value);
+    }
+  }
+}
+
+// Closes the greedy step of the current run
+inline auto count_step() -> void {
+  if constexpr (counters_enabled) {
+    if (current_counters != nullptr) {
+      current_counters->step();
+    }
+  }
+}
+
+// Makes the calling thread count into `counters` until leaving scope
+struct CounterScope {
+  RunCounters* previous;
+
+  explicit CounterScope(RunCounters& counters)
+      : previous(std::exchange(current_counters, &counters)) {}
+  CounterScope(const CounterScope&) = delete;
+  auto operator=(const CounterScope&) -> CounterScope& = delete;
+  ~CounterScope() { current_counters = previous; }
+};
+
+}  // namespace im
+
+using im::Counter;
+using im::CounterScope;
+using im::Histogram;
+using im::RunCounters;
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <expected>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "graph.hpp"
+#include "thread_pool.hpp"
+#include "world.hpp"
+
+namespace im {
+
+// A request: a command followed by key=value arguments, e.g.
+//   influence graph=karate seeds=0,33 eps=0.01 model=lt
+struct Request {
+  std::string command;
+  std::map<std::string, std::string, std::less<>> args;
+};
+
+[[nodiscard]] auto parse_request(std::string_view text)
+    -> std::expected<Request, error_t>;
+
+// Answers influence queries on graphs that are loaded once and kept warm,
+// together with the thread pool and a live-edge world buffer per graph.
+// Every response is a JSON object with "ok" and either the result or
+// "error". Commands:
+//   graphs                                  loaded graphs
+//   influence graph= seeds= [eps model seed]  influence of every prefix
+//   select graph= k= [alg bai batch eps delta model seed]
+//   gains graph= [fixed= arms= eps model seed max_worlds]
+//                                           marginal gains w.r.t. fixed
+//   shutdown
+struct QueryServer {
+  ThreadPool* pool;
+  std::map<std::string, Graph, std::less<>> graphs;
+  bool stopping;
+
+  explicit QueryServer(ThreadPool* pool = nullptr);
+
+  auto add_graph(std::string name, Graph g) -> void;
+
+  [[nodiscard]] auto handle(std::string_view request) -> std::string;
+
+ private:
+  std::map<std::string, std::unique_ptr<LiveEdgeWorld>, std::less<>> worlds;
+
+  [[nodiscard]] auto world(std::string_view name, const Graph& g)
+      -> LiveEdgeWorld&;
+  [[nodiscard]] auto dispatch(const Request& request)
+      -> std::expected<std::string, error_t>;
+};
+
+// Frames on a stream socket: a 4-byte little-endian payload length followed
+// by the payload
+inline constexpr size_t max_frame_size = 16 << 20;
+
+[[nodiscard]] auto read_frame(int fd) -> std::expected<std::string, error_t>;
+[[nodiscard]] auto write_frame(int fd, std::string_view payload)
+    -> std::expected<void, error_t>;
+
+// Serves connections on a Unix domain socket at `path` until a shutdown
+// request, answering the requests of all open connections in turn. A
+// socket left at `path` by a daemon that is gone is replaced; anything else
+// there is an error.
+[[nodiscard]] auto serve(QueryServer& server, const std::string& path)
+    -> std::expected<void, error_t>;
+
+}  // namespace im
+
+using im::QueryServer;
+using im::Request;
@@ -1,12 +1,15 @@
 #pragma once
 
 #include <cassert>
+#include <concepts>
+#include <cstddef>
 #include <initializer_list>
 #include <random>
 #include <span>
 #include <utility>
 #include <vector>
 
+#include "counters.hpp"
 #include "graph.hpp"
 #include "rng.hpp"
 
@@ -19,19 +22,33 @@ enum class DiffusionType {
   LinearThreshold,
 };
 
+// What a solver reads of a graph: g.n, and g[u] iterating u's out-edges
+// (to, weight) with their number as size(). Graph stores them, and
+// CompressedGraph decodes them on the fly.
+template <typename G>
+concept DiffusionGraph = requires(const G& g, int u) {
+  { g.n } -> std::convertible_to<int>;
+  { g[u].size() } -> std::convertible_to<size_t>;
+  { (*g[u].begin()).to } -> std::convertible_to<int>;
+  { (*g[u].begin()).weight } -> std::convertible_to<weight_t>;
+};
+
 // The "raw" diffusion calculation logic
 // for both IC and LT models
-struct DiffusionSolver {
-  const Graph& g;
+template <DiffusionGraph G>
+struct BasicDiffusionSolver {
+  const G& g;
   RNG rng;
   size_t times;
+  size_t probes;  // edges probed so far, a proxy for the work done
   std::vector<size_t> last_activated;
   std::vector<int> queue;
   std::vector<double> weights;
-  DiffusionSolver(const Graph& g, seed_type seed)
+  BasicDiffusionSolver(const G& g, seed_type seed)
       : g(g),
         rng(seed),
         times(0),
+        probes(0),
         last_activated(g.n, 0),
         queue(g.n, -1),
         weights(g.n, 0.0) {}
@@ -52,28 +69,39 @@ struct DiffusionSolver {
   }
 
   [[nodiscard]] auto independent_cascade(int* ql, int* qr, size_t now) -> int* {
+    size_t draws = 0;
     while (ql != qr) {
       int u = *ql++;
-      for (const auto& e : g[u]) {
+      auto&& edges = g[u];
+      probes += edges.size();
+      for (const auto& e : edges) {
         int v = e.to;
-        if (last_activated[v] < now && u01(rng) < e.weight) {
-          last_activated[v] = now;
-          *qr++ = v;
+        if (last_activated[v] < now) {
+          draws++;
+          if (u01(rng) < e.weight) {
+            last_activated[v] = now;
+            *qr++ = v;
+          }
         }
       }
     }
+    count(Counter::RngDraws, draws);
     return qr;
   }
 
   [[nodiscard]] auto linear_threshold(int* ql, int* qr, size_t now, size_t then)
       -> int* {
+    size_t draws = 0;
     while (ql != qr) {
       int u = *ql++;
-      for (const auto& e : g[u]) {
+      auto&& edges = g[u];
+      probes += edges.size();
+      for (const auto& e : edges) {
         int v = e.to;
         if (last_activated[v] < now) {
           last_activated[v] = now;
           weights[v] = u01(rng);
+          draws++;
         }
         if (last_activated[v] < then) {
           weights[v] -= e.weight;
@@ -84,14 +112,25 @@ struct DiffusionSolver {
         }
       }
     }
+    count(Counter::RngDraws, draws);
     return qr;
   }
 
+  [[nodiscard]] auto counted_cascade(const int* ql,
+                                     const int* qr,
+                                     size_t probes_before) const -> double {
+    count(Counter::Cascades);
+    count(Counter::EdgesProbed, probes - probes_before);
+    count_value(Histogram::CascadeSize, static_cast<std::uint64_t>(qr - ql));
+    return static_cast<double>(qr - ql);
+  }
+
  public:
   [[nodiscard]] auto run_independent_cascade(std::span<const int> origin,
                                              std::span<const int> prepare = {})
       -> double {
     auto now = ++times;
+    auto probes_before = probes;
 
     auto ql = queue.data();
     auto qr = queue.data();
@@ -105,7 +144,7 @@ struct DiffusionSolver {
     qr = pre_activate(qr, origin, now);
     qr = independent_cascade(ql, qr, now);
 
-    return static_cast<double>(qr - ql);
+    return counted_cascade(ql, qr, probes_before);
   }
 
   [[nodiscard]] auto run_linear_threshold(std::span<const int> origin,
@@ -113,6 +152,7 @@ struct DiffusionSolver {
       -> double {
     auto now = ++times;
     auto then = ++times;
+    auto probes_before = probes;
 
     auto ql = queue.data();
     auto qr = queue.data();
@@ -126,7 +166,7 @@ struct DiffusionSolver {
     qr = pre_activate(qr, origin, then);
     qr = linear_threshold(ql, qr, now, then);
 
-    return static_cast<double>(qr - ql);
+    return counted_cascade(ql, qr, probes_before);
   }
 
   // workaround: for some reason `initializer_list`s are not `span`s by default
@@ -170,7 +210,10 @@ struct DiffusionSolver {
   }
 };
 
+using DiffusionSolver = BasicDiffusionSolver<Graph>;
+
 }  // namespace im
 
 using DiffusionType = im::DiffusionType;
 using DiffusionSolver = im::DiffusionSolver;
+using im::BasicDiffusionSolver;
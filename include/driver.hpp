@@ -0,0 +1,116 @@
+#pragma once
+
+#include <expected>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "diffusion.hpp"
+#include "graph.hpp"
+#include "profiles.hpp"
+#include "reorder.hpp"
+#include "rng.hpp"
+#include "thread_pool.hpp"
+
+namespace im {
+
+struct ResultReader;
+
+// Settings shared by all runs of one bandit-im invocation
+struct RunOptions {
+  std::string dataset;
+  DiffusionType type = DiffusionType::IndependentCascade;
+  double eps = 0.1;
+  double delta = 0.01;
+  double eval_eps = 0.1;  // for evaluation right after selection
+  int n_top = 10;
+  std::string bai = "ucb";
+  int batch = 1;
+  // the graph's ids against the input's when it was reordered; seeds are
+  // saved and loaded in input ids
+  std::shared_ptr<const VertexPermutation> permutation;
+  // weight profiles of the graph's topology; evaluation also estimates
+  // every result under all of them
+  std::shared_ptr<const ProfileGraph> profiles;
+  // the full graph when selecting on a sparsified one: selection right
+  // before evaluation then evaluates the seeds on it instead
+  const Graph* evaluation_graph = nullptr;
+};
+
+// Seeds chosen by one algorithm, with the samples used up to each seed
+struct AlgoResult {
+  std::string alg;
+  std::vector<int> seeds;
+  std::vector<size_t> used_samples;
+};
+
+// Run ids first..last, both included
+struct RunRange {
+  int first;
+  int last;
+
+  [[nodiscard]] auto size() const -> int { return last - first + 1; }
+};
+
+enum class RunMode {
+  Select,
+  Evaluate,
+  SelectEvaluate,  // evaluates the fresh results without reloading them
+};
+
+// Parses "k" or "a..b"
+[[nodiscard]] auto parse_run_range(std::string_view text)
+    -> std::expected<RunRange, error_t>;
+
+// Names under which the results of the selected algorithms are saved
+[[nodiscard]] auto result_algorithms(const RunOptions& options)
+    -> std::vector<std::string>;
+
+// Runs one selection algorithm: greedy-cb, celf-cb (both with options.bai),
+// greedy-cb-batch, celf or greedy
+[[nodiscard]] auto run_algorithm(const Graph& g,
+                                 const RunOptions& options,
+                                 std::string_view alg,
+                                 seed_type seed,
+                                 ThreadPool* pool)
+    -> std::expected<AlgoResult, error_t>;
+
+// Runs every selection algorithm for run id k with the seeds 10k+1..5, and
+// appends the results to the results store of the dataset
+[[nodiscard]] auto run_selection(const Graph& g,
+                                 const RunOptions& options,
+                                 int k,
+                                 ThreadPool* pool) -> std::vector<AlgoResult>;
+
+// Evaluates all prefixes of the given results on the same worlds (seed k),
+// and appends the estimates to the results store of the dataset. With
+// options.profiles, the full seed sets are also evaluated under every
+// profile, into profiles_path(dataset).
+auto run_evaluation(const Graph& g,
+                    const RunOptions& options,
+                    int k,
+                    double eps,
+                    const std::vector<AlgoResult>& results,
+                    ThreadPool* pool) -> void;
+
+// Loads the saved results of run k that exist
+[[nodiscard]] auto load_results(const ResultReader& store,
+                                const RunOptions& options,
+                                int k) -> std::vector<AlgoResult>;
+
+// Runs every id of `runs` in one process on the shared graph. Several runs
+// are spread over the pool, each run then being sequential; a single run
+// gets the pool for its own bulk pulls and evaluation.
+auto run_batch(const Graph& g,
+               const RunOptions& options,
+               RunRange runs,
+               RunMode mode,
+               ThreadPool* pool) -> void;
+
+}  // namespace im
+
+using im::AlgoResult;
+using im::RunMode;
+using im::RunOptions;
+using im::RunRange;
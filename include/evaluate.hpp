@@ -0,0 +1,322 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "diffusion.hpp"
+#include "graph.hpp"
+#include "log.hpp"
+#include "numa.hpp"
+#include "rng.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+
+namespace im {
+
+// Mean and variance of a stream of samples (Welford); partial statistics of
+// separate streams are combined with merge() (Chan et al.)
+struct RunningStats {
+  size_t count = 0;
+  double mean = 0;
+  double m2 = 0;  // sum of squared deviations from the mean
+
+  auto add(double sample) -> void {
+    count++;
+    auto deviation = sample - mean;
+    mean += deviation / count;
+    m2 += deviation * (sample - mean);
+  }
+
+  auto merge(const RunningStats& other) -> void {
+    if (other.count == 0) {
+      return;
+    }
+    auto total = count + other.count;
+    auto deviation = other.mean - mean;
+    auto weight = static_cast<double>(other.count) / total;
+    mean += deviation * weight;
+    m2 += other.m2 + deviation * deviation * count * weight;
+    count = total;
+  }
+
+  [[nodiscard]] auto variance() const -> double {
+    return count < 2 ? 0.0 : m2 / (count - 1);
+  }
+
+  // half-width of the normal-approximation confidence interval of the mean
+  [[nodiscard]] auto half_width(double z = 1.96) const -> double {
+    if (count == 0) {
+      return std::numeric_limits<double>::infinity();
+    }
+    return z * std::sqrt(variance() / static_cast<double>(count));
+  }
+};
+
+enum class ConfidenceMode {
+  Absolute,  // half-width < eps
+  Relative,  // half-width < eps * mean
+  Either,
+  Both,
+};
+
+// When the 95% interval of a mean estimate is narrow enough
+struct ConfidenceTarget {
+  double eps;
+  ConfidenceMode mode = ConfidenceMode::Either;
+
+  [[nodiscard]] auto met(const RunningStats& stats) const -> bool {
+    auto width = stats.half_width();
+    auto absolute = width < eps;
+    auto relative = width < eps * stats.mean;
+    switch (mode) {
+      case ConfidenceMode::Absolute:
+        return absolute;
+      case ConfidenceMode::Relative:
+        return relative;
+      case ConfidenceMode::Either:
+        return absolute || relative;
+      case ConfidenceMode::Both:
+        return absolute && relative;
+    }
+    std::unreachable();
+  }
+};
+
+// Estimates the influence of every prefix of several seed lists at once.
+// A world fixes the coin of every edge (IC) or the threshold of every vertex
+// (LT) through hash_uniform, so all lists are evaluated on the same worlds.
+// In each world a list's cascade grows one seed at a time: diffusion with
+// fixed coins or thresholds is monotone, so the activations of a prefix are
+// the starting point of the next one, and a single pass per list and world
+// yields all of its prefixes.
+// Worlds are simulated in fixed chunks, in parallel with a pool, and the
+// chunk statistics are merged in order, so the estimates do not depend on
+// the number of workers. Each worker reads the graph replica of its NUMA
+// node if there is one. The stopping rule is checked after min_worlds
+// worlds and then at counts growing by `growth`.
+struct PrefixEvaluator {
+  const Graph& g;
+  DiffusionType type;
+  seed_type seed;
+  ThreadPool* pool;
+  size_t min_worlds;
+  double growth;
+  size_t chunk;  // worlds per parallel task
+  std::vector<size_t> edge_offsets;  // id of the first out-edge of a vertex
+
+  PrefixEvaluator(const Graph& g,
+                  DiffusionType type,
+                  seed_type seed,
+                  ThreadPool* pool = nullptr)
+      : g(g),
+        type(type),
+        seed(seed),
+        pool(pool),
+        min_worlds(100),
+        growth(1.25),
+        chunk(64),
+        edge_offsets(g.n + 1, 0),
+        cascades() {
+    for (int u = 0; u < g.n; u++) {
+      edge_offsets[u + 1] = edge_offsets[u] + g[u].size();
+    }
+  }
+
+  // Writes the influence of seeds[0..i] in world `world` into out[i]
+  auto sample(size_t world, std::span<const int> seeds, std::span<double> out)
+      -> void {
+    sample(cascade(0), world, seeds, out);
+  }
+
+  // Samples worlds until every prefix meets the target, and returns the
+  // statistics of every prefix of every list. A list is only simulated up
+  // to its last prefix that has not met the target yet, so the worlds spent
+  // on slow short prefixes stay cheap.
+  [[nodiscard]] auto evaluate(const std::vector<std::vector<int>>& lists,
+                              ConfidenceTarget target)
+      -> std::vector<std::vector<RunningStats>> {
+    TraceSpan span("evaluate", "lists", std::ssize(lists));
+    assert(growth > 1 && chunk >= 1);
+    std::vector<std::vector<RunningStats>> stats;
+    std::vector<size_t> pending;  // length of the prefixes still sampled
+    for (const auto& seeds : lists) {
+      stats.emplace_back(seeds.size());
+      pending.push_back(seeds.size());
+    }
+    auto workers = pool == nullptr ? size_t{1} : pool->size();
+    for (size_t w = 0; w < workers; w++) {
+      cascade(w);
+    }
+
+    size_t world = 0;
+    size_t next_check = std::max<size_t>(min_worlds, 1);
+    std::vector<std::vector<std::vector<RunningStats>>> chunk_stats;
+    while (std::ranges::any_of(pending, [](size_t p) { return p > 0; })) {
+      TraceSpan round("eval prefix round", "worlds",
+                      static_cast<std::int64_t>(next_check));
+      auto n_chunks = (next_check - world + chunk - 1) / chunk;
+      chunk_stats.assign(n_chunks, {});
+      auto run_chunk = [&](size_t worker, size_t part) {
+        TraceSpan span("eval chunk", "part", static_cast<std::int64_t>(part));
+        auto& local = cascade(worker);
+        auto& partial = chunk_stats[part];
+        std::vector<double> influence;
+        for (size_t l = 0; l < lists.size(); l++) {
+          partial.emplace_back(pending[l]);
+        }
+        auto first = world + part * chunk;
+        auto last = std::min(first + chunk, next_check);
+        for (auto w = first; w < last; w++) {
+          for (size_t l = 0; l < lists.size(); l++) {
+            influence.resize(pending[l]);
+            sample(local, w, std::span(lists[l]).first(pending[l]), influence);
+            for (size_t i = 0; i < pending[l]; i++) {
+              partial[l][i].add(influence[i]);
+            }
+          }
+        }
+      };
+      if (pool == nullptr) {
+        for (size_t part = 0; part < n_chunks; part++) {
+          run_chunk(0, part);
+        }
+      } else {
+        pool->parallel_for(n_chunks, run_chunk);
+      }
+
+      for (const auto& partial : chunk_stats) {
+        for (size_t l = 0; l < lists.size(); l++) {
+          for (size_t i = 0; i < partial[l].size(); i++) {
+            stats[l][i].merge(partial[l][i]);
+          }
+        }
+      }
+      world = next_check;
+      for (size_t l = 0; l < lists.size(); l++) {
+        auto length = pending[l];
+        pending[l] = 0;
+        for (size_t i = 0; i < length; i++) {
+          if (!target.met(stats[l][i])) {
+            pending[l] = i + 1;
+          }
+        }
+      }
+      auto grown = std::ceil(static_cast<double>(world) * growth);
+      next_check = std::max(world + 1, static_cast<size_t>(grown));
+    }
+    log_info("PrefixEvaluator stops after {} worlds, {} probes", world,
+             probes());
+    return stats;
+  }
+
+  // edges probed so far over all workers
+  [[nodiscard]] auto probes() const -> size_t {
+    size_t total = 0;
+    for (const auto& c : cascades) {
+      total += c.probes;
+    }
+    return total;
+  }
+
+ private:
+  // a worker's cascade state
+  struct Cascade {
+    const Graph* graph = nullptr;  // set by the worker on first use
+    std::vector<size_t> last_activated;
+    std::vector<size_t> last_touched;  // LT: weights[v] is set for this pass
+    std::vector<double> weights;
+    std::vector<int> queue;
+    size_t times = 0;
+    size_t probes = 0;
+  };
+  std::vector<Cascade> cascades;
+
+  // only resized before the workers start
+  auto cascade(size_t worker) -> Cascade& {
+    while (cascades.size() <= worker) {
+      auto& c = cascades.emplace_back();
+      c.last_activated.assign(g.n, 0);
+      c.last_touched.assign(g.n, 0);
+      c.weights.assign(g.n, 0.0);
+      c.queue.assign(g.n, -1);
+    }
+    return cascades[worker];
+  }
+
+  auto sample(Cascade& c,
+              size_t world,
+              std::span<const int> seeds,
+              std::span<double> out) const -> void {
+    assert(out.size() == seeds.size());
+    if (c.graph == nullptr) {
+      c.graph = &numa_local(g);
+    }
+    auto key = mix64(seed ^ mix64(world));
+    auto now = ++c.times;
+    size_t qr = 0;
+    for (size_t i = 0; i < seeds.size(); i++) {
+      auto ql = qr;
+      auto s = seeds[i];
+      if (c.last_activated[s] != now) {
+        c.last_activated[s] = now;
+        c.queue[qr++] = s;
+      }
+      qr = spread(c, key, now, ql, qr);
+      out[i] = static_cast<double>(qr);
+    }
+  }
+
+  // Continues the cascade of queue[0..ql) from the newly activated
+  // queue[ql..qr); returns the new end of the queue
+  [[nodiscard]] auto spread(Cascade& c,
+                            std::uint64_t key,
+                            size_t now,
+                            size_t ql,
+                            size_t qr) const -> size_t {
+    const auto& local = *c.graph;
+    while (ql != qr) {
+      int u = c.queue[ql++];
+      c.probes += local[u].size();
+      auto next_id = edge_offsets[u];
+      for (const auto& e : local[u]) {
+        auto id = next_id++;
+        int v = e.to;
+        if (c.last_activated[v] == now) {
+          continue;
+        }
+        bool active = false;
+        switch (type) {
+          case DiffusionType::IndependentCascade:
+            active = hash_uniform(key, id) < e.weight;
+            break;
+          case DiffusionType::LinearThreshold:
+            if (c.last_touched[v] != now) {
+              c.last_touched[v] = now;
+              c.weights[v] = hash_uniform(key, edge_offsets[g.n] + v);
+            }
+            c.weights[v] -= e.weight;
+            active = c.weights[v] <= 0;
+            break;
+        }
+        if (active) {
+          c.last_activated[v] = now;
+          c.queue[qr++] = v;
+        }
+      }
+    }
+    return qr;
+  }
+};
+
+}  // namespace im
+
+using im::ConfidenceMode;
+using im::ConfidenceTarget;
+using im::PrefixEvaluator;
+using im::RunningStats;
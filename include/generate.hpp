@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <ostream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "diffusion.hpp"
+#include "graph.hpp"
+#include "rng.hpp"
+
+namespace im {
+
+// Random graphs for scale testing. A generator is deterministic for its
+// options, so it can be run twice instead of keeping its edges: once to
+// count in-degrees, once to emit the weighted edges.
+enum class GraphModel {
+  ErdosRenyi,      // m edges between uniform endpoints
+  BarabasiAlbert,  // preferential attachment, every edge in both directions
+  RMat,            // recursive quadrants (Chakrabarti et al., 2004)
+  PowerLaw,        // Chung-Lu: endpoints drawn by power-law expected degree
+};
+
+enum class WeightModel {
+  WeightedCascade,  // 1 / in-degree of the target
+  Trivalency,       // uniformly one of 0.1, 0.01, 0.001
+  Uniform,          // the same probability everywhere
+};
+
+struct GeneratorOptions {
+  GraphModel model = GraphModel::ErdosRenyi;
+  int n = 0;
+  size_t m = 0;  // edges; about m for BarabasiAlbert, exact otherwise
+  double exponent = 2.5;                       // PowerLaw
+  std::array<double, 3> rmat{0.57, 0.19, 0.19};  // RMat a, b, c
+  seed_type seed = 1;
+};
+
+struct WeightOptions {
+  WeightModel model = WeightModel::WeightedCascade;
+  double probability = 0.1;  // Uniform
+  seed_type seed = 1;        // Trivalency
+};
+
+// "er", "ba", "rmat" or "powerlaw"
+[[nodiscard]] auto parse_graph_model(std::string_view name)
+    -> std::expected<GraphModel, error_t>;
+// "wc", "trivalency" or "uniform"
+[[nodiscard]] auto parse_weight_model(std::string_view name)
+    -> std::expected<WeightModel, error_t>;
+
+// Calls edge(u, v) for every edge, without self-loops; parallel edges may
+// occur
+template <typename Fn>
+auto generate_edges(const GeneratorOptions& options, Fn&& edge) -> void {
+  auto n = options.n;
+  assert(n >= 2);
+  RNG rng(options.seed);
+  auto vertex = [&] { return static_cast<int>(rng() % n); };
+
+  switch (options.model) {
+    case GraphModel::ErdosRenyi: {
+      for (size_t i = 0; i < options.m;) {
+        auto u = vertex();
+        auto v = vertex();
+        if (u != v) {
+          edge(u, v);
+          i++;
+        }
+      }
+      return;
+    }
+    case GraphModel::BarabasiAlbert: {
+      // every vertex attaches to `degree` earlier ones, picked from the
+      // endpoints of earlier edges, i.e. in proportion to their degree
+      auto degree = std::max<size_t>(1, options.m / (2 * n));
+      std::vector<int> endpoints;
+      endpoints.reserve(2 * degree * n);
+      for (int v = 1; v < n; v++) {
+        auto earlier = endpoints.size();  // those of v's edges excluded
+        for (size_t j = 0; j < std::min<size_t>(degree, v); j++) {
+          auto u = earlier == 0 ? 0 : endpoints[rng() % earlier];
+          edge(u, v);
+          edge(v, u);
+          endpoints.push_back(u);
+          endpoints.push_back(v);
+        }
+      }
+      return;
+    }
+    case GraphModel::RMat: {
+      auto [a, b, c] = options.rmat;
+      auto scale =
+          static_cast<int>(std::bit_width(static_cast<unsigned>(n - 1)));
+      for (size_t i = 0; i < options.m;) {
+        int u = 0;
+        int v = 0;
+        for (int level = 0; level < scale; level++) {
+          auto r = u01(rng);
+          u = 2 * u + (r >= a + b ? 1 : 0);
+          v = 2 * v + ((r >= a && r < a + b) || r >= a + b + c ? 1 : 0);
+        }
+        if (u < n && v < n && u != v) {
+          edge(u, v);
+          i++;
+        }
+      }
+      return;
+    }
+    case GraphModel::PowerLaw: {
+      // vertex i expects a degree proportional to (i + 1)^(-1 / (exponent -
+      // 1)), which gives degrees with a tail of that exponent
+      assert(options.exponent > 1);
+      std::vector<double> cumulative(n);
+      double total = 0;
+      for (int i = 0; i < n; i++) {
+        total += std::pow(i + 1.0, -1.0 / (options.exponent - 1));
+        cumulative[i] = total;
+      }
+      auto draw = [&] {
+        auto it = std::ranges::upper_bound(cumulative, u01(rng) * total);
+        return static_cast<int>(
+            std::min<std::ptrdiff_t>(it - cumulative.begin(), n - 1));
+      };
+      for (size_t i = 0; i < options.m;) {
+        auto u = draw();
+        auto v = draw();
+        if (u != v) {
+          edge(u, v);
+          i++;
+        }
+      }
+      return;
+    }
+  }
+  std::unreachable();
+}
+
+// Calls edge(u, v, weight) for every generated edge
+template <typename Fn>
+auto generate_weighted_edges(const GeneratorOptions& options,
+                             const WeightOptions& weights,
+                             Fn&& edge) -> void {
+  std::vector<int> in_degree;
+  if (weights.model == WeightModel::WeightedCascade) {
+    in_degree.assign(options.n, 0);
+    generate_edges(options, [&](int, int v) { in_degree[v]++; });
+  }
+  constexpr std::array trivalency{0.1, 0.01, 0.001};
+  std::uint64_t index = 0;
+  generate_edges(options, [&](int u, int v) {
+    switch (weights.model) {
+      case WeightModel::WeightedCascade:
+        edge(u, v, 1.0 / in_degree[v]);
+        break;
+      case WeightModel::Trivalency:
+        edge(u, v,
+             trivalency[static_cast<size_t>(
+                 hash_uniform(weights.seed, index) * trivalency.size())]);
+        break;
+      case WeightModel::Uniform:
+        edge(u, v, weights.probability);
+        break;
+    }
+    index++;
+  });
+}
+
+[[nodiscard]] auto generate_graph(const GeneratorOptions& options,
+                                  const WeightOptions& weights) -> Graph;
+
+// Streams the graph in the format parse_graph reads, without holding it
+auto write_generated_graph(std::ostream& out,
+                           const GeneratorOptions& options,
+                           const WeightOptions& weights) -> void;
+
+}  // namespace im
+
+using im::GeneratorOptions;
+using im::GraphModel;
+using im::WeightModel;
+using im::WeightOptions;
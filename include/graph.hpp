@@ -1,8 +1,10 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <expected>
 #include <istream>
+#include <ostream>
 #include <ranges>
 #include <string>
 #include <string_view>
@@ -65,11 +67,40 @@ inline auto Graph::get_edges() const
   return edges;
 }
 
+// Binary graph files start with this header, followed by the adjacency in
+// CSR form: n + 1 offsets of the vertices' first edges (uint64), then the m
+// targets (int32) and the m probabilities (double), in native byte order.
+// They load without parsing text, and are what bandit-im-prep writes.
+struct BinaryGraphHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t reserved;
+  std::uint64_t n;
+  std::uint64_t m;
+};
+
+static_assert(sizeof(BinaryGraphHeader) == 32);
+
+inline constexpr char binary_graph_magic[8] = {'I', 'M', 'G', 'R',
+                                               'A', 'P', 'H', '\0'};
+
 [[nodiscard]] auto parse_graph(std::istream& is)
     -> std::expected<Graph, error_t>;
+[[nodiscard]] auto parse_binary_graph(std::istream& is)
+    -> std::expected<Graph, error_t>;
+// A file name (text or binary, told apart by the header) or the content of
+// a text file
 [[nodiscard]] auto load_graph_expected(std::string_view source)
     -> std::expected<Graph, error_t>;
 
+// The text format parse_graph reads, and the binary one
+auto write_graph(std::ostream& os, const Graph& g) -> void;
+auto write_binary_graph(std::ostream& os, const Graph& g) -> void;
+
+// data/<dataset>/<dataset>.bin if it exists, else data/<dataset>/<dataset>.txt
+[[nodiscard]] auto dataset_graph_path(std::string_view dataset)
+    -> std::string;
+
 [[nodiscard]] auto load_graph(std::string_view source) -> Graph;
 [[nodiscard]] auto load_graph(std::istream& is) -> Graph;
 
@@ -3,17 +3,20 @@
 #include <algorithm>
 #include <cmath>
 #include <concepts>
-#include <format>
-#include <iostream>
 #include <limits>
 #include <ranges>
 #include <span>
 #include <vector>
 
+#include "counters.hpp"
 #include "diffusion.hpp"
 #include "graph.hpp"
 #include "log.hpp"
+#include "numa.hpp"
 #include "rng.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+#include "utility.hpp"
 
 namespace im {
 
@@ -46,7 +49,8 @@ template <SubmodularFn Fn>
   std::vector<char> selected(n, false);
   std::vector<int> result;
   for (int i = 1; i <= k; i++) {
-    my_log(std::format("greedy_submodular i: {}", i));
+    log_info("greedy_submodular i: {}", i);
+    TraceSpan span("greedy step", "i", i);
     int best = -1;
     double best_value = -std::numeric_limits<double>::infinity();
     for (int j = 0; j < n; j++) {
@@ -65,6 +69,7 @@ template <SubmodularFn Fn>
     if constexpr (Checkpointable<const Fn>) {
       f.checkpoint();
     }
+    count_step();
   }
   return result;
 }
@@ -79,13 +84,16 @@ template <SubmodularIncrementFn Fn>
   std::vector<int> result;
   int time = 0;
   for (int i = 1; i <= k; i++) {
-    my_log(std::format("greedy_lazy_forward i: {}", i));
+    log_info("greedy_lazy_forward i: {}", i);
+    TraceSpan span("greedy step", "i", i);
     auto now = ++time;
     int next_element = -1;
     while (true) {
       int max_ub =
           std::ranges::max_element(upper_bounds) - upper_bounds.begin();
       if (visited[max_ub] < now) {
+        count(Counter::LazyEvaluations);
+        TraceSpan evaluation("celf evaluate", "vertex", max_ub);
         auto value = f(std::vector{max_ub}, result);
         upper_bounds[max_ub] = value;
         visited[max_ub] = now;
@@ -103,6 +111,7 @@ template <SubmodularIncrementFn Fn>
     if constexpr (Checkpointable<const Fn>) {
       f.checkpoint();
     }
+    count_step();
   }
   return result;
 }
@@ -110,28 +119,48 @@ template <SubmodularIncrementFn Fn>
 // A wrapper of DiffusionSolver to be used as the reward function for
 // generic submodular optimization algorithms. It exposes a set-function
 // interface.
+// Every cascade of an evaluation draws from its own RNG stream, and with a
+// thread pool the cascades are spread over the workers with repeat_avg(),
+// so the values do not depend on the pool or its number of workers.
 struct DiffusionSubmodular {
   const Graph& g;
   DiffusionType type;
   int repeats;
+  ThreadPool* pool;
   mutable RNG rng;
   mutable int n_eval = 0;
   mutable std::vector<size_t> used_evals;
-  DiffusionSubmodular(const Graph& g, DiffusionType type, int repeats)
-      : g(g), type(type), repeats(repeats), rng() {}
+  DiffusionSubmodular(const Graph& g,
+                      DiffusionType type,
+                      int repeats,
+                      ThreadPool* pool = nullptr)
+      : g(g), type(type), repeats(repeats), pool(pool), rng() {}
   auto seed(seed_type seed) -> void { rng.seed(seed); }
 
   [[nodiscard]] auto operator()(std::span<const int> origin,
                                 std::span<const int> prepare = {}) const
       -> double {
     n_eval++;
-    auto solver = DiffusionSolver(g, rng());
-    double total = 0;
-    for (int i = 0; i < repeats; i++) {
-      auto result = solver.run(type, origin, prepare);
-      total += result;
+    auto base = rng();
+    auto cascade = [&](DiffusionSolver& solver, size_t i) {
+      solver.seed(base + static_cast<seed_type>(i));
+      return solver.run(type, origin, prepare);
+    };
+    auto n = static_cast<size_t>(repeats);
+    if (pool == nullptr) {
+      auto solver = DiffusionSolver(g, base);
+      double total = 0;
+      for (size_t i = 0; i < n; i++) {
+        total += cascade(solver, i);
+      }
+      return total / repeats;
     }
-    return total / repeats;
+    // a block's solver is made by the worker running it, on the graph
+    // replica of its NUMA node if there is one
+    return repeat_avg(
+        *pool, n,
+        [&](size_t) { return DiffusionSolver(numa_local(g), base); },
+        cascade);
   }
 
   [[nodiscard]] auto operator()(const std::vector<int>& origin,
@@ -166,20 +195,17 @@ struct DiffusionAlgoRun {
                    int k,
                    double eps,
                    double delta,
-                   const Algo& alg)
+                   const Algo& alg,
+                   ThreadPool* pool = nullptr)
       : n(g.n),
         k(k),
         eps(eps),
         delta(delta),
         alg(alg),
-        eval(g, diffusion_type, 1) {
-    std::cout << "n: " << g.n << std::endl;
-    std::cout << "eps: " << eps << std::endl;
-    std::cout << "delta: " << delta << std::endl;
-    std::cout << "repeats: "
-              << g.n * g.n / (eps * eps) * std::log(g.n * g.n / delta)
-              << std::endl;
+        eval(g, diffusion_type, 1, pool) {
     eval.repeats = g.n * g.n / (eps * eps) * std::log(g.n * g.n / delta);
+    log_info("n: {}, eps: {}, delta: {}, repeats: {}", g.n, eps, delta,
+             eval.repeats);
   }
 
   [[nodiscard]] auto run(seed_type seed) -> std::vector<int> {
@@ -207,7 +233,8 @@ DiffusionAlgoRun(const Graph& g,
                  int k,
                  double eps,
                  double delta,
-                 const Algo& alg) -> DiffusionAlgoRun<Algo>;
+                 const Algo& alg,
+                 ThreadPool* pool = nullptr) -> DiffusionAlgoRun<Algo>;
 
 }  // namespace im
 
@@ -1,10 +1,27 @@
 #pragma once
 
+#include "../bai.hpp"
 #include "../cbgreedy.hpp"
+#include "../compressed_graph.hpp"
+#include "../counters.hpp"
+#include "../daemon.hpp"
 #include "../diffusion.hpp"
+#include "../driver.hpp"
+#include "../evaluate.hpp"
+#include "../generate.hpp"
 #include "../graph.hpp"
 #include "../greedy.hpp"
 #include "../log.hpp"
+#include "../numa.hpp"
+#include "../prep.hpp"
+#include "../profiles.hpp"
+#include "../reorder.hpp"
+#include "../report.hpp"
+#include "../results.hpp"
 #include "../rng.hpp"
+#include "../sparsify.hpp"
+#include "../thread_pool.hpp"
+#include "../trace.hpp"
 #include "../ucb.hpp"
 #include "../utility.hpp"
+#include "../world.hpp"
@@ -1,13 +1,105 @@
 #pragma once
 
-#include <iostream>
+#include <cstdio>
+#include <format>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <utility>
 
-extern std::string identity;
+// Minimum level of the messages compiled in: 0 trace, 1 debug, 2 info,
+// 3 warn, 4 error
+#ifndef IM_LOG_LEVEL
+#define IM_LOG_LEVEL 2
+#endif
 
-inline auto my_log(std::string_view message) -> void {
-  std::cout << identity << ": " << message << '\n';
+namespace im {
+
+enum class LogLevel {
+  Trace,
+  Debug,
+  Info,
+  Warn,
+  Error,
+};
+
+inline constexpr auto min_log_level = static_cast<LogLevel>(IM_LOG_LEVEL);
+
+// Name of the run the thread works for, prefixed to its lines ("log" when
+// unset). ThreadPool workers take the identity of the thread that started
+// the loop.
+extern thread_local const std::string* current_log_identity;
+
+// Sets the identity of this thread until leaving scope
+struct LogIdentity {
+  std::string name;
+  const std::string* previous;
+
+  explicit LogIdentity(std::string name)
+      : name(std::move(name)),
+        previous(std::exchange(current_log_identity, &this->name)) {}
+  LogIdentity(const LogIdentity&) = delete;
+  auto operator=(const LogIdentity&) -> LogIdentity& = delete;
+  ~LogIdentity() { current_log_identity = previous; }
+};
+
+// Messages below this level are dropped before being formatted
+auto set_log_level(LogLevel level) -> void;
+[[nodiscard]] auto log_level() -> LogLevel;
+
+// "trace", "debug", "info", "warn" or "error"
+[[nodiscard]] auto parse_log_level(std::string_view name)
+    -> std::optional<LogLevel>;
+
+// Lines are queued in a ring buffer of the calling thread, which never
+// blocks (a full ring drops the line and counts it), and written to the
+// output by a background thread
+auto log_line(std::string_view message) -> void;
+
+// Writes all queued lines; the output is stdout by default
+auto flush_log() -> void;
+auto set_log_output(std::FILE* output) -> void;
+
+template <LogLevel level, typename... Args>
+auto log_at(std::format_string<Args...> format, Args&&... args) -> void {
+  if constexpr (level >= min_log_level) {
+    if (level >= log_level()) {
+      log_line(std::format(format, std::forward<Args>(args)...));
+    }
+  }
 }
 
-inline auto set_identity(std::string_view id) -> void { identity = id; }
+template <typename... Args>
+auto log_trace(std::format_string<Args...> format, Args&&... args) -> void {
+  log_at<LogLevel::Trace>(format, std::forward<Args>(args)...);
+}
+
+template <typename... Args>
+auto log_debug(std::format_string<Args...> format, Args&&... args) -> void {
+  log_at<LogLevel::Debug>(format, std::forward<Args>(args)...);
+}
+
+template <typename... Args>
+auto log_info(std::format_string<Args...> format, Args&&... args) -> void {
+  log_at<LogLevel::Info>(format, std::forward<Args>(args)...);
+}
+
+template <typename... Args>
+auto log_warn(std::format_string<Args...> format, Args&&... args) -> void {
+  log_at<LogLevel::Warn>(format, std::forward<Args>(args)...);
+}
+
+template <typename... Args>
+auto log_error(std::format_string<Args...> format, Args&&... args) -> void {
+  log_at<LogLevel::Error>(format, std::forward<Args>(args)...);
+}
+
+}  // namespace im
+
+using im::LogIdentity;
+using im::LogLevel;
+using im::log_debug;
+using im::log_error;
+using im::log_info;
+using im::log_trace;
+using im::log_warn;
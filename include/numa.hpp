@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <expected>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "graph.hpp"
+
+namespace im {
+
+// NUMA placement without libnuma: nodes and their CPUs are read from sysfs,
+// and threads and memory are bound with the raw sched_setaffinity and
+// set_mempolicy system calls.
+struct NumaNode {
+  int id;
+  std::vector<int> cpus;
+};
+
+struct NumaTopology {
+  std::vector<NumaNode> nodes;
+
+  // One node with every CPU when sysfs has no nodes
+  [[nodiscard]] static auto detect() -> NumaTopology;
+};
+
+// "0-3,8,10-11"
+[[nodiscard]] auto parse_cpu_list(std::string_view text)
+    -> std::expected<std::vector<int>, error_t>;
+
+// Pins the calling thread to the CPUs of topology.nodes[node], and makes
+// numa_local() return that node's replicas for it
+[[nodiscard]] auto pin_to_node(const NumaTopology& topology, size_t node)
+    -> std::expected<void, error_t>;
+
+// Copies of a read-only graph, one per node, each allocated and first
+// touched by a thread bound to its node. While they live, threads pinned by
+// pin_to_node() read the copy of their node through numa_local(). With a
+// single node nothing is copied.
+struct GraphReplicas {
+  const Graph& original;
+  std::vector<std::unique_ptr<Graph>> replicas;  // per node
+
+  GraphReplicas(const Graph& g, const NumaTopology& topology);
+  ~GraphReplicas();
+
+  GraphReplicas(const GraphReplicas&) = delete;
+  auto operator=(const GraphReplicas&) -> GraphReplicas& = delete;
+};
+
+// The replica of g, or of the graph g is a replica of, on the calling
+// thread's node; otherwise g itself
+[[nodiscard]] auto numa_local(const Graph& g) -> const Graph&;
+
+}  // namespace im
+
+using im::GraphReplicas;
+using im::NumaNode;
+using im::NumaTopology;
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <istream>
+#include <ostream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "graph.hpp"
+#include "rng.hpp"
+
+namespace im {
+
+// Turning raw edge lists (SNAP style: "u v" or "u v p" per line, '#' or '%'
+// comments, any vertex ids) into graphs bandit-im loads.
+
+enum class PrepWeights {
+  Input,            // the probabilities of the input's third column
+  WeightedCascade,  // 1 / in-degree of the target
+  Trivalency,       // uniformly one of 0.1, 0.01, 0.001
+  Uniform,          // the same probability everywhere
+  LinearThreshold,  // the input's, scaled to sum to 1 into every vertex
+};
+
+struct PrepOptions {
+  PrepWeights weights = PrepWeights::Input;
+  double probability = 0.1;  // Uniform
+  seed_type seed = 1;        // Trivalency
+  bool undirected = false;   // every input edge in both directions
+  double exponent = 1;       // the probabilities are raised to it
+};
+
+// "input", "wc", "trivalency", "uniform" or "lt"
+[[nodiscard]] auto parse_prep_weights(std::string_view name)
+    -> std::expected<PrepWeights, error_t>;
+
+// Dense vertex ids 0..n-1 for the input's ids, given in order of first
+// appearance. Saved as one input id per line, line i holding the id of
+// vertex i, and loaded again before preparing another file of the same
+// vertices (e.g. other probabilities), which then keeps their dense ids.
+struct IdMap {
+  std::unordered_map<std::uint64_t, int> dense;
+  std::vector<std::uint64_t> original;
+
+  [[nodiscard]] auto size() const -> int {
+    return static_cast<int>(original.size());
+  }
+
+  // The dense id of an input id, assigning the next one if it is new
+  auto id(std::uint64_t input) -> int {
+    auto [it, added] = dense.try_emplace(input, size());
+    if (added) {
+      original.push_back(input);
+    }
+    return it->second;
+  }
+};
+
+[[nodiscard]] auto parse_id_map(std::istream& is)
+    -> std::expected<IdMap, error_t>;
+auto write_id_map(std::ostream& os, const IdMap& ids) -> void;
+
+// What prepare_graph did with the input
+struct PrepStats {
+  size_t lines = 0;       // edge lines read
+  size_t self_loops = 0;  // dropped
+  size_t merged = 0;      // parallel edges merged into another one
+  size_t zero = 0;        // dropped for a zero probability
+};
+
+struct PreparedGraph {
+  Graph graph;
+  PrepStats stats;
+};
+
+// Streams an edge list into a graph on the dense ids of `ids`, adding the
+// new ones. Parallel edges are merged into one with probability
+// 1 - prod(1 - p), the chance that at least one of them fires; then
+// self-loops and zero-probability edges are dropped, the weight model is
+// applied and the probabilities are raised to options.exponent (for
+// PrepWeights::LinearThreshold before the scaling, which keeps the sums
+// into every vertex at 1). The
+// out-edges of every vertex are sorted by target. A missing probability
+// column counts as 1, except for PrepWeights::Input, which needs it.
+[[nodiscard]] auto prepare_graph(std::istream& is,
+                                 IdMap& ids,
+                                 const PrepOptions& options)
+    -> std::expected<PreparedGraph, error_t>;
+
+}  // namespace im
+
+using im::IdMap;
+using im::PrepOptions;
+using im::PrepWeights;
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "counters.hpp"
+#include "diffusion.hpp"
+#include "evaluate.hpp"
+#include "graph.hpp"
+#include "rng.hpp"
+#include "thread_pool.hpp"
+
+namespace im {
+
+// One topology under several named probability profiles, e.g. congress.txt
+// and congress_orig.txt. The adjacency lists are stored once, in graph,
+// with the probabilities of the profile in use. The probabilities of all
+// profiles are kept by edge id, the ids numbering the edges vertex by vertex
+// in adjacency order, and the profiles of one edge are adjacent, which is
+// the order in which MultiProfileSolver reads them.
+struct ProfileGraph {
+  static constexpr size_t max_profiles = 64;
+
+  Graph graph{0};
+  std::vector<std::string> names;
+  std::vector<weight_t> weights;  // weights[e * profiles() + p]
+  std::vector<size_t> first_edge;  // id of every vertex's first edge, and m
+  size_t current = 0;              // profile whose weights graph holds
+
+  [[nodiscard]] auto profiles() const -> size_t { return names.size(); }
+  [[nodiscard]] auto find(std::string_view name) const
+      -> std::optional<size_t>;
+
+  [[nodiscard]] auto weight(size_t e, size_t profile) const -> weight_t {
+    return weights[e * profiles() + profile];
+  }
+
+  // Writes the weights of a profile into graph, for the selection
+  // algorithms, which run on a Graph
+  auto use(size_t profile) -> void;
+
+  // u's out-edges with the weights of one profile
+  struct Edges {
+    const Edge* edges;
+    const weight_t* weights;  // of the first edge
+    size_t stride;            // the number of profiles
+    size_t degree;
+
+    struct Iterator {
+      using value_type = Edge;
+      using difference_type = std::ptrdiff_t;
+
+      const Edge* edge = nullptr;
+      const weight_t* weight = nullptr;
+      size_t stride = 1;
+
+      [[nodiscard]] auto operator*() const -> Edge {
+        return {edge->to, *weight};
+      }
+      auto operator++() -> Iterator& {
+        ++edge;
+        weight += stride;
+        return *this;
+      }
+      auto operator++(int) -> Iterator {
+        auto copy = *this;
+        ++*this;
+        return copy;
+      }
+      [[nodiscard]] friend auto operator==(const Iterator& a,
+                                           const Iterator& b) -> bool {
+        return a.edge == b.edge;
+      }
+    };
+
+    [[nodiscard]] auto size() const -> size_t { return degree; }
+    [[nodiscard]] auto begin() const -> Iterator {
+      return {edges, weights, stride};
+    }
+    [[nodiscard]] auto end() const -> Iterator {
+      return {edges + degree, nullptr, stride};
+    }
+  };
+
+  // The graph under one profile, whichever is in use: BasicDiffusionSolver
+  // runs on it like on a Graph, and keeps a reference, so the view must
+  // outlive the solver
+  struct View {
+    const ProfileGraph* g;
+    size_t profile;
+    int n;
+
+    [[nodiscard]] auto operator[](int u) const -> Edges {
+      const auto& edges = g->graph.adj[u];
+      auto P = g->profiles();
+      return {edges.data(), g->weights.data() + g->first_edge[u] * P + profile,
+              P, edges.size()};
+    }
+  };
+
+  [[nodiscard]] auto profile(size_t p) const -> View {
+    return {this, p, graph.n};
+  }
+};
+
+// Reads the profiles from (name, source) pairs, a source being a file name
+// or the content of one as for load_graph_expected. The first gives the
+// topology; the others must list the same edges in the same order, and only
+// their probabilities are kept.
+[[nodiscard]] auto load_profile_graph(
+    std::span<const std::pair<std::string, std::string>> sources)
+    -> std::expected<ProfileGraph, error_t>;
+
+// Cascades from one seed set under all profiles in a single traversal. A
+// vertex carries the set of profiles it is active in, and a reached edge is
+// read once for all of its source's new profiles. Each profile flips its
+// own coin for the edge by comparing one uniform draw with its probability
+// (under LT, each compares one threshold per vertex with its own sum of
+// weights), so every profile's cascades are distributed as under
+// DiffusionSolver on that profile. Sharing the draw couples the profiles:
+// with similar probabilities they activate the same vertices at the same
+// time, which a vertex then spreads once for all of them, and the
+// differences between profiles are estimated with less variance.
+struct MultiProfileSolver {
+  using mask_t = std::uint64_t;
+
+  struct VertexState {
+    size_t last_reached = 0;
+    mask_t active = 0;   // profiles the vertex is active in
+    mask_t pending = 0;  // of those, the ones it has not spread yet
+    double threshold = -1;  // LT, drawn when first reached; -1 if not yet
+  };
+
+  const ProfileGraph& g;
+  RNG rng;
+  size_t times = 0;
+  size_t probes = 0;  // edges read so far, once for all profiles
+  std::vector<VertexState> states;
+  std::vector<double> sums;  // LT: weights of active in-edges, per profile
+  std::vector<int> queue;
+
+  MultiProfileSolver(const ProfileGraph& g, seed_type seed)
+      : g(g), rng(seed), states(g.graph.n) {}
+
+  auto seed(seed_type seed) -> void { rng.seed(seed); }
+
+ private:
+  auto reach(int v, size_t now) -> VertexState& {
+    auto& state = states[v];
+    if (state.last_reached < now) {
+      state = {now, 0, 0, -1};
+    }
+    return state;
+  }
+
+  auto activate(int v, mask_t profiles, std::span<double> sizes) -> void {
+    auto& state = states[v];
+    if (state.pending == 0) {
+      queue.push_back(v);
+    }
+    state.active |= profiles;
+    state.pending |= profiles;
+    for (auto left = profiles; left != 0; left &= left - 1) {
+      sizes[std::countr_zero(left)]++;
+    }
+  }
+
+  // The profiles in which edge e activates v
+  [[nodiscard]] auto flip(DiffusionType type,
+                          int v,
+                          VertexState& state,
+                          size_t e,
+                          mask_t candidates,
+                          size_t& draws) -> mask_t {
+    auto P = g.profiles();
+    const auto* weights = g.weights.data() + e * P;
+    mask_t activated = 0;
+    if (type == DiffusionType::IndependentCascade) {
+      auto coin = u01(rng);
+      draws++;
+      for (auto left = candidates; left != 0; left &= left - 1) {
+        auto p = std::countr_zero(left);
+        if (coin < weights[p]) {
+          activated |= mask_t{1} << p;
+        }
+      }
+      return activated;
+    }
+    auto* sum = sums.data() + static_cast<size_t>(v) * P;
+    if (state.threshold < 0) {
+      state.threshold = u01(rng);
+      draws++;
+      std::fill(sum, sum + P, 0.0);
+    }
+    for (auto left = candidates; left != 0; left &= left - 1) {
+      auto p = std::countr_zero(left);
+      sum[p] += weights[p];
+      if (sum[p] >= state.threshold) {
+        activated |= mask_t{1} << p;
+      }
+    }
+    return activated;
+  }
+
+ public:
+  // Writes the cascade size under every profile into sizes
+  auto run(DiffusionType type,
+           std::span<const int> origin,
+           std::span<double> sizes) -> void {
+    auto P = g.profiles();
+    if (type == DiffusionType::LinearThreshold && sums.empty()) {
+      sums.resize(static_cast<size_t>(g.graph.n) * P);
+    }
+    auto all = P == ProfileGraph::max_profiles ? ~mask_t{0}
+                                               : (mask_t{1} << P) - 1;
+    auto now = ++times;
+    auto probes_before = probes;
+    size_t draws = 0;
+    std::fill(sizes.begin(), sizes.begin() + static_cast<std::ptrdiff_t>(P),
+              0.0);
+    queue.clear();
+
+    for (auto u : origin) {
+      auto fresh = all & ~reach(u, now).active;
+      if (fresh != 0) {
+        activate(u, fresh, sizes);
+      }
+    }
+    // a vertex is queued again when it becomes active in more profiles
+    // after it was spread
+    for (size_t head = 0; head < queue.size(); head++) {
+      auto u = queue[head];
+      auto spreading = std::exchange(states[u].pending, 0);
+      const auto& edges = g.graph.adj[u];
+      auto e = g.first_edge[u];
+      probes += edges.size();
+      for (const auto& edge : edges) {
+        auto v = edge.to;
+        auto& state = reach(v, now);
+        auto candidates = spreading & ~state.active;
+        if (candidates != 0) {
+          auto activated = flip(type, v, state, e, candidates, draws);
+          if (activated != 0) {
+            activate(v, activated, sizes);
+          }
+        }
+        e++;
+      }
+    }
+    count(Counter::Cascades);
+    count(Counter::EdgesProbed, probes - probes_before);
+    count(Counter::RngDraws, draws);
+  }
+
+  [[nodiscard]] auto run(DiffusionType type, std::span<const int> origin)
+      -> std::vector<double> {
+    std::vector<double> sizes(g.profiles());
+    run(type, origin, sizes);
+    return sizes;
+  }
+};
+
+// The influence of every seed list under every profile, as stats[list]
+// [profile], sampled with MultiProfileSolver until every estimate meets the
+// target. Worlds are simulated in chunks of 64 seeded by their index, in
+// parallel with a pool, and merged in order, so the estimates do not depend
+// on the number of workers. The target is checked after 100 worlds and then
+// at counts growing by 1.25, as for PrefixEvaluator.
+[[nodiscard]] auto evaluate_profiles(const ProfileGraph& g,
+                                     DiffusionType type,
+                                     const std::vector<std::vector<int>>& lists,
+                                     seed_type seed,
+                                     ConfidenceTarget target,
+                                     ThreadPool* pool)
+    -> std::vector<std::vector<RunningStats>>;
+
+}  // namespace im
+
+using im::MultiProfileSolver;
+using im::ProfileGraph;
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <expected>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "graph.hpp"
+
+namespace im {
+
+// Relabelings of the vertices that put vertices visited together next to
+// each other, so a cascade touches fewer cache lines of the adjacency and
+// per-vertex arrays
+enum class VertexOrder {
+  Original,
+  Degree,  // by decreasing in+out degree: the hubs most cascades reach first
+  Rcm,     // reverse Cuthill-McKee on the undirected graph: BFS levels
+};
+
+// "none", "degree" or "rcm"
+[[nodiscard]] auto parse_vertex_order(std::string_view name)
+    -> std::expected<VertexOrder, error_t>;
+
+// Ids of the reordered graph against the ids of the input file. Seeds are
+// selected on graph ids and saved and loaded in input ids.
+struct VertexPermutation {
+  std::vector<int> to_graph;     // input id -> graph id
+  std::vector<int> to_original;  // graph id -> input id
+
+  [[nodiscard]] auto original(std::span<const int> ids) const
+      -> std::vector<int>;
+  [[nodiscard]] auto graph(std::span<const int> ids) const
+      -> std::vector<int>;
+};
+
+[[nodiscard]] auto vertex_order(const Graph& g, VertexOrder order)
+    -> VertexPermutation;
+
+// g with vertex v renamed to permutation.to_graph[v], every adjacency list
+// sorted by target
+[[nodiscard]] auto reorder_graph(const Graph& g,
+                                 const VertexPermutation& permutation)
+    -> Graph;
+
+}  // namespace im
+
+using im::VertexOrder;
+using im::VertexPermutation;
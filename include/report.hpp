@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "evaluate.hpp"
+#include "results.hpp"
+
+namespace im {
+
+// A median with its distribution-free 95% confidence interval (order
+// statistics); NaN when there are no values
+struct MedianEstimate {
+  double median;
+  double low;
+  double high;
+};
+
+[[nodiscard]] auto median_estimate(std::vector<double> values)
+    -> MedianEstimate;
+
+// What the selections of one algorithm cost, over all of its runs in a
+// store, and how good their seeds are, over the runs that were evaluated
+struct AlgoReport {
+  std::string alg;
+  size_t runs;
+  MedianEstimate seconds;
+  MedianEstimate samples;
+  MedianEstimate peak_rss_mib;  // over the runs that recorded it
+  std::vector<RunningStats> influence;  // of every prefix, across runs
+  double influence_per_second;  // of the longest prefix, per median second
+  bool frontier;  // no other algorithm is as fast and as good, and better
+};
+
+// One report per algorithm, in the order of their names
+[[nodiscard]] auto summarize_results(const ResultReader& store)
+    -> std::vector<AlgoReport>;
+
+auto write_report_json(std::ostream& out,
+                       const std::vector<AlgoReport>& reports) -> void;
+
+// One line per algorithm and prefix:
+// alg,prefix,runs,evaluated_runs,influence_mean,influence_half_width,
+// seconds_median,seconds_low,seconds_high,samples_median,samples_low,
+// samples_high,peak_rss_mib_median,influence_per_second,frontier
+auto write_report_csv(std::ostream& out,
+                      const std::vector<AlgoReport>& reports) -> void;
+
+}  // namespace im
+
+using im::AlgoReport;
+using im::MedianEstimate;
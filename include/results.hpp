@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "driver.hpp"
+#include "evaluate.hpp"
+#include "graph.hpp"
+
+namespace im {
+
+// The results of all runs on a dataset live in one append-only file,
+// results/<dataset>.imr: a header followed by fixed-size records, one per
+// seed of a selection or per prefix of an evaluation. All records of a run
+// are appended with a single write under an exclusive flock, so concurrent
+// processes never interleave them. An index next to it, <store>.idx, lists
+// where the records of every run are; it is appended under the same lock,
+// so that readers find a run without reading the whole store.
+
+enum class RecordKind : std::uint32_t {
+  Selection = 1,
+  Evaluation = 2,
+};
+
+inline constexpr size_t max_alg_name = 32;
+
+struct ResultRecord {
+  RecordKind kind;
+  std::int32_t run;
+  char alg[max_alg_name];  // zero-padded
+  std::uint32_t step;      // index of the seed, or length of the prefix - 1
+  std::uint32_t steps;     // records of this run and algorithm
+  std::int32_t vertex;     // Selection: the seed
+  std::uint32_t peak_rss_kib;  // Selection: peak resident set, 0 if unknown
+  std::uint64_t used_samples;  // Selection: samples used up to this seed
+  double mean;                 // Evaluation: influence of the prefix
+  double half_width;
+  std::uint64_t worlds;
+  double seconds;  // wall-clock time of the whole selection or evaluation
+};
+
+static_assert(std::is_trivially_copyable_v<ResultRecord>);
+static_assert(sizeof(ResultRecord) == 96);
+
+struct ResultHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t record_size;
+};
+
+static_assert(sizeof(ResultHeader) == 16);
+
+inline constexpr ResultHeader result_header{{'I', 'M', 'R', 'E', 'S', 'U', 'L',
+                                             'T'},
+                                            1,
+                                            sizeof(ResultRecord)};
+
+// Where the records of one (kind, run, algorithm) start in the store
+struct IndexEntry {
+  RecordKind kind;
+  std::int32_t run;
+  char alg[max_alg_name];  // zero-padded
+  std::uint64_t first;     // number of the first record
+  std::uint64_t steps;
+};
+
+static_assert(std::is_trivially_copyable_v<IndexEntry>);
+static_assert(sizeof(IndexEntry) == 56);
+
+struct IndexHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t entry_size;
+  std::uint64_t records;  // records of the store the entries cover
+};
+
+static_assert(sizeof(IndexHeader) == 24);
+
+inline constexpr IndexHeader index_header{{'I', 'M', 'R', 'I', 'N', 'D', 'E',
+                                           'X'},
+                                          1,
+                                          sizeof(IndexEntry),
+                                          0};
+
+[[nodiscard]] auto results_path(std::string_view dataset) -> std::string;
+
+// The index of the store at store_path
+[[nodiscard]] auto index_path(std::string_view store_path) -> std::string;
+
+// Work counters of the selections, one JSON line per run and algorithm
+// (see counters.hpp), next to the store: results/<dataset>.counters.jsonl
+[[nodiscard]] auto counters_path(std::string_view dataset) -> std::string;
+
+// Evaluations under several weight profiles, one JSON line per run and
+// algorithm (see profiles.hpp): results/<dataset>.profiles.jsonl
+[[nodiscard]] auto profiles_path(std::string_view dataset) -> std::string;
+
+[[nodiscard]] auto selection_records(int run,
+                                     const AlgoResult& result,
+                                     double seconds,
+                                     std::uint32_t peak_rss_kib = 0)
+    -> std::expected<std::vector<ResultRecord>, error_t>;
+
+[[nodiscard]] auto evaluation_records(int run,
+                                      std::string_view alg,
+                                      const std::vector<RunningStats>& stats,
+                                      double seconds)
+    -> std::expected<std::vector<ResultRecord>, error_t>;
+
+// Appends the records in one write, creating the file if needed, and then
+// their runs to the index. A torn record left by a crashed writer is cut off
+// first; records the index misses (a store written without it, or a writer
+// that died in between) are indexed along with the new ones.
+[[nodiscard]] auto append_records(const std::string& path,
+                                  std::span<const ResultRecord> records)
+    -> std::expected<void, error_t>;
+
+// Appends the lines in one write under the same lock
+[[nodiscard]] auto append_lines(const std::string& path, std::string_view lines)
+    -> std::expected<void, error_t>;
+
+// The cost of one selection
+struct SelectionCost {
+  double seconds;
+  std::uint64_t samples;
+  std::uint32_t peak_rss_kib;
+};
+
+// One evaluated prefix
+struct PrefixEstimate {
+  double mean;
+  double half_width;
+  size_t worlds;
+};
+
+// The runs of a store, indexed by (kind, run, algorithm). When a run of an
+// algorithm was appended several times, the last append wins. Opening reads
+// the index and only the records appended after it; the records of a run
+// are read when it is asked for, as appended records never change.
+struct ResultReader {
+  std::string path;
+  size_t record_count = 0;  // in the store when opened
+
+  [[nodiscard]] static auto open(const std::string& path)
+      -> std::expected<ResultReader, error_t>;
+
+  [[nodiscard]] auto selection(int run, std::string_view alg) const
+      -> std::optional<AlgoResult>;
+  [[nodiscard]] auto selection_cost(int run, std::string_view alg) const
+      -> std::optional<SelectionCost>;
+  [[nodiscard]] auto evaluation(int run, std::string_view alg) const
+      -> std::optional<std::vector<PrefixEstimate>>;
+
+  // (run, algorithm) pairs with a selection, in order
+  [[nodiscard]] auto runs() const -> std::vector<std::pair<int, std::string>>;
+
+  // One line per seed of every selection, with its evaluation if any:
+  // run,alg,step,vertex,used_samples,select_seconds,eval_mean,
+  // eval_half_width,eval_worlds,eval_seconds,select_peak_rss_kib (step
+  // counts from 1)
+  auto write_csv(std::ostream& out) const -> void;
+
+ private:
+  // first record and count of each (kind, run, algorithm)
+  std::map<std::tuple<RecordKind, int, std::string>, std::pair<size_t, size_t>>
+      index;
+
+  [[nodiscard]] auto find(RecordKind kind, int run, std::string_view alg) const
+      -> std::vector<ResultRecord>;
+};
+
+}  // namespace im
+
+using im::IndexEntry;
+using im::PrefixEstimate;
+using im::RecordKind;
+using im::ResultReader;
+using im::ResultRecord;
+using im::SelectionCost;
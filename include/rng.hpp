@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 #include "stdfin/random/threefry_engine.hpp"
 
 namespace im {
@@ -7,7 +9,23 @@ namespace im {
 using RNG = stdfin::threefry_13_64;
 using seed_type = RNG::result_type;
 
+// splitmix64's finalizer
+[[nodiscard]] constexpr auto mix64(std::uint64_t x) -> std::uint64_t {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+// Counter-based uniform draw in [0, 1): the same (key, counter) always gives
+// the same value, so separate passes over one random outcome agree on it
+[[nodiscard]] constexpr auto hash_uniform(std::uint64_t key,
+                                          std::uint64_t counter) -> double {
+  auto bits = mix64(key + mix64(counter + 0x9e3779b97f4a7c15ULL));
+  return static_cast<double>(bits >> 11) * 0x1.0p-53;
+}
+
 } // namespace im
 
 using RNG = im::RNG;
 using seed_type = im::seed_type;
+using im::hash_uniform;
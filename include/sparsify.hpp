@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <expected>
+#include <string_view>
+#include <vector>
+
+#include "diffusion.hpp"
+#include "graph.hpp"
+#include "rng.hpp"
+#include "thread_pool.hpp"
+
+namespace im {
+
+// Smaller graphs for exploratory runs: selection on a graph with a fraction
+// of the edges is about as much faster, as cascades cost their edges.
+
+enum class SparsifyMethod {
+  Probability,   // keeps the most probable edges
+  Contribution,  // keeps the edges (u, v) with the largest p * sigma(v)
+};
+
+struct SparsifyOptions {
+  size_t edges = 0;  // edges to keep
+  SparsifyMethod method = SparsifyMethod::Contribution;
+  DiffusionType type = DiffusionType::IndependentCascade;
+  size_t samples = 64;  // cascades per vertex estimating sigma(v)
+  seed_type seed = 1;
+};
+
+// "probability" or "contribution"
+[[nodiscard]] auto parse_sparsify_method(std::string_view name)
+    -> std::expected<SparsifyMethod, error_t>;
+
+struct SparsifiedGraph {
+  Graph graph;
+  // Upper bound on how much less any seed set influences in graph than in
+  // the input, estimated as the sum of p * sigma(v) over the removed edges
+  // (u, v): the activations lost are those reached only through a removed
+  // edge that fires, i.e. chosen as v's live in-edge under LT, and each
+  // such edge loses at most the vertices reached from v
+  double error_bound = 0;
+  std::vector<double> influence;  // sigma(v) estimated on the input
+};
+
+// Keeps options.edges edges of g, each vertex's in their order. sigma(v),
+// the expected influence of v alone, is estimated with options.samples
+// cascades per vertex, seeded per vertex so that the result does not
+// depend on the pool. Removing the edges of least p * sigma(v) first makes
+// the error bound as small as this estimate allows.
+[[nodiscard]] auto sparsify_graph(const Graph& g,
+                                  const SparsifyOptions& options,
+                                  ThreadPool* pool) -> SparsifiedGraph;
+
+}  // namespace im
+
+using im::SparsifiedGraph;
+using im::SparsifyMethod;
+using im::SparsifyOptions;
@@ -0,0 +1,358 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "counters.hpp"
+#include "log.hpp"
+#include "trace.hpp"
+
+namespace im {
+
+struct ThreadPool;
+
+// A set of tasks forked on a pool and joined by wait(). Tasks may fork and
+// join groups of their own. A task runs under the log identity and run
+// counters of the thread that made the group.
+struct TaskGroup {
+  explicit TaskGroup(ThreadPool& pool)
+      : pool(pool),
+        identity(current_log_identity),
+        counters(current_counters) {}
+
+  TaskGroup(const TaskGroup&) = delete;
+  auto operator=(const TaskGroup&) -> TaskGroup& = delete;
+
+  // waits for tasks still running, e.g. after an exception between spawn()
+  // and wait(); their exceptions are dropped
+  ~TaskGroup() {
+    if (pending.load(std::memory_order_acquire) > 0) {
+      try {
+        wait();
+      } catch (...) {
+      }
+    }
+  }
+
+  // Forks fn(worker); worker is in [0, pool.size()). Only the thread that
+  // made the group spawns into it.
+  template <typename Fn>
+  auto spawn(Fn&& fn) -> void;
+
+  // Runs tasks of the group until all of them returned, and rethrows the
+  // first exception
+  auto wait() -> void;
+
+ private:
+  friend struct ThreadPool;
+
+  ThreadPool& pool;
+  const std::string* identity;
+  RunCounters* counters;
+  std::atomic<size_t> pending = 0;
+  std::atomic<bool> cancelled = false;  // tasks not started yet are skipped
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  std::deque<std::function<void(size_t)>> spawned;  // stable addresses
+
+  auto fail(std::exception_ptr e) -> void {
+    std::scoped_lock lock(error_mutex);
+    if (!error) {
+      error = std::move(e);
+    }
+    cancelled.store(true, std::memory_order_relaxed);
+  }
+};
+
+// A fixed set of worker threads with work stealing.
+// Every worker owns a deque of tasks: it pushes the tasks it forks on the
+// back and takes its next task from the back, while idle workers steal from
+// the front of the others, where the largest pieces of work wait. A parallel
+// loop is one task over its whole range that splits itself in halves, so
+// uneven iterations (e.g. cascades from hubs and leaves) still balance
+// across workers.
+// The calling thread takes part as worker 0, so ThreadPool(1) starts no
+// threads; only one thread outside the pool may use it at a time. Loops and
+// task groups may nest: a thread waiting for a group only runs tasks of that
+// group meanwhile, so a worker never runs two iterations of the same loop at
+// once and per-worker scratch stays private.
+// Every started thread first calls on_start(worker), e.g. to pin itself.
+struct ThreadPool {
+  explicit ThreadPool(size_t threads = std::thread::hardware_concurrency(),
+                      std::function<void(size_t)> on_start = {})
+      : n_workers(threads == 0 ? 1 : threads), queues(n_workers) {
+    workers.reserve(n_workers - 1);
+    for (size_t w = 1; w < n_workers; w++) {
+      workers.emplace_back([this, w, on_start] {
+        if (on_start) {
+          on_start(w);
+        }
+        worker_loop(w);
+      });
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+
+  ~ThreadPool() {
+    {
+      std::scoped_lock lock(sleep_mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  [[nodiscard]] auto size() const -> size_t { return n_workers; }
+
+  // The worker the calling thread runs as: its index for pool threads, 0
+  // for the thread using the pool
+  [[nodiscard]] auto this_worker() const -> size_t {
+    return current_pool == this ? current_worker : 0;
+  }
+
+  // Calls fn(worker, i) for every i in [0, n); worker is in [0, size()).
+  // Blocks until all calls returned, and rethrows the first exception.
+  template <typename Fn>
+  auto parallel_for(size_t n, Fn&& fn) -> void {
+    if (n == 0) {
+      return;
+    }
+    auto worker = this_worker();
+    if (n_workers == 1 || n == 1) {
+      for (size_t i = 0; i < n; i++) {
+        fn(worker, i);
+      }
+      return;
+    }
+
+    TraceSpan span("parallel_for", "n", static_cast<std::int64_t>(n));
+    TaskGroup group(*this);
+    group.pending.store(1, std::memory_order_relaxed);
+    execute(worker, Task{&group, &call_index<Fn>, &fn, 0, n});
+    group.wait();
+  }
+
+ private:
+  friend struct TaskGroup;
+
+  // Iterations [first, last) of a loop, or a spawned function (one
+  // iteration, the function being the body)
+  struct Task {
+    TaskGroup* group;
+    void (*run)(void* body, size_t worker, size_t i);
+    void* body;
+    size_t first;
+    size_t last;
+  };
+
+  struct alignas(64) Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  static inline thread_local const ThreadPool* current_pool = nullptr;
+  static inline thread_local size_t current_worker = 0;
+
+  size_t n_workers;
+  std::vector<Queue> queues;
+  std::vector<std::jthread> workers;
+  std::atomic<size_t> queued = 0;  // tasks in all queues
+  std::atomic<size_t> sleepers = 0;
+  std::mutex sleep_mutex;
+  std::condition_variable wake;    // idle workers
+  std::condition_variable joined;  // threads waiting for a group
+  bool stopping = false;
+
+  template <typename Fn>
+  static auto call_index(void* body, size_t worker, size_t i) -> void {
+    (*static_cast<std::remove_reference_t<Fn>*>(body))(worker, i);
+  }
+
+  static auto call_spawned(void* body, size_t worker, size_t) -> void {
+    (*static_cast<std::function<void(size_t)>*>(body))(worker);
+  }
+
+  auto push(size_t worker, Task task) -> void {
+    {
+      std::scoped_lock lock(queues[worker].mutex);
+      queues[worker].tasks.push_back(task);
+    }
+    queued.fetch_add(1);
+    if (sleepers.load() > 0) {
+      { std::scoped_lock lock(sleep_mutex); }
+      wake.notify_one();
+    }
+  }
+
+  // The back of the worker's own queue, else the front of another one;
+  // only tasks of `group` unless it is null
+  auto take(size_t worker, const TaskGroup* group) -> std::optional<Task> {
+    auto matches = [&](const Task& task) {
+      return group == nullptr || task.group == group;
+    };
+    {
+      auto& own = queues[worker];
+      std::scoped_lock lock(own.mutex);
+      if (!own.tasks.empty() && matches(own.tasks.back())) {
+        auto task = own.tasks.back();
+        own.tasks.pop_back();
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        return task;
+      }
+    }
+    for (size_t offset = 1; offset < n_workers; offset++) {
+      auto& victim = queues[(worker + offset) % n_workers];
+      std::scoped_lock lock(victim.mutex);
+      if (!victim.tasks.empty() && matches(victim.tasks.front())) {
+        auto task = victim.tasks.front();
+        victim.tasks.pop_front();
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        return task;
+      }
+    }
+    return std::nullopt;
+  }
+
+  // Leaves the upper halves of the range to thieves, down to one iteration
+  auto execute(size_t worker, Task task) -> void {
+    auto& group = *task.group;
+    while (task.last - task.first > 1) {
+      auto middle = task.first + (task.last - task.first) / 2;
+      group.pending.fetch_add(1, std::memory_order_relaxed);
+      push(worker, Task{task.group, task.run, task.body, middle, task.last});
+      task.last = middle;
+    }
+    if (!group.cancelled.load(std::memory_order_relaxed)) {
+      auto previous = std::exchange(current_log_identity, group.identity);
+      auto previous_counters = std::exchange(current_counters, group.counters);
+      try {
+        task.run(task.body, worker, task.first);
+      } catch (...) {
+        group.fail(std::current_exception());
+      }
+      current_log_identity = previous;
+      current_counters = previous_counters;
+    }
+    // the group may be gone once pending is 0
+    if (group.pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      { std::scoped_lock lock(sleep_mutex); }
+      joined.notify_all();
+    }
+  }
+
+  auto worker_loop(size_t worker) -> void {
+    current_pool = this;
+    current_worker = worker;
+    while (true) {
+      if (auto task = take(worker, nullptr)) {
+        // one span per stolen piece of work, with the pieces it split into
+        TraceSpan span("parallel_for", "worker",
+                       static_cast<std::int64_t>(worker));
+        execute(worker, *task);
+        while (auto own = take_own(worker)) {
+          execute(worker, *own);
+        }
+        continue;
+      }
+      std::unique_lock lock(sleep_mutex);
+      sleepers.fetch_add(1);
+      wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+      sleepers.fetch_sub(1);
+      if (stopping) {
+        return;
+      }
+    }
+  }
+
+  auto take_own(size_t worker) -> std::optional<Task> {
+    auto& own = queues[worker];
+    std::scoped_lock lock(own.mutex);
+    if (own.tasks.empty()) {
+      return std::nullopt;
+    }
+    auto task = own.tasks.back();
+    own.tasks.pop_back();
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    return task;
+  }
+};
+
+template <typename Fn>
+auto TaskGroup::spawn(Fn&& fn) -> void {
+  auto& body = spawned.emplace_back(std::forward<Fn>(fn));
+  pending.fetch_add(1, std::memory_order_relaxed);
+  pool.push(pool.this_worker(),
+            ThreadPool::Task{this, &ThreadPool::call_spawned, &body, 0, 1});
+}
+
+inline auto TaskGroup::wait() -> void {
+  auto worker = pool.this_worker();
+  while (pending.load(std::memory_order_acquire) > 0) {
+    if (auto task = pool.take(worker, this)) {
+      pool.execute(worker, *task);
+      continue;
+    }
+    // the rest runs elsewhere; look for stealable pieces now and then
+    std::unique_lock lock(pool.sleep_mutex);
+    pool.joined.wait_for(lock, std::chrono::microseconds(50), [this] {
+      return pending.load(std::memory_order_acquire) == 0;
+    });
+  }
+  spawned.clear();
+  if (error) {
+    std::rethrow_exception(std::exchange(error, nullptr));
+  }
+}
+
+// Scratch state per worker of a pool, e.g. one DiffusionSolver each. A slot
+// is made on first use by its worker, and only touched by that worker.
+template <typename T>
+struct WorkerLocal {
+  std::vector<std::optional<T>> slots;
+  std::function<T()> make;
+
+  WorkerLocal(const ThreadPool* pool, std::function<T()> make)
+      : slots(pool == nullptr ? 1 : pool->size()), make(std::move(make)) {}
+
+  [[nodiscard]] auto operator[](size_t worker) -> T& {
+    assert(worker < slots.size());
+    auto& slot = slots[worker];
+    if (!slot) {
+      slot.emplace(make());
+    }
+    return *slot;
+  }
+
+  // Calls fn(slot) for every slot made so far
+  template <typename Fn>
+  auto for_each(Fn&& fn) -> void {
+    for (auto& slot : slots) {
+      if (slot) {
+        fn(*slot);
+      }
+    }
+  }
+};
+
+}  // namespace im
+
+using im::TaskGroup;
+using im::ThreadPool;
+using im::WorkerLocal;
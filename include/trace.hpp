@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <expected>
+#include <string>
+
+#include "graph.hpp"
+
+namespace im {
+
+namespace detail {
+
+extern std::atomic<bool> tracing_enabled;
+
+[[nodiscard]] auto trace_clock() -> std::uint64_t;
+auto record_span(const char* name,
+                 const char* arg_name,
+                 std::int64_t arg,
+                 std::uint64_t start) -> void;
+
+}  // namespace detail
+
+// Spans are recorded once tracing is started, into a buffer of the calling
+// thread, and written by write_trace() as Chrome trace events (viewable in
+// Perfetto). Before that a span costs one relaxed load.
+auto start_tracing() -> void;
+[[nodiscard]] auto tracing() -> bool;
+
+// Writes the spans of all threads; call it when no span is open
+[[nodiscard]] auto write_trace(const std::string& path)
+    -> std::expected<void, error_t>;
+
+// Times the enclosing scope. Names (and argument names) must be string
+// literals.
+struct TraceSpan {
+  const char* name;
+  const char* arg_name;
+  std::int64_t arg;
+  std::uint64_t start;
+
+  explicit TraceSpan(const char* name,
+                     const char* arg_name = nullptr,
+                     std::int64_t arg = 0)
+      : name(name), arg_name(arg_name), arg(arg), start(0) {
+    if (detail::tracing_enabled.load(std::memory_order_relaxed)) {
+      start = detail::trace_clock();
+    }
+  }
+  TraceSpan(const TraceSpan&) = delete;
+  auto operator=(const TraceSpan&) -> TraceSpan& = delete;
+  ~TraceSpan() {
+    if (start != 0) {
+      detail::record_span(name, arg_name, arg, start);
+    }
+  }
+};
+
+}  // namespace im
+
+using im::TraceSpan;
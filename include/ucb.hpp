@@ -4,12 +4,14 @@
 #include <cassert>
 #include <cmath>
 #include <concepts>
-#include <format>
 #include <limits>
 #include <numbers>
+#include <span>
 #include <vector>
 
+#include "counters.hpp"
 #include "log.hpp"
+#include "trace.hpp"
 
 namespace im {
 
@@ -31,11 +33,48 @@ concept ConfidenceBoundTracker = requires(Tracker& tracker, double sample) {
   { tracker.reset_ucb() } -> std::same_as<void>;
 };
 
+// A tracker that also keeps a running estimate of the cost of a pull, and
+// knows how much a further pull would tighten its confidence bound.
+template <typename Tracker>
+concept CostAwareTracker =
+    ConfidenceBoundTracker<Tracker> &&
+    requires(Tracker& tracker, const Tracker& ctracker, double cost) {
+      { tracker.add_cost(cost) } -> std::same_as<void>;
+      { ctracker.cost() } -> std::convertible_to<double>;
+      { ctracker.pull_gain() } -> std::convertible_to<double>;
+    };
+
 template <typename Reward>
 concept ArmReward = requires(Reward& reward, int arm) {
   { reward(arm) } -> std::convertible_to<double>;
 };
 
+// A reward that reports the cost (work done) of its last sample
+template <typename Reward>
+concept CostedReward = ArmReward<Reward> && requires(const Reward& reward) {
+  { reward.last_cost() } -> std::convertible_to<double>;
+};
+
+// A reward that can sample many arms in one call (e.g. in parallel),
+// writing one reward and one cost per arm
+template <typename Reward>
+concept BatchReward =
+    ArmReward<Reward> && requires(Reward& reward,
+                                  std::span<const int> arms,
+                                  std::span<double> out) {
+      { reward.pull_many(arms, out, out) } -> std::same_as<void>;
+    };
+
+// A reward that samples many arms on one shared random outcome (e.g. one
+// live-edge world), so the rewards of one call are paired across arms
+template <typename Reward>
+concept SharedReward =
+    ArmReward<Reward> && requires(Reward& reward,
+                                  std::span<const int> arms,
+                                  std::span<double> out) {
+      { reward.pull_shared(arms, out, out) } -> std::same_as<void>;
+    };
+
 struct LILConfidence {
   double mult;
   double logkappap1;
@@ -64,6 +103,8 @@ struct LILConfidenceBoundTracker {
   double sum_rewards;
   double mean_reward;
   double capped_ucb;
+  size_t costed_pulls;
+  double total_cost;
 
   LILConfidenceBoundTracker(double kappa = 0.03,
                             double delta = 1e-3,
@@ -78,7 +119,9 @@ struct LILConfidenceBoundTracker {
         pulls(0),
         sum_rewards(0),
         mean_reward(0),
-        capped_ucb(infty) {
+        capped_ucb(infty),
+        costed_pulls(0),
+        total_cost(0) {
     assert(range_low <= range_high);
   }
 
@@ -95,6 +138,11 @@ struct LILConfidenceBoundTracker {
     capped_ucb = std::min(capped_ucb, instant_ucb);
   }
 
+  auto add_cost(double cost) -> void {
+    costed_pulls++;
+    total_cost += cost;
+  }
+
   auto reset_ucb() -> void { capped_ucb = infty; }
 
   [[nodiscard]] auto mean() const -> double {
@@ -120,13 +168,125 @@ struct LILConfidenceBoundTracker {
   }
 
   [[nodiscard]] auto num_pulls() const -> size_t { return pulls; }
+
+  // average cost of a pull; unknown costs count as 1
+  [[nodiscard]] auto cost() const -> double {
+    if (costed_pulls == 0) {
+      return 1.0;
+    }
+    return total_cost / costed_pulls;
+  }
+
+  // how much one more pull shrinks the variance of the mean, in units of
+  // the per-sample variance (the LIL radius itself is not monotone for
+  // small t, so its difference is not a usable gain)
+  [[nodiscard]] auto pull_gain() const -> double {
+    if (pulls == 0) {
+      return infty;
+    }
+    return 1.0 / (static_cast<double>(pulls) * (pulls + 1));
+  }
 };
 
 static_assert(ConfidenceBoundTracker<LILConfidenceBoundTracker>);
+static_assert(CostAwareTracker<LILConfidenceBoundTracker>);
+
+// Tracks the difference between an arm's reward and an anchor arm's reward on
+// paired samples. Differences of correlated rewards vary much less than the
+// rewards themselves, which the empirical-Bernstein radius (Audibert et al.,
+// 2009) exploits; delta is spread over t as delta / (t (t + 1)) so the bound
+// holds at all times. `range` is the width of the difference's support.
+struct PairedDifferenceTracker {
+  double delta;
+  double range;
+  size_t pulls;
+  double mean_diff;
+  double m2;  // sum of squared deviations (Welford)
+
+  PairedDifferenceTracker(double delta = 1e-3, double range = 2.0)
+      : delta(delta), range(range), pulls(0), mean_diff(0), m2(0) {
+    assert(0 < delta && delta < 1);
+  }
+
+  auto add_sample(double diff) -> void {
+    pulls++;
+    auto deviation = diff - mean_diff;
+    mean_diff += deviation / pulls;
+    m2 += deviation * (diff - mean_diff);
+  }
+
+  auto reset() -> void {
+    pulls = 0;
+    mean_diff = 0;
+    m2 = 0;
+  }
+
+  [[nodiscard]] auto mean() const -> double { return mean_diff; }
+
+  [[nodiscard]] auto radius() const -> double {
+    if (pulls == 0) {
+      return infty;
+    }
+    auto t = static_cast<double>(pulls);
+    auto log_term = std::log(t * (t + 1) * 3 / delta);
+    return std::sqrt(2 * (m2 / t) * log_term / t) + 3 * range * log_term / t;
+  }
+
+  [[nodiscard]] auto num_pulls() const -> size_t { return pulls; }
+};
+
+// Adds one sample of `arm` to its tracker
+template <ConfidenceBoundTracker Tracker, ArmReward Reward>
+auto pull_arm(Reward& reward, Tracker& tracker, int arm) -> void {
+  count(Counter::ArmPulls);
+  tracker.add_sample(reward(arm));
+  if constexpr (CostAwareTracker<Tracker> && CostedReward<Reward>) {
+    tracker.add_cost(reward.last_cost());
+  }
+}
+
+// Adds one sample of each of `arms` to its tracker, in bulk if the reward
+// supports it
+template <ConfidenceBoundTracker Tracker, ArmReward Reward>
+auto pull_arms(Reward& reward,
+               std::vector<Tracker>& trackers,
+               std::span<const int> arms) -> void {
+  if constexpr (BatchReward<Reward>) {
+    std::vector<double> rewards(arms.size());
+    std::vector<double> costs(arms.size());
+    TraceSpan span("pull batch", "arms", std::ssize(arms));
+    count(Counter::ArmPulls, arms.size());
+    reward.pull_many(arms, rewards, costs);
+    for (size_t k = 0; k < arms.size(); k++) {
+      trackers[arms[k]].add_sample(rewards[k]);
+      if constexpr (CostAwareTracker<Tracker>) {
+        trackers[arms[k]].add_cost(costs[k]);
+      }
+    }
+  } else {
+    for (auto arm : arms) {
+      pull_arm(reward, trackers[arm], arm);
+    }
+  }
+}
+
+// How UCB spends each round on the leader j and the challenger i:
+// Alternate pulls both, CostAware pulls only the one with the larger
+// pull_gain() per unit of cost() (if the tracker and reward support it).
+// SharedWorld instead pulls every candidate on one shared sample per round
+// and compares arms by their paired differences (needs a SharedReward and
+// UCB::paired).
+enum class PullSchedule {
+  Alternate,
+  CostAware,
+  SharedWorld,
+};
 
 // UCB is a class that implements the UCB algorithm
 // Tracker: maintains confidence bounds per arm
 // Reward: (int between 0 and n-1) -> double
+// In the SharedWorld schedule, paired[i] tracks arm i minus an anchor arm
+// (the first leader) within one best_arm() call.
 template <ConfidenceBoundTracker Tracker, ArmReward Reward>
 struct UCB {
   int n;
@@ -135,7 +295,10 @@ struct UCB {
   Reward& reward;
   std::vector<Tracker> trackers;
   std::vector<char> enabled;
+  std::vector<int> candidates;  // the enabled arms within best_arm()
   bool lazy;
+  PullSchedule schedule;
+  std::vector<PairedDifferenceTracker> paired;
   UCB(int n,
       double alpha,
       double eps,
@@ -148,7 +311,10 @@ struct UCB {
         reward(reward),
         trackers(std::move(trackers)),
         enabled(n, true),
-        lazy(lazy) {
+        candidates(),
+        lazy(lazy),
+        schedule(PullSchedule::Alternate),
+        paired() {
     assert(this->n >= 1);
     assert(this->n == static_cast<int>(this->trackers.size()));
   }
@@ -178,66 +344,61 @@ struct UCB {
   }
 
   [[nodiscard]] auto best_arm() -> int {
+    TraceSpan span("best_arm");
     assert(has_enabled_arm());
+    if constexpr (SharedReward<Reward>) {
+      if (schedule == PullSchedule::SharedWorld) {
+        return best_arm_shared();
+      }
+    }
+    candidates.clear();
+    std::vector<int> unpulled;
     for (int i = 0; i < n; i++) {
       if (!enabled[i]) {
         continue;
       }
+      candidates.push_back(i);
       if (trackers[i].num_pulls() == 0) {
-        trackers[i].add_sample(reward(i));
+        unpulled.push_back(i);
       }
     }
+    pull_arms(reward, trackers, unpulled);
 
     for (size_t t = n;; t++) {
-      int j = -1;
-      double best_mean = -infty;
-      for (int arm = 0; arm < n; arm++) {
-        if (!enabled[arm]) {
-          continue;
+      int j = leader();
+      int i = -1;
+      if (schedule == PullSchedule::CostAware &&
+          (i = challenger(j)) != -1) {
+        auto arm = cost_effective(j, i);
+        if (pull(arm, t)) {
+          log_debug("UCB stops at round {} with arm {}", t, arm);
+          return arm;
         }
-        auto arm_mean = trackers[arm].mean();
-        if (j == -1 || arm_mean > best_mean) {
-          j = arm;
-          best_mean = arm_mean;
+      } else {
+        if (pull(j, t)) {
+          log_debug("UCB stops at round {} with arm {}", t, j);
+          return j;
         }
-      }
-      assert(j != -1);
-      if (pull(j, t)) {
-        my_log(std::format("UCB stops at round {} with arm {}", t, j));
-        return j;
-      }
 
-      int i = -1;
-      double best_ucb = -infty;
-      for (int arm = 0; arm < n; arm++) {
-        if (!enabled[arm] || arm == j) {
-          continue;
+        i = challenger(j);
+        if (i == -1) {
+          return j;
         }
-        auto arm_ucb = trackers[arm].ucb();
-        if (i == -1 || arm_ucb > best_ucb) {
-          i = arm;
-          best_ucb = arm_ucb;
+        if (pull(i, t)) {
+          log_debug("UCB stops at round {} with arm {}", t, i);
+          return i;
         }
       }
-      if (i == -1) {
-        return j;
-      }
-
-      if (pull(i, t)) {
-        my_log(std::format("UCB stops at round {} with arm {}", t, i));
-        return i;
-      }
       if (trackers[j].ucb() > trackers[i].ucb()) {
         i = j;
       }
 
       auto confidence_width = trackers[i].mean() - trackers[i].lcb();
       if (confidence_width < eps) {
-        my_log(
-            std::format("UCB stops at round {} with arm {} due to {} pulls, "
-                        "confidence bound {} < {}, avg reward {}",
-                        t, i, trackers[i].num_pulls(), confidence_width, eps,
-                        trackers[i].mean()));
+        log_debug("UCB stops at round {} with arm {} due to {} pulls, "
+                  "confidence bound {} < {}, avg reward {}",
+                  t, i, trackers[i].num_pulls(), confidence_width, eps,
+                  trackers[i].mean());
         return i;
       }
     }
@@ -246,27 +407,155 @@ struct UCB {
   [[nodiscard]] auto pull(int i, size_t t) -> bool {
     assert(0 <= i && i < n);
     assert(enabled[i]);
-    trackers[i].add_sample(reward(i));
+    sample(i);
 
     auto pulls = trackers[i].num_pulls();
     if (!lazy && pulls >= 1 + alpha * (t - pulls)) {
-      my_log("Due to num_pulls,");
+      log_debug("Due to num_pulls,");
       return true;
     }
 
     double my_lower = trackers[i].lcb();
     double max_other_upper = -infty;
-    for (int j = 0; j < n; j++) {
-      if (j == i || !enabled[j])
+    for (auto j : candidates) {
+      if (j == i)
         continue;
       max_other_upper = std::max(max_other_upper, trackers[j].ucb());
     }
     if (my_lower > eps + max_other_upper) {
-      my_log("Due to confidence bound,");
+      log_debug("Due to confidence bound,");
       return true;
     }
     return false;
   }
+
+ private:
+  auto sample(int i) -> void { pull_arm(reward, trackers[i], i); }
+
+  // the candidate other than j with the highest UCB, or -1
+  [[nodiscard]] auto challenger(int j) const -> int {
+    int i = -1;
+    double best_ucb = -infty;
+    for (auto arm : candidates) {
+      if (arm == j) {
+        continue;
+      }
+      auto arm_ucb = trackers[arm].ucb();
+      if (i == -1 || arm_ucb > best_ucb) {
+        i = arm;
+        best_ucb = arm_ucb;
+      }
+    }
+    return i;
+  }
+
+  [[nodiscard]] auto cost_effective(int j, int i) const -> int {
+    if constexpr (CostAwareTracker<Tracker>) {
+      auto value = [&](int arm) {
+        return trackers[arm].pull_gain() / trackers[arm].cost();
+      };
+      return value(i) > value(j) ? i : j;
+    } else {
+      return j;
+    }
+  }
+
+  [[nodiscard]] auto leader() const -> int {
+    int j = -1;
+    for (auto arm : candidates) {
+      if (j == -1 || trackers[arm].mean() > trackers[j].mean()) {
+        j = arm;
+      }
+    }
+    assert(j != -1);
+    return j;
+  }
+
+  // drops the candidates whose own UCB is below the leader j's LCB
+  auto prune(int j) -> void {
+    auto leader_lcb = trackers[j].lcb();
+    std::erase_if(candidates, [&](int arm) {
+      return arm != j && trackers[arm].ucb() < leader_lcb;
+    });
+  }
+
+  // upper confidence bound on mean(i) - mean(j) from the paired differences;
+  // the anchor's own difference is exactly 0
+  [[nodiscard]] auto paired_upper(int i, int j, int anchor) const -> double {
+    auto radius = [&](int arm) {
+      return arm == anchor ? 0.0 : paired[arm].radius();
+    };
+    return paired[i].mean() - paired[j].mean() + radius(i) + radius(j);
+  }
+
+  // One shared sample per round feeds every candidate. Arms are dropped once
+  // they are beaten either by the paired bound or by their own bounds, and the
+  // leader is returned once no candidate can beat it by eps.
+  [[nodiscard]] auto best_arm_shared() -> int
+    requires SharedReward<Reward>
+  {
+    assert(static_cast<int>(paired.size()) == n);
+    candidates.clear();
+    for (int i = 0; i < n; i++) {
+      if (enabled[i]) {
+        candidates.push_back(i);
+      }
+      paired[i].reset();
+    }
+
+    int anchor = -1;
+    std::vector<int> arms;
+    std::vector<double> rewards, costs;
+    for (size_t t = 1;; t++) {
+      arms = candidates;
+      if (anchor != -1 && std::ranges::find(arms, anchor) == arms.end()) {
+        arms.push_back(anchor);
+      }
+      rewards.resize(arms.size());
+      costs.resize(arms.size());
+      count(Counter::ArmPulls, arms.size());
+      {
+        TraceSpan span("pull shared", "arms", std::ssize(arms));
+        reward.pull_shared(arms, rewards, costs);
+      }
+      for (size_t k = 0; k < arms.size(); k++) {
+        trackers[arms[k]].add_sample(rewards[k]);
+        if constexpr (CostAwareTracker<Tracker>) {
+          trackers[arms[k]].add_cost(costs[k]);
+        }
+      }
+      if (anchor == -1) {
+        anchor = leader();
+      }
+      auto anchor_reward =
+          rewards[std::ranges::find(arms, anchor) - arms.begin()];
+      for (size_t k = 0; k < arms.size(); k++) {
+        paired[arms[k]].add_sample(rewards[k] - anchor_reward);
+      }
+
+      auto j = *std::ranges::max_element(
+          candidates, {}, [&](int arm) { return paired[arm].mean(); });
+      prune(j);
+      std::erase_if(candidates, [&](int arm) {
+        return arm != j && paired_upper(arm, j, anchor) < 0;
+      });
+      if (candidates.size() == 1) {
+        log_debug("UCB stops at round {} with arm {}, the last candidate",
+                  t, j);
+        return j;
+      }
+      auto beaten = std::ranges::all_of(candidates, [&](int arm) {
+        return arm == j || paired_upper(arm, j, anchor) < eps;
+      });
+      if (beaten) {
+        log_debug(
+            "UCB stops at round {} with arm {} by paired bounds, {} "
+            "candidates left",
+            t, j, candidates.size());
+        return j;
+      }
+    }
+  }
 };
 
 }  // namespace im
@@ -275,4 +564,9 @@ using im::E;
 using im::infty;
 using im::LILConfidence;
 using im::LILConfidenceBoundTracker;
+using im::PairedDifferenceTracker;
+using im::pull_arm;
+using im::pull_arms;
+using im::PullSchedule;
+using im::SharedReward;
 using im::UCB;
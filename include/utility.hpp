@@ -2,11 +2,15 @@
 
 #include <cassert>
 #include <concepts>
+#include <cstddef>
 #include <functional>
-#include <numeric>
+#include <optional>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "thread_pool.hpp"
+
 template <typename Fn, typename... Args>
 concept RepeatInvocable = std::invocable<Fn &, Args...>;
 
@@ -37,6 +41,127 @@ template <typename Fn, typename... Args>
   requires RepeatAveragable<Fn, Args...>
 [[nodiscard]] auto repeat_avg(size_t n, Fn &&fn, Args &&...args) -> double {
   assert(n > 0);
-  auto results = repeat(n, std::forward<Fn>(fn), std::forward<Args>(args)...);
-  return std::accumulate(results.begin(), results.end(), 0.0) / results.size();
+  double total = 0;
+  for (size_t i = 0; i < n; ++i) {
+    total += std::invoke(fn, args...);
+  }
+  return total / n;
+}
+
+// The parallel versions split the n calls into pool.size() contiguous
+// blocks. Block b owns the state make_state(b), e.g. a DiffusionSolver seeded
+// with seed + b, and calls fn(state) or fn(state, i) for its indices i in
+// order. Any thread may run any block, so the results only depend on the
+// states and the number of blocks: for a fixed seed and pool size they are
+// the same on every run.
+template <typename MakeState>
+using RepeatState = std::invoke_result_t<MakeState &, size_t>;
+
+template <typename Fn, typename State>
+concept RepeatStateInvocable =
+  std::invocable<Fn &, State &> || std::invocable<Fn &, State &, size_t>;
+
+namespace im::detail {
+
+template <typename Fn, typename State>
+auto repeat_call(Fn &fn, State &state, size_t i) -> decltype(auto) {
+  if constexpr (std::invocable<Fn &, State &, size_t>) {
+    return std::invoke(fn, state, i);
+  } else {
+    return std::invoke(fn, state);
+  }
+}
+
+template <typename Fn, typename State>
+using repeat_result_t = decltype(repeat_call(std::declval<Fn &>(),
+                                             std::declval<State &>(),
+                                             size_t{}));
+
+// Calls block(b, state, first, last) for every block on the pool
+template <typename MakeState, typename Block>
+auto repeat_blocks(ThreadPool &pool, size_t n, MakeState &make_state,
+                   Block &&block) -> size_t {
+  auto blocks = std::min(pool.size(), std::max<size_t>(n, 1));
+  pool.parallel_for(blocks, [&](size_t, size_t b) {
+    auto state = make_state(b);
+    block(b, state, b * n / blocks, (b + 1) * n / blocks);
+  });
+  return blocks;
+}
+
+} // namespace im::detail
+
+// Folds the results of n calls into init with reduce(acc, result) within a
+// block, then folds the blocks in order with combine(acc, block_acc).
+// Nothing but one accumulator per block is kept.
+template <typename MakeState, typename Fn, typename T, typename Reduce,
+          typename Combine>
+  requires RepeatStateInvocable<Fn, RepeatState<MakeState>>
+[[nodiscard]] auto repeat_reduce(ThreadPool &pool, size_t n,
+                                 MakeState &&make_state, Fn &&fn, T init,
+                                 Reduce &&reduce, Combine &&combine) -> T {
+  std::vector<std::optional<T>> partial(pool.size());
+  auto blocks = im::detail::repeat_blocks(
+      pool, n, make_state, [&](size_t b, auto &state, size_t first,
+                               size_t last) {
+        auto acc = init;
+        for (auto i = first; i < last; ++i) {
+          acc = std::invoke(reduce, std::move(acc),
+                            im::detail::repeat_call(fn, state, i));
+        }
+        partial[b].emplace(std::move(acc));
+      });
+  for (size_t b = 0; b < blocks; ++b) {
+    init = std::invoke(combine, std::move(init), std::move(*partial[b]));
+  }
+  return init;
+}
+
+// The same with one function for results and blocks, e.g. std::plus
+template <typename MakeState, typename Fn, typename T, typename Reduce>
+  requires RepeatStateInvocable<Fn, RepeatState<MakeState>>
+[[nodiscard]] auto repeat_reduce(ThreadPool &pool, size_t n,
+                                 MakeState &&make_state, Fn &&fn, T init,
+                                 Reduce &&reduce) -> T {
+  return repeat_reduce(pool, n, make_state, fn, std::move(init), reduce,
+                       reduce);
+}
+
+// The results of n calls in index order
+template <typename MakeState, typename Fn>
+  requires RepeatStateInvocable<Fn, RepeatState<MakeState>>
+[[nodiscard]] auto repeat(ThreadPool &pool, size_t n, MakeState &&make_state,
+                          Fn &&fn)
+    -> std::vector<
+        im::detail::repeat_result_t<Fn, RepeatState<MakeState>>> {
+  using result_t = im::detail::repeat_result_t<Fn, RepeatState<MakeState>>;
+  std::vector<std::optional<result_t>> slots(n);
+  im::detail::repeat_blocks(
+      pool, n, make_state, [&](size_t, auto &state, size_t first,
+                               size_t last) {
+        for (auto i = first; i < last; ++i) {
+          slots[i].emplace(im::detail::repeat_call(fn, state, i));
+        }
+      });
+  std::vector<result_t> results;
+  results.reserve(n);
+  for (auto &slot : slots) {
+    results.push_back(std::move(*slot));
+  }
+  return results;
+}
+
+// The average of n calls, summed per block and then over the blocks in order
+template <typename MakeState, typename Fn>
+  requires RepeatStateInvocable<Fn, RepeatState<MakeState>> &&
+           std::convertible_to<
+               im::detail::repeat_result_t<Fn, RepeatState<MakeState>>,
+               double>
+[[nodiscard]] auto repeat_avg(ThreadPool &pool, size_t n,
+                              MakeState &&make_state, Fn &&fn) -> double {
+  assert(n > 0);
+  auto total = repeat_reduce(
+      pool, n, make_state, fn, 0.0,
+      [](double acc, double result) { return acc + result; });
+  return total / n;
 }
@@ -0,0 +1,322 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "counters.hpp"
+#include "diffusion.hpp"
+#include "graph.hpp"
+#include "rng.hpp"
+#include "thread_pool.hpp"
+
+namespace im {
+
+// A sampled live-edge world (Kempe et al., 2003).
+// Under IC every edge is live independently with its weight; under LT every
+// vertex keeps at most one incoming edge, each with probability equal to its
+// weight. The vertices a seed set activates are exactly those reachable from
+// it over live edges, so one world yields the marginal gain of every arm.
+// sample() conditions the world on the fixed seeds and condenses the rest of
+// it into strongly connected components; gains() then counts the reach of
+// every arm over the condensation, once per component.
+struct LiveEdgeWorld {
+  const Graph& g;
+  size_t probes;  // edges probed so far, comparable to DiffusionSolver::probes
+
+  explicit LiveEdgeWorld(const Graph& g)
+      : g(g),
+        probes(0),
+        live_offsets(g.n + 1, 0),
+        live_to(),
+        parent(),
+        covered(g.n, false),
+        comp(g.n, -1),
+        comp_size(),
+        comp_offsets(),
+        comp_to(),
+        comp_reach(),
+        index(g.n, -1),
+        low(g.n, 0),
+        on_stack(g.n, false),
+        stack(),
+        frames(),
+        queue(g.n),
+        scratch() {}
+
+  template <typename Rng>
+  auto sample(Rng& rng, DiffusionType type, std::span<const int> fixed)
+      -> void {
+    auto probes_before = probes;
+    switch (type) {
+      case DiffusionType::IndependentCascade:
+        sample_independent_cascade(rng);
+        count(Counter::RngDraws, probes - probes_before);
+        break;
+      case DiffusionType::LinearThreshold:
+        sample_linear_threshold(rng);
+        count(Counter::RngDraws, static_cast<std::uint64_t>(g.n));
+        break;
+    }
+    count(Counter::WorldsSampled);
+    count(Counter::EdgesProbed, probes - probes_before);
+    cover(fixed);
+    condense();
+  }
+
+  // Writes the number of vertices reachable from each arm but not from the
+  // fixed seeds. Components are counted in parallel if a pool is given.
+  auto gains(std::span<const int> arms,
+             std::span<double> out,
+             ThreadPool* pool = nullptr) -> void {
+    assert(out.size() == arms.size());
+    std::vector<int> sources;
+    for (auto arm : arms) {
+      auto c = comp[arm];
+      if (c != -1 && comp_reach[c] < 0) {
+        comp_reach[c] = 0;  // claimed
+        sources.push_back(c);
+      }
+    }
+
+    auto workers = pool == nullptr ? size_t{1} : pool->size();
+    if (scratch.size() < workers) {
+      scratch.resize(workers);
+    }
+    std::vector<size_t> worker_probes(workers, 0);
+    auto count = [&](size_t worker, size_t s) {
+      auto& [seen, stamp, dag_queue] = scratch[worker];
+      if (seen.size() < comp_size.size()) {
+        seen.resize(comp_size.size(), 0);
+      }
+      stamp++;
+      auto source = sources[s];
+      dag_queue.assign(1, source);
+      seen[source] = stamp;
+      size_t reach = 0;
+      for (size_t q = 0; q < dag_queue.size(); q++) {
+        auto c = dag_queue[q];
+        reach += comp_size[c];
+        worker_probes[worker] += comp_offsets[c + 1] - comp_offsets[c];
+        for (auto e = comp_offsets[c]; e < comp_offsets[c + 1]; e++) {
+          auto d = comp_to[e];
+          if (seen[d] != stamp) {
+            seen[d] = stamp;
+            dag_queue.push_back(d);
+          }
+        }
+      }
+      comp_reach[source] = static_cast<double>(reach);
+    };
+    if (pool == nullptr) {
+      for (size_t s = 0; s < sources.size(); s++) {
+        count(0, s);
+      }
+    } else {
+      pool->parallel_for(sources.size(), count);
+    }
+    for (auto p : worker_probes) {
+      probes += p;
+    }
+
+    for (size_t k = 0; k < arms.size(); k++) {
+      auto c = comp[arms[k]];
+      out[k] = c == -1 ? 0.0 : comp_reach[c];
+    }
+  }
+
+ private:
+  // live out-edges in CSR form
+  std::vector<size_t> live_offsets;
+  std::vector<int> live_to;
+  std::vector<int> parent;  // LT only
+  // vertices reachable from the fixed seeds
+  std::vector<char> covered;
+  // condensation of the live graph on the uncovered vertices
+  std::vector<int> comp;  // -1 for covered vertices
+  std::vector<size_t> comp_size;
+  std::vector<size_t> comp_offsets;
+  std::vector<int> comp_to;
+  std::vector<double> comp_reach;  // -1 until counted
+  // Tarjan's algorithm state
+  std::vector<int> index;
+  std::vector<int> low;
+  std::vector<char> on_stack;
+  std::vector<int> stack;
+  std::vector<std::pair<int, size_t>> frames;
+  std::vector<int> queue;
+  // per-worker reach counting state
+  struct Scratch {
+    std::vector<size_t> seen;
+    size_t stamp = 0;
+    std::vector<int> queue;
+  };
+  std::vector<Scratch> scratch;
+
+  template <typename Rng>
+  auto sample_independent_cascade(Rng& rng) -> void {
+    live_to.clear();
+    for (int u = 0; u < g.n; u++) {
+      live_offsets[u] = live_to.size();
+      probes += g[u].size();
+      for (const auto& e : g[u]) {
+        if (u01(rng) < e.weight) {
+          live_to.push_back(e.to);
+        }
+      }
+    }
+    live_offsets[g.n] = live_to.size();
+  }
+
+  template <typename Rng>
+  auto sample_linear_threshold(Rng& rng) -> void {
+    // every vertex draws a uniform threshold and spends it over its in-edges;
+    // the edge that exhausts it is the live one, chosen with its weight
+    parent.assign(g.n, -1);
+    std::vector<double> threshold(g.n);
+    for (int v = 0; v < g.n; v++) {
+      threshold[v] = u01(rng);
+    }
+    for (int u = 0; u < g.n; u++) {
+      probes += g[u].size();
+      for (const auto& e : g[u]) {
+        auto v = e.to;
+        if (parent[v] == -1) {
+          threshold[v] -= e.weight;
+          if (threshold[v] <= 0) {
+            parent[v] = u;
+          }
+        }
+      }
+    }
+    std::ranges::fill(live_offsets, 0);
+    for (int v = 0; v < g.n; v++) {
+      if (parent[v] != -1) {
+        live_offsets[parent[v] + 1]++;
+      }
+    }
+    for (int u = 0; u < g.n; u++) {
+      live_offsets[u + 1] += live_offsets[u];
+    }
+    live_to.resize(live_offsets[g.n]);
+    auto fill = live_offsets;
+    for (int v = 0; v < g.n; v++) {
+      if (parent[v] != -1) {
+        live_to[fill[parent[v]]++] = v;
+      }
+    }
+  }
+
+  auto cover(std::span<const int> fixed) -> void {
+    std::ranges::fill(covered, false);
+    size_t qr = 0;
+    for (auto u : fixed) {
+      if (!covered[u]) {
+        covered[u] = true;
+        queue[qr++] = u;
+      }
+    }
+    for (size_t ql = 0; ql < qr; ql++) {
+      auto u = queue[ql];
+      for (auto e = live_offsets[u]; e < live_offsets[u + 1]; e++) {
+        auto v = live_to[e];
+        if (!covered[v]) {
+          covered[v] = true;
+          queue[qr++] = v;
+        }
+      }
+    }
+  }
+
+  // Iterative Tarjan on the uncovered vertices; components come out in
+  // reverse topological order
+  auto condense() -> void {
+    std::ranges::fill(index, -1);
+    std::ranges::fill(comp, -1);
+    comp_size.clear();
+    int next_index = 0;
+    for (int root = 0; root < g.n; root++) {
+      if (covered[root] || index[root] != -1) {
+        continue;
+      }
+      frames.emplace_back(root, live_offsets[root]);
+      index[root] = low[root] = next_index++;
+      stack.push_back(root);
+      on_stack[root] = true;
+      while (!frames.empty()) {
+        auto& [u, e] = frames.back();
+        if (e < live_offsets[u + 1]) {
+          auto v = live_to[e++];
+          if (covered[v]) {
+            continue;
+          }
+          if (index[v] == -1) {
+            index[v] = low[v] = next_index++;
+            stack.push_back(v);
+            on_stack[v] = true;
+            frames.emplace_back(v, live_offsets[v]);
+          } else if (on_stack[v]) {
+            low[u] = std::min(low[u], index[v]);
+          }
+          continue;
+        }
+        auto finished = u;
+        frames.pop_back();
+        if (!frames.empty()) {
+          auto up = frames.back().first;
+          low[up] = std::min(low[up], low[finished]);
+        }
+        if (low[finished] == index[finished]) {
+          auto c = static_cast<int>(comp_size.size());
+          comp_size.push_back(0);
+          int v;
+          do {
+            v = stack.back();
+            stack.pop_back();
+            on_stack[v] = false;
+            comp[v] = c;
+            comp_size[c]++;
+          } while (v != finished);
+        }
+      }
+    }
+
+    auto n_comps = comp_size.size();
+    comp_offsets.assign(n_comps + 1, 0);
+    for (int u = 0; u < g.n; u++) {
+      if (comp[u] == -1) {
+        continue;
+      }
+      for (auto e = live_offsets[u]; e < live_offsets[u + 1]; e++) {
+        auto v = live_to[e];
+        if (comp[v] != -1 && comp[v] != comp[u]) {
+          comp_offsets[comp[u] + 1]++;
+        }
+      }
+    }
+    for (size_t c = 0; c < n_comps; c++) {
+      comp_offsets[c + 1] += comp_offsets[c];
+    }
+    comp_to.resize(comp_offsets[n_comps]);
+    auto fill = comp_offsets;
+    for (int u = 0; u < g.n; u++) {
+      if (comp[u] == -1) {
+        continue;
+      }
+      for (auto e = live_offsets[u]; e < live_offsets[u + 1]; e++) {
+        auto v = live_to[e];
+        if (comp[v] != -1 && comp[v] != comp[u]) {
+          comp_to[fill[comp[u]]++] = comp[v];
+        }
+      }
+    }
+    comp_reach.assign(n_comps, -1);
+  }
+};
+
+}  // namespace im
+
+using im::LiveEdgeWorld;
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "compressed_graph.hpp"
+
+namespace im {
+
+namespace {
+
+auto write_varint(std::vector<std::uint8_t>& out, std::uint64_t value)
+    -> void {
+  while (value >= 0x80) {
+    out.push_back(static_cast<std::uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<std::uint8_t>(value));
+}
+
+[[nodiscard]] auto zigzag(std::int64_t value) -> std::uint64_t {
+  return (static_cast<std::uint64_t>(value) << 1) ^
+         static_cast<std::uint64_t>(value >> 63);
+}
+
+}  // namespace
+
+auto compress_graph(const Graph& g) -> CompressedGraph {
+  CompressedGraph compressed;
+  compressed.n = g.n;
+  compressed.m = g.m;
+
+  // the dictionary, most frequent probability first; a probability is
+  // per target if all edges into each vertex agree
+  std::map<weight_t, size_t> frequency;
+  std::vector<std::optional<weight_t>> target_weight(g.n);
+  auto per_target = true;
+  for (int u = 0; u < g.n; u++) {
+    for (const auto& e : g[u]) {
+      frequency[e.weight]++;
+      auto& w = target_weight[e.to];
+      if (w && *w != e.weight) {
+        per_target = false;
+      }
+      w = e.weight;
+    }
+  }
+  std::vector<std::pair<size_t, weight_t>> by_frequency;
+  for (auto [weight, count] : frequency) {
+    by_frequency.emplace_back(count, weight);
+  }
+  std::ranges::stable_sort(by_frequency, std::greater{},
+                           &std::pair<size_t, weight_t>::first);
+  std::map<weight_t, std::uint32_t> codes;
+  for (const auto& [count, weight] : by_frequency) {
+    codes.emplace(weight, static_cast<std::uint32_t>(codes.size()));
+    compressed.dictionary.push_back(weight);
+  }
+  if (per_target) {
+    compressed.target_codes.assign(g.n, 0);
+    for (int v = 0; v < g.n; v++) {
+      if (target_weight[v]) {
+        compressed.target_codes[v] = codes[*target_weight[v]];
+      }
+    }
+  }
+
+  auto& bytes = compressed.bytes;
+  compressed.offsets.reserve(static_cast<size_t>(g.n) + 1);
+  std::vector<Edge> edges;
+  for (int u = 0; u < g.n; u++) {
+    compressed.offsets.push_back(bytes.size());
+    edges.assign(g[u].begin(), g[u].end());
+    std::ranges::stable_sort(edges, {}, &Edge::to);
+    write_varint(bytes, edges.size());
+    auto previous = u;
+    for (size_t i = 0; i < edges.size(); i++) {
+      auto to = edges[i].to;
+      if (i == 0) {
+        write_varint(bytes, zigzag(static_cast<std::int64_t>(to) - u));
+      } else {
+        write_varint(bytes, static_cast<std::uint64_t>(to - previous));
+      }
+      previous = to;
+      if (!per_target) {
+        write_varint(bytes, codes[edges[i].weight]);
+      }
+    }
+  }
+  compressed.offsets.push_back(bytes.size());
+  bytes.shrink_to_fit();
+  return compressed;
+}
+
+auto CompressedGraph::memory_bytes() const -> size_t {
+  return sizeof(*this) + offsets.capacity() * sizeof(std::uint64_t) +
+         bytes.capacity() + dictionary.capacity() * sizeof(weight_t) +
+         target_codes.capacity() * sizeof(std::uint32_t);
+}
+
+auto CompressedGraph::decompress() const -> Graph {
+  Graph g(n);
+  for (int u = 0; u < n; u++) {
+    for (const auto& e : (*this)[u]) {
+      g.add_edge(u, e.to, e.weight);
+    }
+  }
+  return g;
+}
+
+auto graph_memory_bytes(const Graph& g) -> size_t {
+  auto total = sizeof(g) + g.adj.capacity() * sizeof(std::vector<Edge>);
+  for (const auto& edges : g.adj) {
+    total += edges.capacity() * sizeof(Edge);
+  }
+  return total;
+}
+
+}  // namespace im
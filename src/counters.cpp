@@ -0,0 +1,179 @@
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "counters.hpp"
+
+namespace im {
+
+thread_local RunCounters* current_counters = nullptr;
+
+namespace detail {
+
+thread_local CounterBlock* cached_block = nullptr;
+thread_local std::uint64_t cached_run = 0;
+
+}  // namespace detail
+
+namespace {
+
+std::atomic<std::uint64_t> next_run_id = 1;
+
+[[nodiscard]] auto open_hardware_counter(std::uint64_t config) -> int {
+  perf_event_attr attr{};
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return static_cast<int>(
+      syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+}
+
+[[nodiscard]] auto read_hardware_counter(int fd)
+    -> std::optional<std::uint64_t> {
+  std::uint64_t value;
+  if (fd < 0 || ::read(fd, &value, sizeof(value)) != sizeof(value)) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+// Buckets up to the last non-empty one
+auto append_histogram(std::string& out,
+                      const std::array<std::uint64_t, histogram_buckets>& h)
+    -> void {
+  auto end = h.size();
+  while (end > 0 && h[end - 1] == 0) {
+    end--;
+  }
+  out += '[';
+  for (size_t b = 0; b < end; b++) {
+    out += std::format("{}{}", b == 0 ? "" : ",", h[b]);
+  }
+  out += ']';
+}
+
+}  // namespace
+
+auto CounterValues::since(const CounterValues& earlier) const
+    -> CounterValues {
+  CounterValues delta;
+  for (size_t c = 0; c < n_counters; c++) {
+    delta.counts[c] = counts[c] - earlier.counts[c];
+  }
+  for (size_t h = 0; h < n_histograms; h++) {
+    for (size_t b = 0; b < histogram_buckets; b++) {
+      delta.histograms[h][b] = histograms[h][b] - earlier.histograms[h][b];
+    }
+  }
+  return delta;
+}
+
+auto CounterValues::to_json() const -> std::string {
+  std::string out = "{";
+  for (size_t c = 0; c < n_counters; c++) {
+    out += std::format("{}\"{}\":{}", c == 0 ? "" : ",",
+                       counter_name(static_cast<Counter>(c)), counts[c]);
+  }
+  for (size_t h = 0; h < n_histograms; h++) {
+    out += std::format(",\"{}\":", histogram_name(static_cast<Histogram>(h)));
+    append_histogram(out, histograms[h]);
+  }
+  out += '}';
+  return out;
+}
+
+PerfEvents::PerfEvents()
+    : cycles_fd(open_hardware_counter(PERF_COUNT_HW_CPU_CYCLES)),
+      llc_misses_fd(open_hardware_counter(PERF_COUNT_HW_CACHE_MISSES)) {}
+
+PerfEvents::~PerfEvents() {
+  for (auto fd : {cycles_fd, llc_misses_fd}) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+}
+
+auto PerfEvents::read() const -> std::optional<Sample> {
+  auto cycles = read_hardware_counter(cycles_fd);
+  auto llc_misses = read_hardware_counter(llc_misses_fd);
+  if (!cycles || !llc_misses) {
+    return std::nullopt;
+  }
+  return Sample{*cycles, *llc_misses};
+}
+
+RunCounters::RunCounters(bool hardware)
+    : id(next_run_id.fetch_add(1, std::memory_order_relaxed)) {
+  if (hardware) {
+    perf = std::make_unique<PerfEvents>();
+    last_hardware = perf->read();
+  }
+}
+
+auto RunCounters::block() -> CounterBlock& {
+  std::scoped_lock lock(mutex);
+  return blocks[std::this_thread::get_id()];
+}
+
+auto RunCounters::total() -> CounterValues {
+  std::scoped_lock lock(mutex);
+  CounterValues sum;
+  for (const auto& [thread, block] : blocks) {
+    for (size_t c = 0; c < n_counters; c++) {
+      sum.counts[c] += block.counts[c].load(std::memory_order_relaxed);
+    }
+    for (size_t h = 0; h < n_histograms; h++) {
+      for (size_t b = 0; b < histogram_buckets; b++) {
+        sum.histograms[h][b] +=
+            block.histograms[h][b].load(std::memory_order_relaxed);
+      }
+    }
+  }
+  return sum;
+}
+
+auto RunCounters::step() -> void {
+  auto now = total();
+  steps.push_back(now.since(last));
+  last = now;
+  if (last_hardware) {
+    auto sample = perf->read();
+    if (sample) {
+      hardware_steps.push_back(
+          {sample->cycles - last_hardware->cycles,
+           sample->llc_misses - last_hardware->llc_misses});
+    }
+    last_hardware = sample;
+  }
+}
+
+auto RunCounters::to_json(int run, std::string_view alg) const -> std::string {
+  auto out = std::format("{{\"run\":{},\"alg\":\"{}\",\"steps\":[", run, alg);
+  for (size_t s = 0; s < steps.size(); s++) {
+    auto step = steps[s].to_json();
+    if (hardware_steps.size() == steps.size()) {
+      step.pop_back();
+      step += std::format(",\"cycles\":{},\"llc_misses\":{}}}",
+                          hardware_steps[s].cycles,
+                          hardware_steps[s].llc_misses);
+    }
+    out += std::format("{}{}", s == 0 ? "" : ",", step);
+  }
+  out += "]}\n";
+  return out;
+}
+
+}  // namespace im
@@ -0,0 +1,574 @@
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "daemon.hpp"
+#include "diffusion.hpp"
+#include "driver.hpp"
+#include "evaluate.hpp"
+#include "graph.hpp"
+#include "log.hpp"
+#include "rng.hpp"
+#include "world.hpp"
+
+namespace im {
+
+namespace {
+
+template <typename T>
+[[nodiscard]] auto parse_number(std::string_view key, std::string_view text)
+    -> std::expected<T, error_t> {
+  T value{};
+  auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(),
+                                   value);
+  if (ec != std::errc() || end != text.data() + text.size()) {
+    return std::unexpected(std::format("Invalid {} '{}'", key, text));
+  }
+  return value;
+}
+
+template <typename T>
+[[nodiscard]] auto get_number(const Request& request,
+                              std::string_view key,
+                              T fallback) -> std::expected<T, error_t> {
+  auto it = request.args.find(key);
+  if (it == request.args.end()) {
+    return fallback;
+  }
+  return parse_number<T>(key, it->second);
+}
+
+[[nodiscard]] auto get_string(const Request& request,
+                              std::string_view key,
+                              std::string_view fallback) -> std::string {
+  auto it = request.args.find(key);
+  return it == request.args.end() ? std::string(fallback) : it->second;
+}
+
+// A comma-separated list of vertices of g
+[[nodiscard]] auto get_vertices(const Request& request,
+                                std::string_view key,
+                                const Graph& g)
+    -> std::expected<std::vector<int>, error_t> {
+  std::vector<int> vertices;
+  auto it = request.args.find(key);
+  if (it == request.args.end() || it->second.empty()) {
+    return vertices;
+  }
+  std::string_view text = it->second;
+  while (true) {
+    auto comma = text.find(',');
+    auto vertex = parse_number<int>(key, text.substr(0, comma));
+    if (!vertex) {
+      return std::unexpected(vertex.error());
+    }
+    if (*vertex < 0 || *vertex >= g.n) {
+      return std::unexpected(
+          std::format("Vertex {} out of range [0, {})", *vertex, g.n));
+    }
+    vertices.push_back(*vertex);
+    if (comma == std::string_view::npos) {
+      return vertices;
+    }
+    text.remove_prefix(comma + 1);
+  }
+}
+
+[[nodiscard]] auto get_model(const Request& request)
+    -> std::expected<DiffusionType, error_t> {
+  auto model = get_string(request, "model", "ic");
+  if (model == "ic") {
+    return DiffusionType::IndependentCascade;
+  }
+  if (model == "lt") {
+    return DiffusionType::LinearThreshold;
+  }
+  return std::unexpected(std::format("Unknown model '{}'", model));
+}
+
+[[nodiscard]] auto json_string(std::string_view text) -> std::string {
+  std::string out = "\"";
+  for (char c : text) {
+    switch (c) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          out += std::format("\\u{:04x}", c);
+        } else {
+          out += c;
+        }
+    }
+  }
+  return out + "\"";
+}
+
+template <typename Range>
+[[nodiscard]] auto json_array(const Range& values) -> std::string {
+  std::string out = "[";
+  for (const auto& value : values) {
+    if (out.size() > 1) {
+      out += ",";
+    }
+    out += std::format("{}", value);
+  }
+  return out + "]";
+}
+
+// Closes a file descriptor when leaving scope
+struct FileDescriptor {
+  int fd;
+
+  explicit FileDescriptor(int fd) : fd(fd) {}
+  FileDescriptor(const FileDescriptor&) = delete;
+  auto operator=(const FileDescriptor&) -> FileDescriptor& = delete;
+  ~FileDescriptor() {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+};
+
+[[nodiscard]] auto read_exact(int fd, char* data, size_t size)
+    -> std::expected<void, error_t> {
+  while (size > 0) {
+    auto got = recv(fd, data, size, 0);
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got < 0) {
+      return std::unexpected(std::format("recv: {}", std::strerror(errno)));
+    }
+    if (got == 0) {
+      return std::unexpected("Connection closed");
+    }
+    data += got;
+    size -= static_cast<size_t>(got);
+  }
+  return {};
+}
+
+[[nodiscard]] auto write_exact(int fd, const char* data, size_t size)
+    -> std::expected<void, error_t> {
+  while (size > 0) {
+    auto sent = send(fd, data, size, MSG_NOSIGNAL);
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    if (sent < 0) {
+      return std::unexpected(std::format("send: {}", std::strerror(errno)));
+    }
+    data += sent;
+    size -= static_cast<size_t>(sent);
+  }
+  return {};
+}
+
+// Removes the socket a daemon that is gone left at `path`. Refuses to touch
+// a socket some daemon still listens on, or anything that is not a socket.
+[[nodiscard]] auto remove_stale_socket(const std::string& path,
+                                       const sockaddr_un& address)
+    -> std::expected<void, error_t> {
+  struct stat info{};
+  if (lstat(path.c_str(), &info) < 0) {
+    if (errno == ENOENT) {
+      return {};
+    }
+    return std::unexpected(
+        std::format("stat {}: {}", path, std::strerror(errno)));
+  }
+  if (!S_ISSOCK(info.st_mode)) {
+    return std::unexpected(std::format("{} exists and is not a socket", path));
+  }
+  FileDescriptor probe(socket(AF_UNIX, SOCK_STREAM, 0));
+  if (probe.fd >= 0 &&
+      connect(probe.fd, reinterpret_cast<const sockaddr*>(&address),
+              sizeof(address)) == 0) {
+    return std::unexpected(std::format("A daemon listens on {}", path));
+  }
+  if (unlink(path.c_str()) < 0) {
+    return std::unexpected(
+        std::format("unlink {}: {}", path, std::strerror(errno)));
+  }
+  return {};
+}
+
+}  // namespace
+
+auto parse_request(std::string_view text) -> std::expected<Request, error_t> {
+  Request request;
+  auto is_space = [](char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+  };
+  while (!text.empty()) {
+    if (is_space(text.front())) {
+      text.remove_prefix(1);
+      continue;
+    }
+    size_t end = 0;
+    while (end < text.size() && !is_space(text[end])) {
+      end++;
+    }
+    auto token = text.substr(0, end);
+    text.remove_prefix(end);
+    if (request.command.empty()) {
+      request.command = token;
+      continue;
+    }
+    auto eq = token.find('=');
+    if (eq == std::string_view::npos || eq == 0) {
+      return std::unexpected(
+          std::format("Expected key=value, got '{}'", token));
+    }
+    request.args.insert_or_assign(std::string(token.substr(0, eq)),
+                                  std::string(token.substr(eq + 1)));
+  }
+  if (request.command.empty()) {
+    return std::unexpected("Empty request");
+  }
+  return request;
+}
+
+QueryServer::QueryServer(ThreadPool* pool)
+    : pool(pool), graphs(), stopping(false), worlds() {}
+
+auto QueryServer::add_graph(std::string name, Graph g) -> void {
+  worlds.erase(name);
+  graphs.insert_or_assign(std::move(name), std::move(g));
+}
+
+auto QueryServer::handle(std::string_view text) -> std::string {
+  auto error = [](std::string_view message) {
+    return std::format("{{\"ok\":false,\"error\":{}}}", json_string(message));
+  };
+  auto request = parse_request(text);
+  if (!request) {
+    return error(request.error());
+  }
+  auto response = dispatch(*request);
+  if (!response) {
+    return error(response.error());
+  }
+  return std::format("{{\"ok\":true{}}}", *response);
+}
+
+auto QueryServer::world(std::string_view name, const Graph& g)
+    -> LiveEdgeWorld& {
+  auto it = worlds.find(name);
+  if (it == worlds.end()) {
+    it = worlds
+             .emplace(std::string(name), std::make_unique<LiveEdgeWorld>(g))
+             .first;
+  }
+  return *it->second;
+}
+
+// Returns the fields of a successful response, each starting with a comma
+auto QueryServer::dispatch(const Request& request)
+    -> std::expected<std::string, error_t> {
+  const auto& command = request.command;
+  if (command == "shutdown") {
+    stopping = true;
+    return "";
+  }
+  if (command == "graphs") {
+    std::string list;
+    for (const auto& [name, g] : graphs) {
+      if (!list.empty()) {
+        list += ",";
+      }
+      list += std::format("{{\"name\":{},\"n\":{},\"m\":{}}}",
+                          json_string(name), g.n, g.m);
+    }
+    return std::format(",\"graphs\":[{}]", list);
+  }
+
+  if (command != "influence" && command != "select" && command != "gains") {
+    return std::unexpected(std::format("Unknown command '{}'", command));
+  }
+
+  auto name = get_string(request, "graph", "");
+  auto it = graphs.find(name);
+  if (it == graphs.end()) {
+    return std::unexpected(std::format("Unknown graph '{}'", name));
+  }
+  const auto& g = it->second;
+  auto model = get_model(request);
+  if (!model) {
+    return std::unexpected(model.error());
+  }
+  auto seed = get_number<seed_type>(request, "seed", 0);
+  if (!seed) {
+    return std::unexpected(seed.error());
+  }
+
+  if (command == "influence") {
+    auto seeds = get_vertices(request, "seeds", g);
+    if (!seeds) {
+      return std::unexpected(seeds.error());
+    }
+    if (seeds->empty()) {
+      return std::unexpected("No seeds given");
+    }
+    auto eps = get_number<double>(request, "eps", 0.01);
+    if (!eps) {
+      return std::unexpected(eps.error());
+    }
+    auto evaluator = PrefixEvaluator(g, *model, *seed, pool);
+    auto stats = evaluator.evaluate({*seeds}, {*eps})[0];
+    std::vector<double> means;
+    for (const auto& prefix : stats) {
+      means.push_back(prefix.mean);
+    }
+    return std::format(
+        ",\"influence\":{},\"half_width\":{},\"worlds\":{},"
+        "\"prefix_influence\":{}",
+        stats.back().mean, stats.back().half_width(), stats.front().count,
+        json_array(means));
+  }
+
+  if (command == "select") {
+    RunOptions options;
+    options.dataset = name;
+    options.type = *model;
+    options.bai = get_string(request, "bai", "ucb");
+    auto k = get_number<int>(request, "k", 0);
+    auto eps = get_number<double>(request, "eps", 0.1);
+    auto delta = get_number<double>(request, "delta", 0.01);
+    auto batch = get_number<int>(request, "batch", 1);
+    if (!k) {
+      return std::unexpected(k.error());
+    }
+    if (!eps) {
+      return std::unexpected(eps.error());
+    }
+    if (!delta) {
+      return std::unexpected(delta.error());
+    }
+    if (!batch) {
+      return std::unexpected(batch.error());
+    }
+    if (*k < 1 || *k > g.n) {
+      return std::unexpected(std::format("k must be in [1, {}]", g.n));
+    }
+    if (*batch < 1) {
+      return std::unexpected("batch must be positive");
+    }
+    options.n_top = *k;
+    options.eps = *eps;
+    options.delta = *delta;
+    options.batch = *batch;
+    auto alg = get_string(request, "alg", "greedy-cb");
+    auto result = run_algorithm(g, options, alg, *seed, pool);
+    if (!result) {
+      return std::unexpected(result.error());
+    }
+    return std::format(",\"alg\":{},\"seeds\":{},\"used_samples\":{}",
+                       json_string(result->alg), json_array(result->seeds),
+                       json_array(result->used_samples));
+  }
+
+  if (command == "gains") {
+    auto fixed = get_vertices(request, "fixed", g);
+    if (!fixed) {
+      return std::unexpected(fixed.error());
+    }
+    auto arms = get_vertices(request, "arms", g);
+    if (!arms) {
+      return std::unexpected(arms.error());
+    }
+    if (arms->empty()) {
+      std::vector<char> is_fixed(g.n, false);
+      for (auto v : *fixed) {
+        is_fixed[v] = true;
+      }
+      for (int v = 0; v < g.n; v++) {
+        if (!is_fixed[v]) {
+          arms->push_back(v);
+        }
+      }
+    }
+    auto eps = get_number<double>(request, "eps", 0.01);
+    if (!eps) {
+      return std::unexpected(eps.error());
+    }
+    auto max_worlds = get_number<size_t>(request, "max_worlds", 1000000);
+    if (!max_worlds) {
+      return std::unexpected(max_worlds.error());
+    }
+    if (*max_worlds < 1) {
+      return std::unexpected("max_worlds must be positive");
+    }
+
+    // every world yields the gains of all arms at once
+    auto& live = world(name, g);
+    RNG rng(*seed);
+    ConfidenceTarget target{*eps};
+    std::vector<RunningStats> stats(arms->size());
+    std::vector<double> gains(arms->size());
+    size_t worlds_used = 0;
+    auto met = [&] {
+      return std::ranges::all_of(
+          stats, [&](const auto& arm) { return target.met(arm); });
+    };
+    while (worlds_used < *max_worlds && (worlds_used < 100 || !met())) {
+      live.sample(rng, *model, *fixed);
+      live.gains(*arms, gains, pool);
+      for (size_t a = 0; a < arms->size(); a++) {
+        stats[a].add(gains[a]);
+      }
+      worlds_used++;
+    }
+    std::vector<double> means, widths;
+    for (const auto& arm : stats) {
+      means.push_back(arm.mean);
+      widths.push_back(arm.half_width());
+    }
+    return std::format(
+        ",\"arms\":{},\"gains\":{},\"half_widths\":{},\"worlds\":{}",
+        json_array(*arms), json_array(means), json_array(widths),
+        worlds_used);
+  }
+  std::unreachable();
+}
+
+auto read_frame(int fd) -> std::expected<std::string, error_t> {
+  std::array<unsigned char, 4> header{};
+  auto got = read_exact(fd, reinterpret_cast<char*>(header.data()), 4);
+  if (!got) {
+    return std::unexpected(got.error());
+  }
+  size_t size = 0;
+  for (int i = 3; i >= 0; i--) {
+    size = size << 8 | header[i];
+  }
+  if (size > max_frame_size) {
+    return std::unexpected(std::format("Frame of {} bytes is too large", size));
+  }
+  std::string payload(size, '\0');
+  got = read_exact(fd, payload.data(), size);
+  if (!got) {
+    return std::unexpected(got.error());
+  }
+  return payload;
+}
+
+auto write_frame(int fd, std::string_view payload)
+    -> std::expected<void, error_t> {
+  if (payload.size() > max_frame_size) {
+    return std::unexpected(
+        std::format("Frame of {} bytes is too large", payload.size()));
+  }
+  std::array<char, 4> header{};
+  auto size = static_cast<std::uint32_t>(payload.size());
+  for (size_t i = 0; i < 4; i++) {
+    header[i] = static_cast<char>(size >> (8 * i) & 0xff);
+  }
+  auto sent = write_exact(fd, header.data(), header.size());
+  if (!sent) {
+    return sent;
+  }
+  return write_exact(fd, payload.data(), payload.size());
+}
+
+auto serve(QueryServer& server, const std::string& path)
+    -> std::expected<void, error_t> {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    return std::unexpected(std::format("Socket path {} is too long", path));
+  }
+  std::ranges::copy(path, address.sun_path);
+
+  auto removed = remove_stale_socket(path, address);
+  if (!removed) {
+    return removed;
+  }
+  FileDescriptor listener(socket(AF_UNIX, SOCK_STREAM, 0));
+  if (listener.fd < 0) {
+    return std::unexpected(std::format("socket: {}", std::strerror(errno)));
+  }
+  if (bind(listener.fd, reinterpret_cast<const sockaddr*>(&address),
+           sizeof(address)) < 0) {
+    return std::unexpected(
+        std::format("bind {}: {}", path, std::strerror(errno)));
+  }
+  if (listen(listener.fd, 16) < 0) {
+    unlink(path.c_str());
+    return std::unexpected(std::format("listen: {}", std::strerror(errno)));
+  }
+  log_info("Listening on {}", path);
+
+  // all connections are polled together, so a client keeping its connection
+  // open between requests does not shut out the others; the requests are
+  // answered one at a time, as they share the pool and the worlds
+  std::vector<std::unique_ptr<FileDescriptor>> clients;
+  std::vector<pollfd> fds;
+  while (!server.stopping) {
+    fds.assign(1, {listener.fd, POLLIN, 0});
+    for (const auto& client : clients) {
+      fds.push_back({client->fd, POLLIN, 0});
+    }
+    if (poll(fds.data(), fds.size(), -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      unlink(path.c_str());
+      return std::unexpected(std::format("poll: {}", std::strerror(errno)));
+    }
+    // backwards, so that closing a client keeps the indices of the rest
+    for (size_t i = clients.size(); i-- > 0 && !server.stopping;) {
+      auto events = fds[i + 1].revents;
+      if (events == 0) {
+        continue;
+      }
+      auto keep = false;
+      if (events & POLLIN) {
+        auto request = read_frame(clients[i]->fd);
+        keep = request &&
+               write_frame(clients[i]->fd, server.handle(*request))
+                   .has_value();
+      }
+      if (!keep) {
+        clients.erase(clients.begin() + static_cast<std::ptrdiff_t>(i));
+      }
+    }
+    if (!server.stopping && (fds[0].revents & POLLIN)) {
+      auto fd = accept(listener.fd, nullptr, nullptr);
+      if (fd >= 0) {
+        clients.push_back(std::make_unique<FileDescriptor>(fd));
+      } else if (errno != EINTR && errno != ECONNABORTED) {
+        unlink(path.c_str());
+        return std::unexpected(
+            std::format("accept: {}", std::strerror(errno)));
+      }
+    }
+  }
+  unlink(path.c_str());
+  return {};
+}
+
+}  // namespace im
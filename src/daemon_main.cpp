@@ -0,0 +1,74 @@
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+
+#include "daemon.hpp"
+#include "graph.hpp"
+#include "log.hpp"
+#include "thread_pool.hpp"
+
+int main(int argc, char** argv) {
+  argparse::ArgumentParser program("bandit-imd");
+  program.add_argument("socket").help("Path of the Unix socket").required();
+  program.add_argument("--graph")
+      .help("Graph to serve: a dataset name, or name=path")
+      .append()
+      .required();
+  program.add_argument("--threads")
+      .help("Worker threads for evaluation and bulk arm pulls")
+      .default_value(1)
+      .scan<'i', int>();
+
+  program.add_argument("--log_level")
+      .help("Least severe messages to print (debug needs -DIM_LOG_LEVEL=1)")
+      .default_value(std::string("info"))
+      .choices("trace", "debug", "info", "warn", "error");
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::exception& err) {
+    std::cerr << err.what() << '\n';
+    std::cerr << program;
+    return 1;
+  }
+
+  auto socket_path = program.get<std::string>("socket");
+  auto threads = program.get<int>("--threads");
+  im::set_log_level(
+      *im::parse_log_level(program.get<std::string>("--log_level")));
+  LogIdentity identity("bandit-imd");
+
+  auto pool = threads > 1 ? std::make_unique<ThreadPool>(threads) : nullptr;
+  QueryServer server(pool.get());
+  for (const auto& spec : program.get<std::vector<std::string>>("--graph")) {
+    auto eq = spec.find('=');
+    auto name = spec.substr(0, eq);
+    auto path = eq == std::string::npos
+                    ? im::dataset_graph_path(name)
+                    : spec.substr(eq + 1);
+    if (!std::filesystem::exists(path)) {
+      std::cerr << "Graph file " << path << " not found" << '\n';
+      return 1;
+    }
+    auto graph_result = im::load_graph_expected(path);
+    if (!graph_result) {
+      std::cerr << "Failed to load graph " << name << ": "
+                << graph_result.error() << '\n';
+      return 1;
+    }
+    log_info("Loaded {}: n = {}, m = {}", name, graph_result->n,
+             graph_result->m);
+    server.add_graph(name, *std::move(graph_result));
+  }
+
+  auto served = im::serve(server, socket_path);
+  if (!served) {
+    std::cerr << served.error() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,463 @@
+#include <charconv>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <expected>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "cbgreedy.hpp"
+#include "counters.hpp"
+#include "diffusion.hpp"
+#include "driver.hpp"
+#include "evaluate.hpp"
+#include "graph.hpp"
+#include "greedy.hpp"
+#include "log.hpp"
+#include "numa.hpp"
+#include "profiles.hpp"
+#include "results.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+
+namespace im {
+
+namespace {
+
+auto log_io_error(std::string_view context, std::string_view error) -> void {
+  std::cerr << context << ": " << error << '\n';
+}
+
+[[nodiscard]] auto seconds_since(std::chrono::steady_clock::time_point start)
+    -> double {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+// Restarts the peak resident set of the process (Linux 4.0 and later)
+auto reset_peak_rss() -> void { std::ofstream("/proc/self/clear_refs") << "5"; }
+
+// Peak resident set of the process since the last reset in KiB, 0 if unknown
+[[nodiscard]] auto peak_rss_kib() -> std::uint32_t {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.starts_with("VmHWM:")) {
+      std::uint64_t kib = 0;
+      std::istringstream(line.substr(6)) >> kib;
+      return static_cast<std::uint32_t>(
+          std::min<std::uint64_t>(kib, UINT32_MAX));
+    }
+  }
+  return 0;
+}
+
+// Selections in progress in the process, and started so far. The peak
+// resident set is the process's, so it is only known for a selection that
+// ran alone.
+std::atomic<int> selections_running{0};
+std::atomic<std::uint64_t> selections_started{0};
+
+// Measures the peak resident set of one selection while it lives
+struct PeakRssScope {
+  std::uint64_t started;
+  bool alone;
+
+  PeakRssScope()
+      : started(selections_started.fetch_add(1) + 1),
+        alone(selections_running.fetch_add(1) == 0) {
+    if (alone) {
+      reset_peak_rss();
+    }
+  }
+  ~PeakRssScope() { selections_running.fetch_sub(1); }
+
+  PeakRssScope(const PeakRssScope&) = delete;
+  auto operator=(const PeakRssScope&) -> PeakRssScope& = delete;
+
+  // 0 (unknown) if another selection overlapped this one
+  [[nodiscard]] auto peak_kib() const -> std::uint32_t {
+    auto peak = peak_rss_kib();
+    return alone && selections_started.load() == started ? peak : 0;
+  }
+};
+
+// appends the records of one run in a single write
+auto save_records(const RunOptions& options,
+                  const std::vector<ResultRecord>& records) -> void {
+  auto path = results_path(options.dataset);
+  auto saved = append_records(path, records);
+  if (!saved) {
+    log_io_error(std::format("Failed to save results to {}", path),
+                 saved.error());
+  }
+}
+
+[[nodiscard]] auto bai_suffix(std::string_view bai) -> std::string_view {
+  if (bai == "ucb-cost") {
+    return "-cost";
+  }
+  if (bai == "ucb-shared") {
+    return "-shared";
+  }
+  if (bai == "lucb") {
+    return "-lucb";
+  }
+  if (bai == "elimination") {
+    return "-elim";
+  }
+  return "";
+}
+
+template <typename Selector>
+[[nodiscard]] auto run_cb(const Graph& g,
+                          const RunOptions& options,
+                          const Selector& selector,
+                          std::string alg,
+                          seed_type seed,
+                          ThreadPool* pool) -> AlgoResult {
+  auto cb = GreedyCBDiffusion(g, options.type, options.n_top, options.eps,
+                              options.delta, selector);
+  cb.pool = pool;
+  auto seeds = cb.run(seed);
+  return {std::move(alg), std::move(seeds), cb.used_samples()};
+}
+
+// greedy-cb and celf-cb, running the best-arm identification algorithm
+// built by Policy; results are named "<alg><suffix>"
+template <typename Policy>
+[[nodiscard]] auto run_cb_policy(const Graph& g,
+                                 const RunOptions& options,
+                                 std::string_view alg,
+                                 seed_type seed,
+                                 ThreadPool* pool)
+    -> std::expected<AlgoResult, error_t> {
+  auto name = std::format("{}{}", alg, bai_suffix(options.bai));
+  if (alg == "greedy-cb") {
+    return run_cb(g, options, greedy_cb<DiffusionReward, Policy>,
+                  std::move(name), seed, pool);
+  }
+  if (alg == "celf-cb") {
+    return run_cb(g, options, greedy_cb_lazy<DiffusionReward, Policy>,
+                  std::move(name), seed, pool);
+  }
+  return std::unexpected(std::format("Unknown algorithm '{}'", alg));
+}
+
+}  // namespace
+
+auto parse_run_range(std::string_view text)
+    -> std::expected<RunRange, error_t> {
+  auto parse_int = [](std::string_view part) -> std::expected<int, error_t> {
+    int value = 0;
+    auto [end, ec] = std::from_chars(part.data(), part.data() + part.size(),
+                                     value);
+    if (ec != std::errc() || end != part.data() + part.size()) {
+      return std::unexpected(std::format("Invalid run id '{}'", part));
+    }
+    return value;
+  };
+
+  auto dots = text.find("..");
+  if (dots == std::string_view::npos) {
+    auto k = parse_int(text);
+    if (!k) {
+      return std::unexpected(k.error());
+    }
+    return RunRange{*k, *k};
+  }
+  auto first = parse_int(text.substr(0, dots));
+  if (!first) {
+    return std::unexpected(first.error());
+  }
+  auto last = parse_int(text.substr(dots + 2));
+  if (!last) {
+    return std::unexpected(last.error());
+  }
+  if (*last < *first) {
+    return std::unexpected(std::format("Empty run range '{}'", text));
+  }
+  return RunRange{*first, *last};
+}
+
+auto result_algorithms(const RunOptions& options) -> std::vector<std::string> {
+  auto suffix = bai_suffix(options.bai);
+  std::vector<std::string> algs{std::format("greedy-cb{}", suffix),
+                                std::format("celf-cb{}", suffix), "celf",
+                                "greedy"};
+  if (options.batch > 1) {
+    algs.emplace_back("greedy-cb-batch");
+  }
+  return algs;
+}
+
+auto run_algorithm(const Graph& g,
+                   const RunOptions& options,
+                   std::string_view alg,
+                   seed_type seed,
+                   ThreadPool* pool) -> std::expected<AlgoResult, error_t> {
+  if (alg == "celf" || alg == "greedy") {
+    auto run_greedy = [&](const auto& algo) -> AlgoResult {
+      auto run = DiffusionAlgoRun(g, options.type, options.n_top, options.eps,
+                                  options.delta, algo, pool);
+      auto seeds = run.run(seed);
+      return {std::string(alg), std::move(seeds), run.used_samples()};
+    };
+    if (alg == "celf") {
+      return run_greedy(greedy_lazy_forward<DiffusionSubmodular>);
+    }
+    return run_greedy(greedy_submodular<DiffusionSubmodular>);
+  }
+
+  // greedy-cb selecting `batch` seeds per bandit phase with top-m
+  // identification; only LUCB and elimination support top-m
+  const auto& bai = options.bai;
+  if (alg == "greedy-cb-batch") {
+    if (bai == "elimination") {
+      return run_cb(g, options, GreedyCBBatch<EliminationPolicy>{options.batch},
+                    "greedy-cb-batch", seed, pool);
+    }
+    return run_cb(g, options, GreedyCBBatch<LUCBPolicy>{options.batch},
+                  "greedy-cb-batch", seed, pool);
+  }
+
+  if (bai == "ucb") {
+    return run_cb_policy<LILUCBPolicy>(g, options, alg, seed, pool);
+  }
+  if (bai == "ucb-cost") {
+    return run_cb_policy<CostAwareUCBPolicy>(g, options, alg, seed, pool);
+  }
+  if (bai == "ucb-shared") {
+    return run_cb_policy<SharedWorldUCBPolicy>(g, options, alg, seed, pool);
+  }
+  if (bai == "lucb") {
+    return run_cb_policy<LUCBPolicy>(g, options, alg, seed, pool);
+  }
+  if (bai == "elimination") {
+    return run_cb_policy<EliminationPolicy>(g, options, alg, seed, pool);
+  }
+  return std::unexpected(
+      std::format("Unknown best-arm identification algorithm '{}'", bai));
+}
+
+auto run_selection(const Graph& g,
+                   const RunOptions& options,
+                   int k,
+                   ThreadPool* pool) -> std::vector<AlgoResult> {
+  // the seed offsets of the original experiments
+  std::vector<std::pair<std::string_view, int>> runs{{"greedy-cb", 3},
+                                                     {"celf-cb", 4}};
+  if (options.batch > 1) {
+    runs.emplace_back("greedy-cb-batch", 5);
+  }
+  runs.emplace_back("celf", 2);
+  if (g.n <= 40) {
+    runs.emplace_back("greedy", 1);
+  }
+
+  std::vector<AlgoResult> results;
+  std::vector<ResultRecord> records;
+  std::string counter_lines;
+  for (auto [alg, offset] : runs) {
+    RunCounters counters(counters_enabled);
+    PeakRssScope rss;
+    auto start = std::chrono::steady_clock::now();
+    auto result = [&] {
+      CounterScope counting(counters);
+      TraceSpan span(alg.data(), "k", k);  // the names above are literals
+      return run_algorithm(g, options, alg, 10 * k + offset, pool);
+    }();
+    if (!result) {
+      std::cerr << result.error() << '\n';
+      continue;
+    }
+    if constexpr (counters_enabled) {
+      counter_lines += counters.to_json(k, result->alg);
+    }
+    auto saved = *result;
+    if (options.permutation) {
+      saved.seeds = options.permutation->original(result->seeds);
+    }
+    auto added =
+        selection_records(k, saved, seconds_since(start), rss.peak_kib());
+    if (!added) {
+      log_io_error(std::format("Failed to save {}", result->alg),
+                   added.error());
+    } else {
+      records.insert(records.end(), added->begin(), added->end());
+    }
+    results.push_back(*std::move(result));
+  }
+  save_records(options, records);
+  if (!counter_lines.empty()) {
+    auto path = counters_path(options.dataset);
+    auto saved = append_lines(path, counter_lines);
+    if (!saved) {
+      log_io_error(std::format("Failed to save counters to {}", path),
+                   saved.error());
+    }
+  }
+  return results;
+}
+
+auto load_results(const ResultReader& store,
+                  const RunOptions& options,
+                  int k) -> std::vector<AlgoResult> {
+  std::vector<AlgoResult> results;
+  for (const auto& alg : result_algorithms(options)) {
+    auto result = store.selection(k, alg);
+    if (!result) {
+      std::cerr << "Result for " << alg << " " << k << " not available in "
+                << results_path(options.dataset) << '\n';
+      continue;
+    }
+    if (options.permutation) {
+      result->seeds = options.permutation->graph(result->seeds);
+    }
+    results.push_back(*std::move(result));
+  }
+  return results;
+}
+
+namespace {
+
+// One traversal per world for all profiles; the estimates of every result
+// go to one JSON line
+auto evaluate_under_profiles(const ProfileGraph& profiles,
+                             const RunOptions& options,
+                             int k,
+                             double eps,
+                             const std::vector<AlgoResult>& results,
+                             ThreadPool* pool) -> void {
+  log_info("Evaluating {} algorithms under {} profiles", results.size(),
+           profiles.profiles());
+  std::vector<std::vector<int>> lists;
+  for (const auto& result : results) {
+    lists.push_back(result.seeds);
+  }
+  auto stats = evaluate_profiles(profiles, options.type, lists, k,
+                                 {eps, ConfidenceMode::Either}, pool);
+  std::string lines;
+  for (size_t i = 0; i < results.size(); i++) {
+    lines += std::format("{{\"run\":{},\"alg\":\"{}\",\"profiles\":[", k,
+                         results[i].alg);
+    for (size_t p = 0; p < profiles.profiles(); p++) {
+      const auto& s = stats[i][p];
+      lines += std::format(
+          "{}{{\"name\":\"{}\",\"mean\":{},\"half_width\":{},"
+          "\"worlds\":{}}}",
+          p == 0 ? "" : ",", profiles.names[p], s.mean, s.half_width(),
+          s.count);
+    }
+    lines += "]}\n";
+  }
+  auto path = profiles_path(options.dataset);
+  auto saved = append_lines(path, lines);
+  if (!saved) {
+    log_io_error(std::format("Failed to save profiles to {}", path),
+                 saved.error());
+  }
+}
+
+}  // namespace
+
+auto run_evaluation(const Graph& g,
+                    const RunOptions& options,
+                    int k,
+                    double eps,
+                    const std::vector<AlgoResult>& results,
+                    ThreadPool* pool) -> void {
+  // all prefixes of all algorithms are evaluated on the same worlds
+  log_info("Evaluating {} algorithms", results.size());
+  std::vector<std::vector<int>> lists;
+  for (const auto& result : results) {
+    lists.push_back(result.seeds);
+  }
+  auto start = std::chrono::steady_clock::now();
+  auto evaluator = PrefixEvaluator(g, options.type, k, pool);
+  auto stats = evaluator.evaluate(lists, {eps, ConfidenceMode::Either});
+  auto seconds = seconds_since(start);
+  std::vector<ResultRecord> records;
+  for (size_t i = 0; i < results.size(); i++) {
+    auto added = evaluation_records(k, results[i].alg, stats[i], seconds);
+    if (!added) {
+      log_io_error(
+          std::format("Failed to save evaluation for {}", results[i].alg),
+          added.error());
+      continue;
+    }
+    records.insert(records.end(), added->begin(), added->end());
+  }
+  save_records(options, records);
+  if (options.profiles) {
+    evaluate_under_profiles(*options.profiles, options, k, eps, results,
+                            pool);
+  }
+}
+
+auto run_batch(const Graph& g,
+               const RunOptions& options,
+               RunRange runs,
+               RunMode mode,
+               ThreadPool* pool) -> void {
+  ResultReader store;
+  if (mode == RunMode::Evaluate) {
+    auto opened = ResultReader::open(results_path(options.dataset));
+    if (!opened) {
+      log_io_error("Failed to load results", opened.error());
+      return;
+    }
+    store = *std::move(opened);
+  }
+
+  auto run = [&](int k, ThreadPool* run_pool) {
+    LogIdentity identity(std::format("{} {}", options.dataset, k));
+    TraceSpan span("run", "k", k);
+    // the replica of the node of the thread running the run, if any
+    const auto& local = numa_local(g);
+    switch (mode) {
+      case RunMode::Select:
+        std::ignore = run_selection(local, options, k, run_pool);
+        break;
+      case RunMode::Evaluate:
+        run_evaluation(local, options, k, options.eps,
+                       load_results(store, options, k), run_pool);
+        break;
+      case RunMode::SelectEvaluate: {
+        auto results = run_selection(local, options, k, run_pool);
+        const auto& full = options.evaluation_graph != nullptr
+                               ? numa_local(*options.evaluation_graph)
+                               : local;
+        run_evaluation(full, options, k, options.eval_eps, results,
+                       run_pool);
+        break;
+      }
+    }
+  };
+
+  if (runs.size() == 1 || pool == nullptr) {
+    for (auto k = runs.first; k <= runs.last; k++) {
+      run(k, pool);
+    }
+    return;
+  }
+  if (mode != RunMode::Evaluate) {
+    log_info("Runs overlap on the pool, so their peak RSS is not recorded");
+  }
+  // the pool runs whole runs, and their parallel loops nest on it
+  pool->parallel_for(static_cast<size_t>(runs.size()),
+                     [&](size_t, size_t i) {
+                       run(runs.first + static_cast<int>(i), pool);
+                     });
+}
+
+}  // namespace im
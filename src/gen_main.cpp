@@ -0,0 +1,77 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <argparse/argparse.hpp>
+
+#include "generate.hpp"
+
+int main(int argc, char** argv) {
+  argparse::ArgumentParser program("bandit-im-gen");
+  program.add_argument("model")
+      .help("Graph model")
+      .choices("er", "ba", "rmat", "powerlaw");
+  program.add_argument("n").help("Vertices").scan<'i', int>();
+  program.add_argument("m")
+      .help("Edges (about m for ba, where every edge goes both ways)")
+      .scan<'u', size_t>();
+  program.add_argument("--weights")
+      .help("Edge probabilities: weighted cascade (1 / in-degree), "
+            "trivalency (0.1, 0.01 or 0.001) or uniform")
+      .default_value(std::string("wc"))
+      .choices("wc", "trivalency", "uniform");
+  program.add_argument("--p")
+      .help("Probability of every edge with --weights uniform")
+      .default_value(0.1)
+      .scan<'f', double>();
+  program.add_argument("--exponent")
+      .help("Degree exponent of powerlaw")
+      .default_value(2.5)
+      .scan<'f', double>();
+  program.add_argument("--seed").default_value(1).scan<'i', int>();
+  program.add_argument("--output")
+      .help("File to write, e.g. data/<name>/<name>.txt to run bandit-im on "
+            "<name> (default: standard output)");
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::exception& err) {
+    std::cerr << err.what() << '\n';
+    std::cerr << program;
+    return 1;
+  }
+
+  GeneratorOptions options;
+  options.model = *im::parse_graph_model(program.get<std::string>("model"));
+  options.n = program.get<int>("n");
+  options.m = program.get<size_t>("m");
+  options.exponent = program.get<double>("--exponent");
+  options.seed = static_cast<seed_type>(program.get<int>("--seed"));
+  WeightOptions weights;
+  weights.model =
+      *im::parse_weight_model(program.get<std::string>("--weights"));
+  weights.probability = program.get<double>("--p");
+  weights.seed = options.seed;
+  if (options.n < 2 || options.exponent <= 1) {
+    std::cerr << "Needs n >= 2 and exponent > 1\n";
+    return 1;
+  }
+
+  auto output = program.present<std::string>("--output");
+  if (!output) {
+    im::write_generated_graph(std::cout, options, weights);
+    return 0;
+  }
+  auto dir = std::filesystem::path(*output).parent_path();
+  if (!dir.empty()) {
+    std::filesystem::create_directories(dir);
+  }
+  std::ofstream f(*output, std::ios::binary);
+  if (!f.is_open()) {
+    std::cerr << "Failed to open output file " << *output << '\n';
+    return 1;
+  }
+  im::write_generated_graph(f, options, weights);
+  return 0;
+}
@@ -0,0 +1,102 @@
+#include <charconv>
+#include <cstddef>
+#include <expected>
+#include <format>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "generate.hpp"
+#include "graph.hpp"
+
+namespace im {
+
+namespace {
+
+// Buffers text lines for an ostream
+struct LineWriter {
+  std::ostream& out;
+  std::string buffer;
+
+  explicit LineWriter(std::ostream& out) : out(out) {}
+  LineWriter(const LineWriter&) = delete;
+  auto operator=(const LineWriter&) -> LineWriter& = delete;
+  ~LineWriter() { flush(); }
+
+  template <typename T>
+  auto add(T value, char separator) -> void {
+    char text[32];
+    auto end = std::to_chars(text, text + sizeof(text), value).ptr;
+    buffer.append(text, end);
+    buffer += separator;
+    if (buffer.size() >= (1 << 20)) {
+      flush();
+    }
+  }
+
+  auto flush() -> void {
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    buffer.clear();
+  }
+};
+
+}  // namespace
+
+auto parse_graph_model(std::string_view name)
+    -> std::expected<GraphModel, error_t> {
+  if (name == "er") {
+    return GraphModel::ErdosRenyi;
+  }
+  if (name == "ba") {
+    return GraphModel::BarabasiAlbert;
+  }
+  if (name == "rmat") {
+    return GraphModel::RMat;
+  }
+  if (name == "powerlaw") {
+    return GraphModel::PowerLaw;
+  }
+  return std::unexpected(std::format("Unknown graph model '{}'", name));
+}
+
+auto parse_weight_model(std::string_view name)
+    -> std::expected<WeightModel, error_t> {
+  if (name == "wc") {
+    return WeightModel::WeightedCascade;
+  }
+  if (name == "trivalency") {
+    return WeightModel::Trivalency;
+  }
+  if (name == "uniform") {
+    return WeightModel::Uniform;
+  }
+  return std::unexpected(std::format("Unknown weight model '{}'", name));
+}
+
+auto generate_graph(const GeneratorOptions& options,
+                    const WeightOptions& weights) -> Graph {
+  Graph g(options.n);
+  generate_weighted_edges(options, weights,
+                          [&](int u, int v, double w) { g.add_edge(u, v, w); });
+  return g;
+}
+
+auto write_generated_graph(std::ostream& out,
+                           const GeneratorOptions& options,
+                           const WeightOptions& weights) -> void {
+  auto m = options.m;
+  if (options.model == GraphModel::BarabasiAlbert) {
+    m = 0;
+    generate_edges(options, [&](int, int) { m++; });
+  }
+  LineWriter writer(out);
+  writer.add(options.n, ' ');
+  writer.add(m, '\n');
+  generate_weighted_edges(options, weights, [&](int u, int v, double w) {
+    writer.add(u, ' ');
+    writer.add(v, ' ');
+    writer.add(w, '\n');
+  });
+}
+
+}  // namespace im
@@ -1,15 +1,23 @@
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <format>
+#include <limits>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <type_traits>
+#include <vector>
 
 #include "graph.hpp"
+#include "trace.hpp"
 
 namespace im {
 
 auto parse_graph(std::istream &is) -> std::expected<Graph, error_t> {
+  TraceSpan span("graph load");
   int n, m;
   if (!(is >> n >> m)) {
     return std::unexpected("Invalid graph header: expected <n> <m>");
@@ -35,6 +43,72 @@ auto parse_graph(std::istream &is) -> std::expected<Graph, error_t> {
   return g;
 }
 
+auto parse_binary_graph(std::istream &is) -> std::expected<Graph, error_t> {
+  TraceSpan span("graph load");
+  BinaryGraphHeader header{};
+  if (!is.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, binary_graph_magic, sizeof(header.magic)) !=
+          0) {
+    return std::unexpected("Invalid binary graph header");
+  }
+  if (header.version != 1) {
+    return std::unexpected(
+        std::format("Unsupported binary graph version {}", header.version));
+  }
+  constexpr auto max = std::numeric_limits<std::int32_t>::max();
+  if (header.n > max || header.m > max) {
+    return std::unexpected("Invalid binary graph header: n or m too large");
+  }
+  auto n = static_cast<int>(header.n);
+  auto m = static_cast<size_t>(header.m);
+  // a corrupt n or m must not allocate more than the file holds
+  auto size = (static_cast<std::uint64_t>(n) + 1) * sizeof(std::uint64_t) +
+              m * (sizeof(std::int32_t) + sizeof(weight_t));
+  if (auto start = is.tellg(); start != std::istream::pos_type(-1)) {
+    is.seekg(0, std::ios::end);
+    auto remaining = static_cast<std::uint64_t>(is.tellg() - start);
+    is.seekg(start);
+    if (remaining < size) {
+      return std::unexpected(std::format(
+          "Truncated binary graph: {} bytes for n = {}, m = {}, {} left",
+          size, n, m, remaining));
+    }
+  }
+  std::vector<std::uint64_t> offsets(static_cast<size_t>(n) + 1);
+  std::vector<std::int32_t> targets(m);
+  std::vector<weight_t> weights(m);
+  auto read = [&](auto &values) {
+    using value_type = typename std::decay_t<decltype(values)>::value_type;
+    return static_cast<bool>(
+        is.read(reinterpret_cast<char *>(values.data()),
+                static_cast<std::streamsize>(values.size() *
+                                             sizeof(value_type))));
+  };
+  if (!read(offsets) || !read(targets) || !read(weights)) {
+    return std::unexpected("Truncated binary graph");
+  }
+  if (offsets.front() != 0 || offsets.back() != m ||
+      !std::ranges::is_sorted(offsets)) {
+    return std::unexpected("Invalid binary graph: bad edge offsets");
+  }
+
+  Graph g(n);
+  g.m = static_cast<int>(m);
+  for (int u = 0; u < n; u++) {
+    auto &edges = g.adj[u];
+    edges.reserve(offsets[u + 1] - offsets[u]);
+    for (auto e = offsets[u]; e < offsets[u + 1]; e++) {
+      if (targets[e] < 0 || targets[e] >= n) {
+        return std::unexpected(std::format(
+            "Invalid edge at index {}: vertex out of range [{}..{})", e, 0,
+            n));
+      }
+      edges.push_back({targets[e], weights[e]});
+    }
+  }
+  return g;
+}
+
 auto load_graph_expected(std::string_view source)
     -> std::expected<Graph, error_t> {
   if (source.find('\n') != std::string_view::npos) {
@@ -43,12 +117,65 @@ auto load_graph_expected(std::string_view source)
     return parse_graph(iss);
   } else {
     // source is a filename
-    std::ifstream file{std::string(source)};
+    std::ifstream file{std::string(source), std::ios::binary};
     if (!file.is_open()) {
       return std::unexpected(std::format("Failed to open file: {}", source));
     }
-    return parse_graph(file);
+    char magic[sizeof(binary_graph_magic)]{};
+    file.read(magic, sizeof(magic));
+    auto binary =
+        file.gcount() == sizeof(magic) &&
+        std::memcmp(magic, binary_graph_magic, sizeof(magic)) == 0;
+    file.clear();
+    file.seekg(0);
+    return binary ? parse_binary_graph(file) : parse_graph(file);
+  }
+}
+
+auto write_graph(std::ostream &os, const Graph &g) -> void {
+  os << std::format("{} {}\n", g.n, g.m);
+  for (int u = 0; u < g.n; u++) {
+    for (const auto &e : g[u]) {
+      os << std::format("{} {} {}\n", u, e.to, e.weight);
+    }
+  }
+}
+
+auto write_binary_graph(std::ostream &os, const Graph &g) -> void {
+  BinaryGraphHeader header{};
+  std::memcpy(header.magic, binary_graph_magic, sizeof(header.magic));
+  header.version = 1;
+  header.n = static_cast<std::uint64_t>(g.n);
+  header.m = static_cast<std::uint64_t>(g.m);
+  std::vector<std::uint64_t> offsets{0};
+  std::vector<std::int32_t> targets;
+  std::vector<weight_t> weights;
+  targets.reserve(static_cast<size_t>(g.m));
+  weights.reserve(static_cast<size_t>(g.m));
+  for (int u = 0; u < g.n; u++) {
+    for (const auto &e : g[u]) {
+      targets.push_back(e.to);
+      weights.push_back(e.weight);
+    }
+    offsets.push_back(targets.size());
+  }
+  auto write = [&](const auto &values) {
+    using value_type = typename std::decay_t<decltype(values)>::value_type;
+    os.write(reinterpret_cast<const char *>(values.data()),
+             static_cast<std::streamsize>(values.size() * sizeof(value_type)));
+  };
+  os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  write(offsets);
+  write(targets);
+  write(weights);
+}
+
+auto dataset_graph_path(std::string_view dataset) -> std::string {
+  auto binary = std::format("data/{}/{}.bin", dataset, dataset);
+  if (std::filesystem::exists(binary)) {
+    return binary;
   }
+  return std::format("data/{}/{}.txt", dataset, dataset);
 }
 
 auto load_graph(std::istream &is) -> Graph {
@@ -1,3 +1,193 @@
 #include "log.hpp"
 
-std::string identity = "log";
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace im {
+
+thread_local const std::string* current_log_identity = nullptr;
+
+namespace {
+
+std::atomic<LogLevel> runtime_log_level = LogLevel::Trace;
+
+// Lines of one thread: a single-producer single-consumer ring
+struct LogRing {
+  static constexpr size_t capacity = 1024;
+
+  std::array<std::string, capacity> lines;
+  std::atomic<size_t> head = 0;  // next line written by the thread
+  std::atomic<size_t> tail = 0;  // next line read by the drainer
+  std::atomic<size_t> dropped = 0;
+  std::atomic<bool> retired = false;  // the thread exited
+
+  auto push(std::string line) -> void {
+    auto h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) == capacity) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    lines[h % capacity] = std::move(line);
+    head.store(h + 1, std::memory_order_release);
+  }
+};
+
+class LogSink {
+ public:
+  LogSink()
+      : output(stdout), drainer([this](std::stop_token stop) { run(stop); }) {}
+
+  LogSink(const LogSink&) = delete;
+  auto operator=(const LogSink&) -> LogSink& = delete;
+
+  ~LogSink() {
+    drainer.request_stop();
+    drainer.join();
+    flush();
+  }
+
+  auto add(std::shared_ptr<LogRing> ring) -> void {
+    std::scoped_lock lock(rings_mutex);
+    rings.push_back(std::move(ring));
+  }
+
+  auto flush() -> void {
+    std::scoped_lock lock(drain_mutex);
+    drain();
+  }
+
+  auto set_output(std::FILE* file) -> void {
+    std::scoped_lock lock(drain_mutex);
+    drain();
+    output = file;
+  }
+
+ private:
+  std::mutex rings_mutex;
+  std::vector<std::shared_ptr<LogRing>> rings;
+  std::mutex drain_mutex;  // taken by whoever drains, never by producers
+  std::FILE* output;
+  std::string buffer;
+  std::jthread drainer;
+
+  // Writes the queued lines of all rings; returns whether there were any
+  auto drain() -> bool {
+    std::vector<std::shared_ptr<LogRing>> current;
+    {
+      std::scoped_lock lock(rings_mutex);
+      std::erase_if(rings, [](const auto& ring) {
+        return ring->retired.load(std::memory_order_acquire) &&
+               ring->tail.load(std::memory_order_relaxed) ==
+                   ring->head.load(std::memory_order_acquire) &&
+               ring->dropped.load(std::memory_order_relaxed) == 0;
+      });
+      current = rings;
+    }
+    buffer.clear();
+    for (const auto& ring : current) {
+      auto t = ring->tail.load(std::memory_order_relaxed);
+      auto h = ring->head.load(std::memory_order_acquire);
+      for (; t != h; t++) {
+        buffer += ring->lines[t % LogRing::capacity];
+      }
+      ring->tail.store(t, std::memory_order_release);
+      auto dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+      if (dropped > 0) {
+        buffer += std::format("log: {} lines dropped\n", dropped);
+      }
+    }
+    if (buffer.empty()) {
+      return false;
+    }
+    std::fwrite(buffer.data(), 1, buffer.size(), output);
+    std::fflush(output);
+    return true;
+  }
+
+  auto run(std::stop_token stop) -> void {
+    std::mutex sleep_mutex;
+    std::condition_variable_any sleep;
+    while (!stop.stop_requested()) {
+      bool wrote;
+      {
+        std::scoped_lock lock(drain_mutex);
+        wrote = drain();
+      }
+      if (!wrote) {
+        std::unique_lock lock(sleep_mutex);
+        sleep.wait_for(lock, stop, std::chrono::milliseconds(2),
+                       [] { return false; });
+      }
+    }
+  }
+};
+
+auto sink() -> LogSink& {
+  static LogSink instance;
+  return instance;
+}
+
+// Registers the thread's ring on its first line and retires it on exit
+struct RingHandle {
+  std::shared_ptr<LogRing> ring;
+
+  RingHandle() : ring(std::make_shared<LogRing>()) { sink().add(ring); }
+  RingHandle(const RingHandle&) = delete;
+  auto operator=(const RingHandle&) -> RingHandle& = delete;
+  ~RingHandle() { ring->retired.store(true, std::memory_order_release); }
+};
+
+}  // namespace
+
+auto set_log_level(LogLevel level) -> void {
+  runtime_log_level.store(level, std::memory_order_relaxed);
+}
+
+auto log_level() -> LogLevel {
+  return runtime_log_level.load(std::memory_order_relaxed);
+}
+
+auto parse_log_level(std::string_view name) -> std::optional<LogLevel> {
+  constexpr std::array<std::string_view, 5> names{"trace", "debug", "info",
+                                                  "warn", "error"};
+  for (size_t i = 0; i < names.size(); i++) {
+    if (names[i] == name) {
+      return static_cast<LogLevel>(i);
+    }
+  }
+  return std::nullopt;
+}
+
+auto log_line(std::string_view message) -> void {
+  thread_local RingHandle handle;
+  std::string_view identity = "log";
+  if (current_log_identity != nullptr) {
+    identity = *current_log_identity;
+  }
+  std::string line;
+  line.reserve(identity.size() + message.size() + 3);
+  line += identity;
+  line += ": ";
+  line += message;
+  line += '\n';
+  handle.ring->push(std::move(line));
+}
+
+auto flush_log() -> void { sink().flush(); }
+
+auto set_log_output(std::FILE* output) -> void { sink().set_output(output); }
+
+}  // namespace im
@@ -1,102 +1,31 @@
-#include <expected>
 #include <filesystem>
 #include <format>
-#include <fstream>
+#include <functional>
 #include <iostream>
-#include <string_view>
+#include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include <argparse/argparse.hpp>
 
-#include "cbgreedy.hpp"
 #include "diffusion.hpp"
+#include "driver.hpp"
 #include "graph.hpp"
-#include "greedy.hpp"
 #include "log.hpp"
-
-namespace {
-
-using io_result = std::expected<void, std::string>;
-using load_result_t = std::expected<std::vector<int>, std::string>;
-
-[[nodiscard]] auto save_result(const std::vector<int>& result,
-                               std::string_view dataset,
-                               std::string_view alg,
-                               int k,
-                               const std::vector<size_t>& used_samples)
-    -> io_result {
-  if (result.size() != used_samples.size()) {
-    return std::unexpected("result and used_samples have different size");
-  }
-
-  auto dir = std::format("results/{}/{}", dataset, alg);
-  if (!std::filesystem::exists(dir)) {
-    std::filesystem::create_directories(dir);
-  }
-
-  auto filename = std::format("{}/{}.txt", dir, k);
-  std::ofstream f(filename);
-  if (!f.is_open()) {
-    return std::unexpected(
-        std::format("Failed to open output file {}", filename));
-  }
-
-  for (size_t i = 0; i < result.size(); i++) {
-    f << result[i] << " " << used_samples[i] << "\n";
-  }
-  return {};
-}
-
-[[nodiscard]] auto load_result(std::string_view dataset,
-                               std::string_view alg,
-                               int k) -> load_result_t {
-  auto filename = std::format("results/{}/{}/{}.txt", dataset, alg, k);
-  if (!std::filesystem::exists(filename)) {
-    return std::unexpected(std::format("File {} not found", filename));
-  }
-
-  std::ifstream f(filename);
-  if (!f.is_open()) {
-    return std::unexpected(std::format("Failed to open {}", filename));
-  }
-
-  std::vector<int> result;
-  int v, s;
-  while (f >> v >> s) {
-    result.push_back(v);
-  }
-
-  return result;
-}
-
-[[nodiscard]] auto save_eval(std::string_view dataset,
-                             std::string_view alg,
-                             int k,
-                             const std::vector<double>& means) -> io_result {
-  auto filename = std::format("results/{}/{}/{}_eval.txt", dataset, alg, k);
-  std::ofstream f(filename);
-  if (!f.is_open()) {
-    return std::unexpected(
-        std::format("Failed to open output file {}", filename));
-  }
-
-  for (size_t i = 0; i < means.size(); i++) {
-    f << means[i] << '\n';
-  }
-
-  return {};
-}
-
-auto log_io_error(std::string_view context, std::string_view error) -> void {
-  std::cerr << context << ": " << error << '\n';
-}
-
-}  // namespace
+#include "numa.hpp"
+#include "profiles.hpp"
+#include "reorder.hpp"
+#include "sparsify.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
 
 int main(int argc, char** argv) {
   argparse::ArgumentParser program("bandit-im");
   program.add_argument("dataset").help("Dataset to use").required();
-  program.add_argument("k").help("Run id").required().scan<'i', int>();
+  program.add_argument("k")
+      .help("Run id, or a range a..b of run ids to run in this process")
+      .required();
   program.add_argument("eps").help("Epsilon").required().scan<'f', double>();
   program.add_argument("delta").help("Delta").required().scan<'f', double>();
   program.add_argument("--n_top")
@@ -107,11 +36,68 @@ int main(int argc, char** argv) {
       .help("Evaluation mode")
       .default_value(false)
       .implicit_value(true);
+  program.add_argument("--then_eval")
+      .help("Evaluate the results right after selection")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--eval_eps")
+      .help("Epsilon of the evaluation after selection (default: eps)")
+      .scan<'f', double>();
+  program.add_argument("--bai")
+      .help("Best-arm identification algorithm for greedy-cb and celf-cb")
+      .default_value(std::string("ucb"))
+      .choices("ucb", "ucb-cost", "ucb-shared", "lucb", "elimination");
+  program.add_argument("--batch")
+      .help("Also run greedy-cb-batch, selecting this many seeds per phase")
+      .default_value(1)
+      .scan<'i', int>();
+  program.add_argument("--threads")
+      .help("Worker threads: for the runs of a range, otherwise for bulk arm "
+            "pulls and evaluation")
+      .default_value(1)
+      .scan<'i', int>();
+  program.add_argument("--numa")
+      .help("Pin the worker threads to NUMA nodes, spread evenly, and let "
+            "them read a copy of the graph on their own node")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--reorder")
+      .help("Relabel the vertices after loading for cache locality: none, "
+            "degree or rcm; results keep the ids of the input file")
+      .default_value(std::string("none"))
+      .choices("none", "degree", "rcm");
+  program.add_argument("--profile")
+      .help("Also load the weights of data/<dataset>/<name>.txt, with the "
+            "same edges, as a profile; evaluation estimates the results "
+            "under every profile in one pass (repeatable)")
+      .default_value(std::vector<std::string>{})
+      .append();
+  program.add_argument("--select_profile")
+      .help("Profile to select and evaluate under; results are saved as "
+            "those of dataset <name>");
+  program.add_argument("--sparsify")
+      .help("Select on a copy of the graph reduced to this many edges, and "
+            "evaluate on the full graph; results are saved as those of "
+            "dataset <dataset>-sparse<edges>")
+      .scan<'i', int>();
+  program.add_argument("--sparsify_method")
+      .help("Edges kept by --sparsify: the largest p * sigma(target) "
+            "(contribution) or the most probable (probability)")
+      .default_value(std::string("contribution"))
+      .choices("contribution", "probability");
   program.add_argument("--lt")
       .help("Linear threshold diffusion")
       .default_value(false)
       .implicit_value(true);
 
+  program.add_argument("--log_level")
+      .help("Least severe messages to print (debug needs -DIM_LOG_LEVEL=1)")
+      .default_value(std::string("info"))
+      .choices("trace", "debug", "info", "warn", "error");
+  program.add_argument("--trace")
+      .help("Write a Chrome trace of the algorithm phases to this file, to "
+            "be opened in Perfetto");
+
   try {
     program.parse_args(argc, argv);
   } catch (const std::exception& err) {
@@ -120,129 +106,162 @@ int main(int argc, char** argv) {
     return 1;
   }
 
-  auto type = DiffusionType::IndependentCascade;
-
-  auto dataset = program.get<std::string>("dataset");
-  auto k = program.get<int>("k");
-  auto eps = program.get<double>("eps");
-  auto delta = program.get<double>("delta");
-  auto n_top = program.get<int>("--n_top");
+  RunOptions options;
+  options.dataset = program.get<std::string>("dataset");
+  options.eps = program.get<double>("eps");
+  options.delta = program.get<double>("delta");
+  options.eval_eps =
+      program.present<double>("--eval_eps").value_or(options.eps);
+  options.n_top = program.get<int>("--n_top");
+  options.bai = program.get<std::string>("--bai");
+  options.batch = program.get<int>("--batch");
+  if (program.get<bool>("--lt")) {
+    options.type = DiffusionType::LinearThreshold;
+  }
   auto eval = program.get<bool>("--eval");
-  auto lt = program.get<bool>("--lt");
-  set_identity(std::format("{} {}", dataset, k));
+  auto then_eval = program.get<bool>("--then_eval");
+  auto threads = program.get<int>("--threads");
+  im::set_log_level(
+      *im::parse_log_level(program.get<std::string>("--log_level")));
 
-  if (lt) {
-    type = DiffusionType::LinearThreshold;
+  auto runs = im::parse_run_range(program.get<std::string>("k"));
+  if (!runs) {
+    std::cerr << runs.error() << '\n';
+    return 1;
+  }
+  LogIdentity identity(std::format("{} {}", options.dataset, runs->first));
+  auto trace_path = program.present<std::string>("--trace");
+  if (trace_path) {
+    im::start_tracing();
   }
 
-  auto dataset_path = std::format("data/{}/{}.txt", dataset, dataset);
+  const auto dataset = options.dataset;
+  auto dataset_path = im::dataset_graph_path(dataset);
   if (!std::filesystem::exists(dataset_path)) {
     std::cerr << "Dataset " << dataset << " not found" << '\n';
     return 1;
   }
-  auto graph_result = im::load_graph_expected(dataset_path);
-  if (!graph_result) {
-    std::cerr << "Failed to load graph: " << graph_result.error() << '\n';
+  auto profile_names = program.get<std::vector<std::string>>("--profile");
+  auto select_profile = program.present<std::string>("--select_profile");
+  auto order = *im::parse_vertex_order(program.get<std::string>("--reorder"));
+  if (!profile_names.empty() && order != VertexOrder::Original) {
+    std::cerr << "--profile and --reorder can't be combined" << '\n';
+    return 1;
+  }
+  auto sparsify_edges = program.present<int>("--sparsify");
+  if (sparsify_edges && *sparsify_edges < 0) {
+    std::cerr << "--sparsify needs a non-negative edge count" << '\n';
     return 1;
   }
-  auto g = *std::move(graph_result);
+  if (select_profile && profile_names.empty()) {
+    profile_names.push_back(*select_profile);
+  }
 
-  if (!eval) {
-    {
-      auto cbgreedy = GreedyCBDiffusion(g, type, n_top, eps, delta,
-                                        greedy_cb<DiffusionReward>);
-      auto result = cbgreedy.run(10 * k + 3);
-      auto saved =
-          save_result(result, dataset, "greedy-cb", k, cbgreedy.used_samples());
-      if (!saved) {
-        log_io_error("Failed to save greedy-cb", saved.error());
-      }
+  // with profiles, g is the graph of the profile set, under the selected
+  // profile's weights
+  std::shared_ptr<ProfileGraph> profiles;
+  Graph plain(0);
+  if (!profile_names.empty()) {
+    std::vector<std::pair<std::string, std::string>> sources{
+        {dataset, dataset_path}};
+    for (const auto& name : profile_names) {
+      sources.emplace_back(name,
+                           std::format("data/{}/{}.txt", dataset, name));
     }
-
-    {
-      auto celf_cb = GreedyCBDiffusion(g, type, n_top, eps, delta,
-                                       greedy_cb_lazy<DiffusionReward>);
-      auto celf_result = celf_cb.run(10 * k + 4);
-      auto saved = save_result(celf_result, dataset, "celf-cb", k,
-                               celf_cb.used_samples());
-      if (!saved) {
-        log_io_error("Failed to save celf-cb", saved.error());
-      }
+    auto loaded = im::load_profile_graph(sources);
+    if (!loaded) {
+      std::cerr << "Failed to load profiles: " << loaded.error() << '\n';
+      return 1;
     }
-
-    {
-      auto celf = DiffusionAlgoRun(g, type, n_top, eps, delta,
-                                   greedy_lazy_forward<DiffusionSubmodular>);
-      auto result = celf.run(10 * k + 2);
-      auto saved = save_result(result, dataset, "celf", k, celf.used_samples());
-      if (!saved) {
-        log_io_error("Failed to save celf", saved.error());
-      }
-    }
-
-    if (g.n <= 40) {
-      auto greedy = DiffusionAlgoRun(g, type, n_top, eps, delta,
-                                     greedy_submodular<DiffusionSubmodular>);
-      auto result = greedy.run(10 * k + 1);
-      auto saved =
-          save_result(result, dataset, "greedy", k, greedy.used_samples());
-      if (!saved) {
-        log_io_error("Failed to save greedy", saved.error());
+    profiles = std::make_shared<ProfileGraph>(*std::move(loaded));
+    if (select_profile) {
+      auto p = profiles->find(*select_profile);
+      if (!p) {
+        std::cerr << "Profile " << *select_profile << " not loaded" << '\n';
+        return 1;
       }
+      profiles->use(*p);
+      options.dataset = *select_profile;
     }
+    options.profiles = profiles;
   } else {
-    auto solver = DiffusionSolver(g, k);
+    auto graph_result = im::load_graph_expected(dataset_path);
+    if (!graph_result) {
+      std::cerr << "Failed to load graph: " << graph_result.error() << '\n';
+      return 1;
+    }
+    plain = *std::move(graph_result);
+  }
+  auto& g = profiles ? profiles->graph : plain;
+  if (order != VertexOrder::Original) {
+    TraceSpan span("reorder");
+    auto permutation = im::vertex_order(g, order);
+    g = im::reorder_graph(g, permutation);
+    options.permutation =
+        std::make_shared<const VertexPermutation>(std::move(permutation));
+  }
 
-    auto evaluate = [&](const std::vector<int>& S) -> double {
-      auto total = 0.0, total_sq = 0.0;
-      size_t cnt = 0;
-      size_t last_cnt = 0;
-      while (true) {
-        auto result = solver.run(type, S);
-        total += result;
-        total_sq += result * result;
-        if (cnt > 100) {
-          auto mean = total / cnt;
-          auto var = total_sq / cnt - mean * mean;
-          auto std = std::sqrt(var * cnt / (cnt - 1));
-          // if the samples really follow a normal distribution,
-          // what's our confidence interval on mean?
-          auto confidence = 1.96 * std / std::sqrt(cnt);
-          if (cnt > last_cnt * 3.1622) {
-            last_cnt = cnt;
-          }
-          if (confidence < eps || confidence < eps * mean) {
-            break;
-          }
-        }
-        cnt++;
+  auto mode = RunMode::Select;
+  if (eval) {
+    mode = RunMode::Evaluate;
+  } else if (then_eval) {
+    mode = RunMode::SelectEvaluate;
+  }
+  std::function<void(size_t)> pin;
+  auto topology = NumaTopology::detect();
+  auto numa = program.get<bool>("--numa");
+  if (numa) {
+    log_info("{} NUMA nodes", topology.nodes.size());
+    pin = [&topology](size_t worker) {
+      auto pinned = im::pin_to_node(topology, worker % topology.nodes.size());
+      if (!pinned) {
+        log_warn("{}", pinned.error());
       }
-      return total / cnt;
     };
+    pin(0);
+  }
+  auto pool = threads > 1 ? std::make_unique<ThreadPool>(threads, pin)
+                          : nullptr;
 
-    for (std::string_view alg : {"greedy-cb", "celf-cb", "celf", "greedy"}) {
-      auto result = load_result(dataset, alg, k);
-      if (!result) {
-        std::cerr << "Result for " << alg << " " << k
-                  << " not available: " << result.error() << '\n';
-        continue;
-      }
-      std::vector<double> means;
-      for (size_t i = 0; i < result->size(); i++) {
-        auto pref = std::vector<int>(result->begin(), result->begin() + i + 1);
-        std::cout << std::format("Evaluating {}/{}/{}: size {}", dataset, alg,
-                                 k, pref.size())
-                  << '\n';
-        auto mean = evaluate(pref);
-        means.push_back(mean);
-      }
-      auto saved = save_eval(dataset, alg, k, means);
-      if (!saved) {
-        log_io_error(std::format("Failed to save evaluation for {}", alg),
-                     saved.error());
-      }
+  // selection runs on the sparsified graph and evaluation on g; saved
+  // results are evaluated on g directly
+  const Graph* selection = &g;
+  Graph sparse(0);
+  if (sparsify_edges) {
+    options.dataset = std::format("{}-sparse{}", options.dataset,
+                                  *sparsify_edges);
+    if (mode != RunMode::Evaluate) {
+      SparsifyOptions sparsify;
+      sparsify.edges = static_cast<size_t>(*sparsify_edges);
+      sparsify.method = *im::parse_sparsify_method(
+          program.get<std::string>("--sparsify_method"));
+      sparsify.type = options.type;
+      auto sparsified = im::sparsify_graph(g, sparsify, pool.get());
+      log_info("Sparsified to {} of {} edges, influence error bound {:.4g}",
+               sparsified.graph.m, g.m, sparsified.error_bound);
+      sparse = std::move(sparsified.graph);
+      selection = &sparse;
+      options.evaluation_graph = &g;
     }
   }
+  // evaluation after selection on a sparsified graph reads the full one
+  std::unique_ptr<GraphReplicas> replicas;
+  std::unique_ptr<GraphReplicas> evaluation_replicas;
+  if (numa) {
+    replicas = std::make_unique<GraphReplicas>(*selection, topology);
+    if (options.evaluation_graph != nullptr) {
+      evaluation_replicas =
+          std::make_unique<GraphReplicas>(*options.evaluation_graph, topology);
+    }
+  }
+  im::run_batch(*selection, options, *runs, mode, pool.get());
 
+  if (trace_path) {
+    auto written = im::write_trace(*trace_path);
+    if (!written) {
+      std::cerr << written.error() << '\n';
+      return 1;
+    }
+  }
   return 0;
 }
@@ -0,0 +1,190 @@
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "log.hpp"
+#include "numa.hpp"
+
+namespace im {
+
+namespace {
+
+// from linux/mempolicy.h
+constexpr int mpol_default = 0;
+constexpr int mpol_bind = 2;
+
+thread_local int current_node = -1;  // index into the topology's nodes
+
+std::mutex replicas_mutex;
+std::vector<const GraphReplicas*> registered;
+
+[[nodiscard]] auto bind_memory(int mode, const std::vector<int>& node_ids)
+    -> bool {
+  std::vector<unsigned long> mask;
+  for (auto id : node_ids) {
+    constexpr auto bits = 8 * sizeof(unsigned long);
+    mask.resize(std::max(mask.size(), id / bits + 1), 0);
+    mask[id / bits] |= 1UL << (id % bits);
+  }
+  auto max_node = mask.size() * 8 * sizeof(unsigned long) + 1;
+  return syscall(SYS_set_mempolicy, mode, mask.empty() ? nullptr : mask.data(),
+                 mask.empty() ? 0 : max_node) == 0;
+}
+
+}  // namespace
+
+auto parse_cpu_list(std::string_view text)
+    -> std::expected<std::vector<int>, error_t> {
+  auto parse_int = [](std::string_view part) -> std::expected<int, error_t> {
+    int value = 0;
+    auto [end, ec] = std::from_chars(part.data(), part.data() + part.size(),
+                                     value);
+    if (ec != std::errc() || end != part.data() + part.size()) {
+      return std::unexpected(std::format("Invalid CPU '{}'", part));
+    }
+    return value;
+  };
+
+  while (!text.empty() && (text.back() == '\n' || text.back() == ' ')) {
+    text.remove_suffix(1);
+  }
+  std::vector<int> cpus;
+  while (!text.empty()) {
+    auto comma = text.find(',');
+    auto part = text.substr(0, comma);
+    text = comma == std::string_view::npos ? "" : text.substr(comma + 1);
+    auto dash = part.find('-');
+    auto first = parse_int(part.substr(0, dash));
+    if (!first) {
+      return std::unexpected(first.error());
+    }
+    auto last = dash == std::string_view::npos
+                    ? first
+                    : parse_int(part.substr(dash + 1));
+    if (!last) {
+      return std::unexpected(last.error());
+    }
+    for (auto cpu = *first; cpu <= *last; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+auto NumaTopology::detect() -> NumaTopology {
+  NumaTopology topology;
+  std::error_code ec;
+  for (const auto& entry : std::filesystem::directory_iterator(
+           "/sys/devices/system/node", ec)) {
+    auto name = entry.path().filename().string();
+    if (!name.starts_with("node")) {
+      continue;
+    }
+    int id = 0;
+    auto [end, parsed] = std::from_chars(name.data() + 4,
+                                         name.data() + name.size(), id);
+    if (parsed != std::errc() || end != name.data() + name.size()) {
+      continue;
+    }
+    std::ifstream f(entry.path() / "cpulist");
+    std::string line;
+    std::getline(f, line);
+    auto cpus = parse_cpu_list(line);
+    if (cpus && !cpus->empty()) {  // memory-only nodes run no threads
+      topology.nodes.push_back({id, *std::move(cpus)});
+    }
+  }
+  std::ranges::sort(topology.nodes, {}, &NumaNode::id);
+  if (topology.nodes.empty()) {
+    std::vector<int> cpus(std::max(1U, std::thread::hardware_concurrency()));
+    for (size_t cpu = 0; cpu < cpus.size(); cpu++) {
+      cpus[cpu] = static_cast<int>(cpu);
+    }
+    topology.nodes.push_back({0, std::move(cpus)});
+  }
+  return topology;
+}
+
+auto pin_to_node(const NumaTopology& topology, size_t node)
+    -> std::expected<void, error_t> {
+  if (node >= topology.nodes.size()) {
+    return std::unexpected(std::format("No NUMA node {}", node));
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : topology.nodes[node].cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  if (syscall(SYS_sched_setaffinity, 0, sizeof(set), &set) != 0) {
+    return std::unexpected(
+        std::format("Failed to pin to NUMA node {}: {}",
+                    topology.nodes[node].id, std::strerror(errno)));
+  }
+  current_node = static_cast<int>(node);
+  return {};
+}
+
+GraphReplicas::GraphReplicas(const Graph& g, const NumaTopology& topology)
+    : original(g), replicas() {
+  if (topology.nodes.size() > 1) {
+    replicas.resize(topology.nodes.size());
+    for (size_t node = 0; node < topology.nodes.size(); node++) {
+      // a fresh thread allocates from an arena of its own, so the copy
+      // lands on untouched pages
+      std::jthread([&, node] {
+        auto pinned = pin_to_node(topology, node);
+        if (!pinned) {
+          log_warn("{}", pinned.error());
+        }
+        auto bound = bind_memory(mpol_bind, {topology.nodes[node].id});
+        replicas[node] = std::make_unique<Graph>(g);
+        if (bound) {
+          std::ignore = bind_memory(mpol_default, {});
+        }
+      }).join();
+    }
+    log_info("Replicated the graph on {} NUMA nodes", replicas.size());
+  }
+  std::scoped_lock lock(replicas_mutex);
+  registered.push_back(this);
+}
+
+GraphReplicas::~GraphReplicas() {
+  std::scoped_lock lock(replicas_mutex);
+  std::erase(registered, this);
+}
+
+auto numa_local(const Graph& g) -> const Graph& {
+  if (current_node < 0) {
+    return g;
+  }
+  std::scoped_lock lock(replicas_mutex);
+  // g may itself be a replica, handed down by a thread of another node
+  for (const auto* r : registered) {
+    if (static_cast<size_t>(current_node) >= r->replicas.size()) {
+      continue;
+    }
+    auto copy = [&](const auto& replica) { return replica.get() == &g; };
+    if (&r->original == &g || std::ranges::any_of(r->replicas, copy)) {
+      return *r->replicas[current_node];
+    }
+  }
+  return g;
+}
+
+}  // namespace im
@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "prep.hpp"
+#include "trace.hpp"
+
+namespace im {
+
+namespace {
+
+struct RawEdge {
+  int u;
+  int v;
+  weight_t p;
+};
+
+[[nodiscard]] auto is_space(char c) -> bool {
+  return c == ' ' || c == '\t' || c == '\r' || c == ',';
+}
+
+// Splits a line into at most 3 fields; returns how many there are
+[[nodiscard]] auto split_fields(std::string_view line,
+                                std::array<std::string_view, 3>& fields)
+    -> size_t {
+  size_t count = 0;
+  size_t i = 0;
+  while (count < fields.size()) {
+    while (i < line.size() && is_space(line[i])) {
+      i++;
+    }
+    if (i == line.size()) {
+      break;
+    }
+    auto start = i;
+    while (i < line.size() && !is_space(line[i])) {
+      i++;
+    }
+    fields[count++] = line.substr(start, i - start);
+  }
+  return count;
+}
+
+template <typename T>
+[[nodiscard]] auto parse_number(std::string_view text, T& value) -> bool {
+  const auto* end = text.data() + text.size();
+  auto [ptr, ec] = std::from_chars(text.data(), end, value);
+  return ec == std::errc() && ptr == end;
+}
+
+}  // namespace
+
+auto parse_prep_weights(std::string_view name)
+    -> std::expected<PrepWeights, error_t> {
+  if (name == "input") {
+    return PrepWeights::Input;
+  }
+  if (name == "wc") {
+    return PrepWeights::WeightedCascade;
+  }
+  if (name == "trivalency") {
+    return PrepWeights::Trivalency;
+  }
+  if (name == "uniform") {
+    return PrepWeights::Uniform;
+  }
+  if (name == "lt") {
+    return PrepWeights::LinearThreshold;
+  }
+  return std::unexpected(std::format("Unknown weight model '{}'", name));
+}
+
+auto parse_id_map(std::istream& is) -> std::expected<IdMap, error_t> {
+  IdMap ids;
+  std::string line;
+  for (size_t i = 0; std::getline(is, line); i++) {
+    std::uint64_t input;
+    if (!parse_number(line, input)) {
+      return std::unexpected(
+          std::format("Invalid id map line {}: '{}'", i + 1, line));
+    }
+    if (ids.id(input) != static_cast<int>(i)) {
+      return std::unexpected(
+          std::format("Invalid id map line {}: {} repeated", i + 1, input));
+    }
+  }
+  return ids;
+}
+
+auto write_id_map(std::ostream& os, const IdMap& ids) -> void {
+  std::string text;
+  for (auto input : ids.original) {
+    text += std::format("{}\n", input);
+  }
+  os << text;
+}
+
+auto prepare_graph(std::istream& is, IdMap& ids, const PrepOptions& options)
+    -> std::expected<PreparedGraph, error_t> {
+  TraceSpan span("prepare graph");
+  PrepStats stats;
+  std::vector<RawEdge> edges;
+  std::string line;
+  std::array<std::string_view, 3> fields;
+  for (size_t number = 1; std::getline(is, line); number++) {
+    auto count = split_fields(line, fields);
+    if (count == 0 || fields[0].front() == '#' || fields[0].front() == '%') {
+      continue;
+    }
+    std::uint64_t from, to;
+    weight_t p = 1;
+    if (count < 2 || !parse_number(fields[0], from) ||
+        !parse_number(fields[1], to) ||
+        (count == 3 && !parse_number(fields[2], p))) {
+      return std::unexpected(std::format(
+          "Invalid edge on line {}: expected <u> <v> [<p>]", number));
+    }
+    if (count < 3 && options.weights == PrepWeights::Input) {
+      return std::unexpected(std::format(
+          "No probability on line {}; choose a weight model", number));
+    }
+    if (p < 0 || p > 1) {
+      return std::unexpected(
+          std::format("Probability {} out of [0, 1] on line {}", p, number));
+    }
+    stats.lines++;
+    auto u = ids.id(from);
+    auto v = ids.id(to);
+    if (u == v) {
+      stats.self_loops++;
+      continue;
+    }
+    edges.push_back({u, v, p});
+    if (options.undirected) {
+      edges.push_back({v, u, p});
+    }
+  }
+
+  // parallel edges next to each other, each vertex's targets in order
+  std::ranges::sort(edges, [](const RawEdge& a, const RawEdge& b) {
+    return a.u != b.u ? a.u < b.u : a.v < b.v;
+  });
+  size_t kept = 0;
+  for (size_t i = 0; i < edges.size();) {
+    auto edge = edges[i];
+    auto missing = 1 - edge.p;  // chance that none of them fires
+    auto j = i + 1;
+    for (; j < edges.size() && edges[j].u == edge.u && edges[j].v == edge.v;
+         j++) {
+      missing *= 1 - edges[j].p;
+    }
+    if (j > i + 1) {
+      stats.merged += j - i - 1;
+      edge.p = 1 - missing;
+    }
+    if (edge.p > 0) {
+      edges[kept++] = edge;
+    } else {
+      stats.zero++;
+    }
+    i = j;
+  }
+  edges.resize(kept);
+
+  auto raise = [&](double p) {
+    return options.exponent == 1 ? p : std::pow(p, options.exponent);
+  };
+  // LT raises the input's probabilities before scaling them, so that they
+  // still sum to 1 into every vertex; the other models raise their own
+  if (options.weights == PrepWeights::LinearThreshold) {
+    for (auto& e : edges) {
+      e.p = raise(e.p);
+    }
+  }
+
+  // the sums of the probabilities into every vertex
+  std::vector<double> in_weight;
+  if (options.weights == PrepWeights::WeightedCascade ||
+      options.weights == PrepWeights::LinearThreshold) {
+    in_weight.assign(static_cast<size_t>(ids.size()), 0.0);
+    for (const auto& e : edges) {
+      in_weight[e.v] +=
+          options.weights == PrepWeights::WeightedCascade ? 1.0 : e.p;
+    }
+  }
+  constexpr std::array trivalency{0.1, 0.01, 0.001};
+  Graph g(ids.size());
+  std::uint64_t index = 0;
+  for (const auto& e : edges) {
+    auto p = e.p;
+    switch (options.weights) {
+      case PrepWeights::Input:
+        break;
+      case PrepWeights::WeightedCascade:
+        p = 1.0 / in_weight[e.v];
+        break;
+      case PrepWeights::Trivalency:
+        p = trivalency[static_cast<size_t>(
+            hash_uniform(options.seed, index) * trivalency.size())];
+        break;
+      case PrepWeights::Uniform:
+        p = options.probability;
+        break;
+      case PrepWeights::LinearThreshold:
+        p /= in_weight[e.v];
+        break;
+    }
+    if (options.weights != PrepWeights::LinearThreshold) {
+      p = raise(p);
+    }
+    g.add_edge(e.u, e.v, p);
+    index++;
+  }
+  return PreparedGraph{std::move(g), stats};
+}
+
+}  // namespace im
@@ -0,0 +1,125 @@
+#include <expected>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+
+#include <argparse/argparse.hpp>
+
+#include "graph.hpp"
+#include "prep.hpp"
+
+int main(int argc, char** argv) {
+  argparse::ArgumentParser program("bandit-im-prep");
+  program.add_argument("input")
+      .help("Edge list: \"u v\" or \"u v p\" per line, '#' or '%' comments, "
+            "any non-negative vertex ids; - for standard input");
+  program.add_argument("output")
+      .help("Graph to write: text if it ends in .txt, otherwise binary, e.g. "
+            "data/<name>/<name>.bin to run bandit-im on <name>");
+  program.add_argument("--weights")
+      .help("Edge probabilities: the input's (input), weighted cascade "
+            "(1 / in-degree), trivalency (0.1, 0.01 or 0.001), uniform, or "
+            "the input's scaled to sum to 1 into every vertex (lt)")
+      .default_value(std::string("input"))
+      .choices("input", "wc", "trivalency", "uniform", "lt");
+  program.add_argument("--p")
+      .help("Probability of every edge with --weights uniform")
+      .default_value(0.1)
+      .scan<'f', double>();
+  program.add_argument("--exponent")
+      .help("Raise the final probabilities to this power, e.g. 0.65 turns "
+            "data/congress/congress_orig.txt into congress.txt")
+      .default_value(1.0)
+      .scan<'f', double>();
+  program.add_argument("--seed").default_value(1).scan<'i', int>();
+  program.add_argument("--undirected")
+      .help("Add every input edge in both directions")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--ids")
+      .help("Id map, one input id per line of the dense ids: read first if "
+            "it exists, so that vertices keep their ids, and written with "
+            "the new ones (default: the output with extension .ids)");
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::exception& err) {
+    std::cerr << err.what() << '\n';
+    std::cerr << program;
+    return 1;
+  }
+
+  PrepOptions options;
+  options.weights =
+      *im::parse_prep_weights(program.get<std::string>("--weights"));
+  options.probability = program.get<double>("--p");
+  options.seed = static_cast<seed_type>(program.get<int>("--seed"));
+  options.undirected = program.get<bool>("--undirected");
+  options.exponent = program.get<double>("--exponent");
+  if (options.probability <= 0 || options.probability > 1 ||
+      options.exponent <= 0) {
+    std::cerr << "Needs 0 < p <= 1 and exponent > 0\n";
+    return 1;
+  }
+
+  auto output = std::filesystem::path(program.get<std::string>("output"));
+  auto ids_path = program.present<std::string>("--ids").value_or(
+      std::filesystem::path(output).replace_extension(".ids").string());
+  IdMap ids;
+  if (std::filesystem::exists(ids_path)) {
+    std::ifstream f(ids_path);
+    auto loaded = im::parse_id_map(f);
+    if (!loaded) {
+      std::cerr << ids_path << ": " << loaded.error() << '\n';
+      return 1;
+    }
+    ids = *std::move(loaded);
+  }
+
+  auto input = program.get<std::string>("input");
+  auto prepared = [&] {
+    if (input == "-") {
+      return im::prepare_graph(std::cin, ids, options);
+    }
+    std::ifstream f(input);
+    if (!f.is_open()) {
+      return std::expected<im::PreparedGraph, im::error_t>(
+          std::unexpected("Failed to open input file " + input));
+    }
+    return im::prepare_graph(f, ids, options);
+  }();
+  if (!prepared) {
+    std::cerr << prepared.error() << '\n';
+    return 1;
+  }
+  const auto& [g, stats] = *prepared;
+  std::cerr << "Read " << stats.lines << " edges: dropped " << stats.self_loops
+            << " self-loops and " << stats.zero
+            << " zero-probability edges, merged " << stats.merged
+            << " parallel edges; wrote n = " << g.n << ", m = " << g.m
+            << '\n';
+
+  if (!output.parent_path().empty()) {
+    std::filesystem::create_directories(output.parent_path());
+  }
+  std::ofstream f(output, std::ios::binary);
+  if (!f.is_open()) {
+    std::cerr << "Failed to open output file " << output.string() << '\n';
+    return 1;
+  }
+  if (output.extension() == ".txt") {
+    im::write_graph(f, g);
+  } else {
+    im::write_binary_graph(f, g);
+  }
+  std::ofstream id_file(ids_path);
+  im::write_id_map(id_file, ids);
+  if (!f || !id_file) {
+    std::cerr << "Failed to write " << output.string() << " or " << ids_path
+              << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <cstddef>
+#include <format>
+#include <fstream>
+#include <istream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "profiles.hpp"
+#include "trace.hpp"
+
+namespace im {
+
+namespace {
+
+// Reads the probabilities of a file with the topology of g as those of a
+// profile. The out-edges of every vertex must come in the same order as
+// in the first file; the edges of different vertices may interleave.
+[[nodiscard]] auto parse_weights(std::istream& is,
+                                 ProfileGraph& g,
+                                 size_t profile)
+    -> std::expected<void, error_t> {
+  int n, m;
+  if (!(is >> n >> m)) {
+    return std::unexpected("Invalid graph header: expected <n> <m>");
+  }
+  if (n != g.graph.n || m != g.graph.m) {
+    return std::unexpected(std::format(
+        "Different topology: {} vertices and {} edges, expected {} and {}", n,
+        m, g.graph.n, g.graph.m));
+  }
+  auto P = g.profiles();
+  std::vector<size_t> seen(static_cast<size_t>(n), 0);  // edges per source
+  for (int i = 0; i < m; i++) {
+    int u, v;
+    weight_t w;
+    if (!(is >> u >> v >> w)) {
+      return std::unexpected(std::format(
+          "Invalid edge at index {}: expected <u> <v> <w>", i));
+    }
+    if (u < 0 || u >= n) {
+      return std::unexpected(std::format(
+          "Invalid edge at index {}: vertex out of range [{}..{})", i, 0, n));
+    }
+    const auto& edges = g.graph.adj[u];
+    auto position = seen[u]++;
+    if (position >= edges.size() || edges[position].to != v) {
+      return std::unexpected(std::format(
+          "Different topology: edge {} ({} {}) is not edge {} of {}", i, u, v,
+          position, u));
+    }
+    g.weights[(g.first_edge[u] + position) * P + profile] = w;
+  }
+  return {};
+}
+
+// source is a file name or the content of one, as for load_graph_expected
+[[nodiscard]] auto load_weights(std::string_view source,
+                                ProfileGraph& g,
+                                size_t profile)
+    -> std::expected<void, error_t> {
+  if (source.find('\n') != std::string_view::npos) {
+    auto iss = std::istringstream(std::string(source));
+    return parse_weights(iss, g, profile);
+  }
+  std::ifstream file{std::string(source)};
+  if (!file.is_open()) {
+    return std::unexpected(std::format("Failed to open file: {}", source));
+  }
+  return parse_weights(file, g, profile);
+}
+
+}  // namespace
+
+auto ProfileGraph::find(std::string_view name) const -> std::optional<size_t> {
+  auto it = std::ranges::find(names, name);
+  if (it == names.end()) {
+    return std::nullopt;
+  }
+  return static_cast<size_t>(it - names.begin());
+}
+
+auto ProfileGraph::use(size_t profile) -> void {
+  for (int u = 0; u < graph.n; u++) {
+    auto e = first_edge[u];
+    for (auto& edge : graph.adj[u]) {
+      edge.weight = weight(e++, profile);
+    }
+  }
+  current = profile;
+}
+
+auto load_profile_graph(
+    std::span<const std::pair<std::string, std::string>> sources)
+    -> std::expected<ProfileGraph, error_t> {
+  TraceSpan span("profiles load");
+  if (sources.empty()) {
+    return std::unexpected("No profiles given");
+  }
+  if (sources.size() > ProfileGraph::max_profiles) {
+    return std::unexpected(std::format("At most {} profiles are supported",
+                                       ProfileGraph::max_profiles));
+  }
+  ProfileGraph g;
+  const auto& [first_name, first_source] = sources.front();
+  auto graph = load_graph_expected(first_source);
+  if (!graph) {
+    return std::unexpected(
+        std::format("Profile {}: {}", first_name, graph.error()));
+  }
+  g.graph = *std::move(graph);
+  for (const auto& [name, source] : sources) {
+    if (g.find(name)) {
+      return std::unexpected(std::format("Duplicate profile {}", name));
+    }
+    g.names.push_back(name);
+  }
+  auto P = g.profiles();
+  g.first_edge.reserve(static_cast<size_t>(g.graph.n) + 1);
+  g.weights.resize(static_cast<size_t>(g.graph.m) * P);
+  size_t e = 0;
+  for (const auto& edges : g.graph.adj) {
+    g.first_edge.push_back(e);
+    for (const auto& edge : edges) {
+      g.weights[e++ * P] = edge.weight;
+    }
+  }
+  g.first_edge.push_back(e);
+
+  for (size_t p = 1; p < P; p++) {
+    const auto& [name, source] = sources[p];
+    auto loaded = load_weights(source, g, p);
+    if (!loaded) {
+      return std::unexpected(
+          std::format("Profile {}: {}", name, loaded.error()));
+    }
+  }
+  return g;
+}
+
+auto evaluate_profiles(const ProfileGraph& g,
+                       DiffusionType type,
+                       const std::vector<std::vector<int>>& lists,
+                       seed_type seed,
+                       ConfidenceTarget target,
+                       ThreadPool* pool)
+    -> std::vector<std::vector<RunningStats>> {
+  TraceSpan span("evaluate profiles", "lists", std::ssize(lists));
+  constexpr size_t min_worlds = 100;
+  constexpr double growth = 1.25;
+  constexpr size_t chunk = 64;
+  auto P = g.profiles();
+  std::vector<std::vector<RunningStats>> stats(
+      lists.size(), std::vector<RunningStats>(P));
+  WorkerLocal<MultiProfileSolver> solvers(
+      pool, [&] { return MultiProfileSolver(g, seed); });
+
+  auto met = [&] {
+    return std::ranges::all_of(stats, [&](const auto& list) {
+      return std::ranges::all_of(
+          list, [&](const auto& s) { return target.met(s); });
+    });
+  };
+  size_t world = 0;
+  size_t next_check = min_worlds;
+  std::vector<std::vector<std::vector<RunningStats>>> chunk_stats;
+  while (world == 0 || !met()) {
+    auto n_chunks = (next_check - world + chunk - 1) / chunk;
+    chunk_stats.assign(n_chunks, {});
+    auto run_chunk = [&](size_t worker, size_t part) {
+      auto& solver = solvers[worker];
+      auto first = world + part * chunk;
+      auto last = std::min(first + chunk, next_check);
+      solver.seed(mix64(seed + mix64(first)));
+      auto& partial = chunk_stats[part];
+      partial.assign(lists.size(), std::vector<RunningStats>(P));
+      std::vector<double> sizes(P);
+      for (auto w = first; w < last; w++) {
+        for (size_t l = 0; l < lists.size(); l++) {
+          solver.run(type, lists[l], sizes);
+          for (size_t p = 0; p < P; p++) {
+            partial[l][p].add(sizes[p]);
+          }
+        }
+      }
+    };
+    if (pool == nullptr) {
+      for (size_t part = 0; part < n_chunks; part++) {
+        run_chunk(0, part);
+      }
+    } else {
+      pool->parallel_for(n_chunks, run_chunk);
+    }
+    for (const auto& partial : chunk_stats) {
+      for (size_t l = 0; l < lists.size(); l++) {
+        for (size_t p = 0; p < P; p++) {
+          stats[l][p].merge(partial[l][p]);
+        }
+      }
+    }
+    world = next_check;
+    next_check = static_cast<size_t>(static_cast<double>(world) * growth);
+  }
+  return stats;
+}
+
+}  // namespace im
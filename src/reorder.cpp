@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <format>
+#include <functional>
+#include <numeric>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "reorder.hpp"
+
+namespace im {
+
+namespace {
+
+// Each vertex's neighbours in either direction, without duplicates
+[[nodiscard]] auto undirected_neighbours(const Graph& g)
+    -> std::vector<std::vector<int>> {
+  std::vector<std::vector<int>> neighbours(g.n);
+  for (int u = 0; u < g.n; u++) {
+    for (const auto& e : g[u]) {
+      if (e.to != u) {
+        neighbours[u].push_back(e.to);
+        neighbours[e.to].push_back(u);
+      }
+    }
+  }
+  for (auto& list : neighbours) {
+    std::ranges::sort(list);
+    auto [first, last] = std::ranges::unique(list);
+    list.erase(first, last);
+  }
+  return neighbours;
+}
+
+// Reverse Cuthill-McKee: BFS from a vertex of least degree in every
+// component, visiting neighbours by increasing degree, then reversed
+[[nodiscard]] auto rcm_order(const Graph& g) -> std::vector<int> {
+  auto neighbours = undirected_neighbours(g);
+  auto degree = [&](int v) { return neighbours[v].size(); };
+  std::vector<int> by_degree(g.n);
+  std::iota(by_degree.begin(), by_degree.end(), 0);
+  std::ranges::stable_sort(by_degree, {}, degree);
+
+  std::vector<int> order;
+  order.reserve(g.n);
+  std::vector<bool> visited(g.n, false);
+  for (auto start : by_degree) {
+    if (visited[start]) {
+      continue;
+    }
+    visited[start] = true;
+    order.push_back(start);
+    for (auto q = order.size() - 1; q < order.size(); q++) {
+      auto& next = neighbours[order[q]];
+      std::ranges::stable_sort(next, {}, degree);
+      for (auto v : next) {
+        if (!visited[v]) {
+          visited[v] = true;
+          order.push_back(v);
+        }
+      }
+    }
+  }
+  std::ranges::reverse(order);
+  return order;
+}
+
+}  // namespace
+
+auto parse_vertex_order(std::string_view name)
+    -> std::expected<VertexOrder, error_t> {
+  if (name == "none") {
+    return VertexOrder::Original;
+  }
+  if (name == "degree") {
+    return VertexOrder::Degree;
+  }
+  if (name == "rcm") {
+    return VertexOrder::Rcm;
+  }
+  return std::unexpected(std::format("Unknown vertex order '{}'", name));
+}
+
+auto VertexPermutation::original(std::span<const int> ids) const
+    -> std::vector<int> {
+  std::vector<int> mapped;
+  mapped.reserve(ids.size());
+  for (auto id : ids) {
+    mapped.push_back(to_original[id]);
+  }
+  return mapped;
+}
+
+auto VertexPermutation::graph(std::span<const int> ids) const
+    -> std::vector<int> {
+  std::vector<int> mapped;
+  mapped.reserve(ids.size());
+  for (auto id : ids) {
+    mapped.push_back(to_graph[id]);
+  }
+  return mapped;
+}
+
+auto vertex_order(const Graph& g, VertexOrder order) -> VertexPermutation {
+  VertexPermutation permutation;
+  auto& to_original = permutation.to_original;
+  switch (order) {
+    case VertexOrder::Original:
+      to_original.resize(g.n);
+      std::iota(to_original.begin(), to_original.end(), 0);
+      break;
+    case VertexOrder::Degree: {
+      std::vector<int> degree(g.n, 0);
+      for (int u = 0; u < g.n; u++) {
+        degree[u] += static_cast<int>(g[u].size());
+        for (const auto& e : g[u]) {
+          degree[e.to]++;
+        }
+      }
+      to_original.resize(g.n);
+      std::iota(to_original.begin(), to_original.end(), 0);
+      std::ranges::stable_sort(to_original, std::greater{},
+                               [&](int v) { return degree[v]; });
+      break;
+    }
+    case VertexOrder::Rcm:
+      to_original = rcm_order(g);
+      break;
+  }
+  permutation.to_graph.resize(g.n);
+  for (int v = 0; v < g.n; v++) {
+    permutation.to_graph[to_original[v]] = v;
+  }
+  return permutation;
+}
+
+auto reorder_graph(const Graph& g, const VertexPermutation& permutation)
+    -> Graph {
+  Graph reordered(g.n);
+  for (int v = 0; v < g.n; v++) {
+    const auto& edges = g[permutation.to_original[v]];
+    auto& adj = reordered.adj[v];
+    adj.reserve(edges.size());
+    for (const auto& e : edges) {
+      adj.push_back({permutation.to_graph[e.to], e.weight});
+    }
+    std::ranges::stable_sort(adj, {}, &Edge::to);
+    reordered.m += static_cast<int>(adj.size());
+  }
+  return reordered;
+}
+
+}  // namespace im
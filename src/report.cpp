@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <format>
+#include <limits>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "evaluate.hpp"
+#include "report.hpp"
+#include "results.hpp"
+
+namespace im {
+
+namespace {
+
+constexpr auto nan = std::numeric_limits<double>::quiet_NaN();
+
+// JSON has no NaN
+[[nodiscard]] auto json_number(double value) -> std::string {
+  return std::isfinite(value) ? std::format("{}", value) : "null";
+}
+
+[[nodiscard]] auto csv_number(double value) -> std::string {
+  return std::isfinite(value) ? std::format("{}", value) : "";
+}
+
+[[nodiscard]] auto json_median(const MedianEstimate& estimate)
+    -> std::string {
+  return std::format("{{\"median\":{},\"low\":{},\"high\":{}}}",
+                     json_number(estimate.median), json_number(estimate.low),
+                     json_number(estimate.high));
+}
+
+[[nodiscard]] auto final_influence(const AlgoReport& report) -> double {
+  return report.influence.empty() ? nan : report.influence.back().mean;
+}
+
+}  // namespace
+
+auto median_estimate(std::vector<double> values) -> MedianEstimate {
+  if (values.empty()) {
+    return {nan, nan, nan};
+  }
+  std::ranges::sort(values);
+  auto n = values.size();
+  auto middle = n % 2 == 1 ? values[n / 2]
+                           : (values[n / 2 - 1] + values[n / 2]) / 2;
+  // ranks j and k (from 1) with P(j <= median rank <= k) ~ 0.95
+  auto spread = 0.98 * std::sqrt(static_cast<double>(n));
+  auto j = std::floor(n / 2.0 - spread);
+  auto k = std::ceil(n / 2.0 + 1 + spread);
+  auto low = static_cast<size_t>(std::clamp(j, 1.0, static_cast<double>(n)));
+  auto high = static_cast<size_t>(std::clamp(k, 1.0, static_cast<double>(n)));
+  return {middle, values[low - 1], values[high - 1]};
+}
+
+auto summarize_results(const ResultReader& store) -> std::vector<AlgoReport> {
+  struct Runs {
+    std::vector<double> seconds;
+    std::vector<double> samples;
+    std::vector<double> peak_rss_mib;
+    std::vector<RunningStats> influence;
+  };
+  std::map<std::string, Runs> by_alg;
+  for (const auto& [run, alg] : store.runs()) {
+    auto& runs = by_alg[alg];
+    auto cost = store.selection_cost(run, alg);
+    runs.seconds.push_back(cost->seconds);
+    runs.samples.push_back(static_cast<double>(cost->samples));
+    if (cost->peak_rss_kib > 0) {
+      runs.peak_rss_mib.push_back(cost->peak_rss_kib / 1024.0);
+    }
+    auto evaluation = store.evaluation(run, alg);
+    if (!evaluation) {
+      continue;
+    }
+    if (runs.influence.size() < evaluation->size()) {
+      runs.influence.resize(evaluation->size());
+    }
+    for (size_t i = 0; i < evaluation->size(); i++) {
+      runs.influence[i].add((*evaluation)[i].mean);
+    }
+  }
+
+  std::vector<AlgoReport> reports;
+  for (auto& [alg, runs] : by_alg) {
+    AlgoReport report{alg,
+                      runs.seconds.size(),
+                      median_estimate(runs.seconds),
+                      median_estimate(runs.samples),
+                      median_estimate(runs.peak_rss_mib),
+                      std::move(runs.influence),
+                      nan,
+                      false};
+    report.influence_per_second = final_influence(report) /
+                                  report.seconds.median;
+    reports.push_back(std::move(report));
+  }
+
+  for (auto& report : reports) {
+    auto quality = final_influence(report);
+    auto time = report.seconds.median;
+    report.frontier =
+        std::isfinite(quality) &&
+        std::ranges::none_of(reports, [&](const AlgoReport& other) {
+          auto other_quality = final_influence(other);
+          auto other_time = other.seconds.median;
+          return other_quality >= quality && other_time <= time &&
+                 (other_quality > quality || other_time < time);
+        });
+  }
+  return reports;
+}
+
+auto write_report_json(std::ostream& out,
+                       const std::vector<AlgoReport>& reports) -> void {
+  out << "{\"algorithms\":[";
+  for (size_t a = 0; a < reports.size(); a++) {
+    const auto& report = reports[a];
+    out << std::format(
+        "{}\n{{\"alg\":\"{}\",\"runs\":{},\"seconds\":{},\"samples\":{},"
+        "\"peak_rss_mib\":{},\"influence\":[",
+        a == 0 ? "" : ",", report.alg, report.runs,
+        json_median(report.seconds), json_median(report.samples),
+        json_median(report.peak_rss_mib));
+    for (size_t i = 0; i < report.influence.size(); i++) {
+      const auto& prefix = report.influence[i];
+      out << std::format("{}{{\"mean\":{},\"half_width\":{},\"runs\":{}}}",
+                         i == 0 ? "" : ",", json_number(prefix.mean),
+                         json_number(prefix.half_width()), prefix.count);
+    }
+    out << std::format("],\"influence_per_second\":{},\"frontier\":{}}}",
+                       json_number(report.influence_per_second),
+                       report.frontier);
+  }
+  out << "\n]}\n";
+}
+
+auto write_report_csv(std::ostream& out,
+                      const std::vector<AlgoReport>& reports) -> void {
+  out << "alg,prefix,runs,evaluated_runs,influence_mean,influence_half_width,"
+         "seconds_median,seconds_low,seconds_high,samples_median,samples_low,"
+         "samples_high,peak_rss_mib_median,influence_per_second,frontier\n";
+  for (const auto& report : reports) {
+    auto costs = std::format(
+        "{},{},{},{},{},{},{},{},{}", csv_number(report.seconds.median),
+        csv_number(report.seconds.low), csv_number(report.seconds.high),
+        csv_number(report.samples.median), csv_number(report.samples.low),
+        csv_number(report.samples.high),
+        csv_number(report.peak_rss_mib.median),
+        csv_number(report.influence_per_second), report.frontier);
+    if (report.influence.empty()) {
+      out << std::format("{},,{},0,,,{}\n", report.alg, report.runs, costs);
+    }
+    for (size_t i = 0; i < report.influence.size(); i++) {
+      const auto& prefix = report.influence[i];
+      out << std::format("{},{},{},{},{},{},{}\n", report.alg, i + 1,
+                         report.runs, prefix.count, prefix.mean,
+                         csv_number(prefix.half_width()), costs);
+    }
+  }
+}
+
+}  // namespace im
@@ -0,0 +1,533 @@
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "log.hpp"
+#include "results.hpp"
+
+namespace im {
+
+namespace {
+
+// Holds a file descriptor, and the flock on it, until leaving scope
+struct LockedFile {
+  int fd;
+
+  LockedFile(const std::string& path, int flags)
+      : fd(::open(path.c_str(), flags, 0644)) {}
+  LockedFile(const LockedFile&) = delete;
+  auto operator=(const LockedFile&) -> LockedFile& = delete;
+  ~LockedFile() {
+    if (fd >= 0) {
+      close(fd);  // releases the lock
+    }
+  }
+
+  [[nodiscard]] auto lock(int operation) const -> bool {
+    while (flock(fd, operation) < 0) {
+      if (errno != EINTR) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+[[nodiscard]] auto system_error(std::string_view context,
+                                const std::string& path) -> error_t {
+  return std::format("{} {}: {}", context, path, std::strerror(errno));
+}
+
+[[nodiscard]] auto read_all(int fd, char* data, size_t size) -> bool {
+  while (size > 0) {
+    auto got = read(fd, data, size);
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got <= 0) {
+      return false;
+    }
+    data += got;
+    size -= static_cast<size_t>(got);
+  }
+  return true;
+}
+
+[[nodiscard]] auto write_all(int fd, const char* data, size_t size) -> bool {
+  while (size > 0) {
+    auto sent = write(fd, data, size);
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    if (sent < 0) {
+      return false;
+    }
+    data += sent;
+    size -= static_cast<size_t>(sent);
+  }
+  return true;
+}
+
+[[nodiscard]] auto valid_header(const ResultHeader& header) -> bool {
+  return std::ranges::equal(header.magic, result_header.magic) &&
+         header.version == result_header.version &&
+         header.record_size == result_header.record_size;
+}
+
+[[nodiscard]] auto new_record(RecordKind kind,
+                              int run,
+                              std::string_view alg,
+                              size_t step,
+                              size_t steps)
+    -> std::expected<ResultRecord, error_t> {
+  if (alg.size() > max_alg_name) {
+    return std::unexpected(std::format(
+        "Algorithm name {} is longer than {} bytes", alg, max_alg_name));
+  }
+  ResultRecord record{};
+  record.kind = kind;
+  record.run = run;
+  std::ranges::copy(alg, record.alg);
+  record.step = static_cast<std::uint32_t>(step);
+  record.steps = static_cast<std::uint32_t>(steps);
+  record.vertex = -1;
+  return record;
+}
+
+// of a ResultRecord or an IndexEntry
+[[nodiscard]] auto alg_name(const auto& record) -> std::string_view {
+  return {record.alg, std::ranges::find(record.alg, '\0')};
+}
+
+[[nodiscard]] auto valid_index_header(const IndexHeader& header) -> bool {
+  return std::ranges::equal(header.magic, index_header.magic) &&
+         header.version == index_header.version &&
+         header.entry_size == index_header.entry_size;
+}
+
+// Reads records first, first + 1, ... of the store open at fd into records
+[[nodiscard]] auto read_records(int fd,
+                                size_t first,
+                                std::span<ResultRecord> records) -> bool {
+  auto size = records.size_bytes();
+  auto offset = sizeof(ResultHeader) + first * sizeof(ResultRecord);
+  auto* data = reinterpret_cast<char*>(records.data());
+  while (size > 0) {
+    auto got = pread(fd, data, size, static_cast<off_t>(offset));
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got <= 0) {
+      return false;
+    }
+    data += got;
+    offset += static_cast<size_t>(got);
+    size -= static_cast<size_t>(got);
+  }
+  return true;
+}
+
+// The runs all of whose records are among `records`, the store's records
+// from number `first` on
+[[nodiscard]] auto index_records(std::span<const ResultRecord> records,
+                                 size_t first) -> std::vector<IndexEntry> {
+  std::vector<IndexEntry> entries;
+  for (size_t i = 0; i < records.size();) {
+    const auto& start = records[i];
+    size_t steps = start.steps;
+    auto complete =
+        start.step == 0 && steps > 0 && i + steps <= records.size();
+    for (size_t j = 1; complete && j < steps; j++) {
+      const auto& record = records[i + j];
+      complete = record.kind == start.kind && record.run == start.run &&
+                 record.step == j && alg_name(record) == alg_name(start);
+    }
+    if (!complete) {
+      i++;
+      continue;
+    }
+    IndexEntry entry{};
+    entry.kind = start.kind;
+    entry.run = start.run;
+    std::ranges::copy(start.alg, entry.alg);
+    entry.first = first + i;
+    entry.steps = steps;
+    entries.push_back(entry);
+    i += steps;
+  }
+  return entries;
+}
+
+// Brings the index of the store open (and locked) at store up to date with
+// its `records` records, of which `added` were just appended
+[[nodiscard]] auto update_index(const std::string& path,
+                                int store,
+                                size_t records,
+                                std::span<const ResultRecord> added)
+    -> std::expected<void, error_t> {
+  auto index = index_path(path);
+  LockedFile file(index, O_RDWR | O_CREAT | O_CLOEXEC);
+  if (file.fd < 0) {
+    return std::unexpected(system_error("Failed to open", index));
+  }
+  struct stat status{};
+  if (fstat(file.fd, &status) < 0) {
+    return std::unexpected(system_error("Failed to stat", index));
+  }
+  auto size = static_cast<size_t>(status.st_size);
+  auto header = index_header;
+  if (size < sizeof(IndexHeader) ||
+      pread(file.fd, &header, sizeof(header), 0) !=
+          static_cast<ssize_t>(sizeof(header)) ||
+      !valid_index_header(header) || header.records > records ||
+      records == added.size()) {
+    // missing, not this store's, or left by a removed one: indexed anew
+    header = index_header;
+    size = sizeof(IndexHeader);
+  }
+  // whole entries only, as a writer may have died halfway through one
+  size -= (size - sizeof(IndexHeader)) % sizeof(IndexEntry);
+  if (ftruncate(file.fd, static_cast<off_t>(size)) < 0) {
+    return std::unexpected(system_error("Failed to truncate", index));
+  }
+
+  auto appended_from = records - added.size();
+  std::vector<IndexEntry> entries;
+  if (header.records < appended_from) {
+    std::vector<ResultRecord> missed(appended_from - header.records);
+    if (!read_records(store, header.records, missed)) {
+      return std::unexpected(system_error("Failed to read", path));
+    }
+    entries = index_records(missed, header.records);
+  }
+  auto new_entries = index_records(added, appended_from);
+  entries.insert(entries.end(), new_entries.begin(), new_entries.end());
+
+  header.records = records;
+  if (pwrite(file.fd, entries.data(), entries.size() * sizeof(IndexEntry),
+             static_cast<off_t>(size)) !=
+          static_cast<ssize_t>(entries.size() * sizeof(IndexEntry)) ||
+      pwrite(file.fd, &header, sizeof(header), 0) !=
+          static_cast<ssize_t>(sizeof(header))) {
+    return std::unexpected(system_error("Failed to write", index));
+  }
+  return {};
+}
+
+}  // namespace
+
+auto results_path(std::string_view dataset) -> std::string {
+  return std::format("results/{}.imr", dataset);
+}
+
+auto index_path(std::string_view store_path) -> std::string {
+  return std::format("{}.idx", store_path);
+}
+
+auto counters_path(std::string_view dataset) -> std::string {
+  return std::format("results/{}.counters.jsonl", dataset);
+}
+
+auto profiles_path(std::string_view dataset) -> std::string {
+  return std::format("results/{}.profiles.jsonl", dataset);
+}
+
+auto selection_records(int run,
+                       const AlgoResult& result,
+                       double seconds,
+                       std::uint32_t peak_rss_kib)
+    -> std::expected<std::vector<ResultRecord>, error_t> {
+  if (result.seeds.size() != result.used_samples.size()) {
+    return std::unexpected("result and used_samples have different size");
+  }
+  std::vector<ResultRecord> records;
+  for (size_t i = 0; i < result.seeds.size(); i++) {
+    auto record = new_record(RecordKind::Selection, run, result.alg, i,
+                             result.seeds.size());
+    if (!record) {
+      return std::unexpected(record.error());
+    }
+    record->vertex = result.seeds[i];
+    record->used_samples = result.used_samples[i];
+    record->seconds = seconds;
+    record->peak_rss_kib = peak_rss_kib;
+    records.push_back(*record);
+  }
+  return records;
+}
+
+auto evaluation_records(int run,
+                        std::string_view alg,
+                        const std::vector<RunningStats>& stats,
+                        double seconds)
+    -> std::expected<std::vector<ResultRecord>, error_t> {
+  std::vector<ResultRecord> records;
+  for (size_t i = 0; i < stats.size(); i++) {
+    auto record =
+        new_record(RecordKind::Evaluation, run, alg, i, stats.size());
+    if (!record) {
+      return std::unexpected(record.error());
+    }
+    record->mean = stats[i].mean;
+    record->half_width = stats[i].half_width();
+    record->worlds = stats[i].count;
+    record->seconds = seconds;
+    records.push_back(*record);
+  }
+  return records;
+}
+
+auto append_records(const std::string& path,
+                    std::span<const ResultRecord> records)
+    -> std::expected<void, error_t> {
+  auto dir = std::filesystem::path(path).parent_path();
+  if (!dir.empty() && !std::filesystem::exists(dir)) {
+    std::filesystem::create_directories(dir);
+  }
+
+  LockedFile file(path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC);
+  if (file.fd < 0) {
+    return std::unexpected(system_error("Failed to open", path));
+  }
+  if (!file.lock(LOCK_EX)) {
+    return std::unexpected(system_error("Failed to lock", path));
+  }
+
+  struct stat status{};
+  if (fstat(file.fd, &status) < 0) {
+    return std::unexpected(system_error("Failed to stat", path));
+  }
+  auto size = static_cast<size_t>(status.st_size);
+  if (size == 0) {
+    if (!write_all(file.fd, reinterpret_cast<const char*>(&result_header),
+                   sizeof(ResultHeader))) {
+      return std::unexpected(system_error("Failed to write", path));
+    }
+    size = sizeof(ResultHeader);
+  } else {
+    ResultHeader header{};
+    if (pread(file.fd, &header, sizeof(header), 0) !=
+            static_cast<ssize_t>(sizeof(header)) ||
+        !valid_header(header)) {
+      return std::unexpected(std::format("{} is not a results store", path));
+    }
+    auto torn = (size - sizeof(ResultHeader)) % sizeof(ResultRecord);
+    if (torn != 0) {
+      log_warn("Cutting off a torn record of {} bytes in {}", torn,
+               path);
+      if (ftruncate(file.fd, static_cast<off_t>(size - torn)) < 0) {
+        return std::unexpected(system_error("Failed to truncate", path));
+      }
+      size -= torn;
+    }
+  }
+
+  if (!write_all(file.fd, reinterpret_cast<const char*>(records.data()),
+                 records.size_bytes())) {
+    return std::unexpected(system_error("Failed to write", path));
+  }
+  // the records are saved either way; readers find the ones the index
+  // misses by reading them
+  auto count = (size - sizeof(ResultHeader)) / sizeof(ResultRecord) +
+               records.size();
+  auto indexed = update_index(path, file.fd, count, records);
+  if (!indexed) {
+    log_warn("{}", indexed.error());
+  }
+  return {};
+}
+
+auto append_lines(const std::string& path, std::string_view lines)
+    -> std::expected<void, error_t> {
+  auto dir = std::filesystem::path(path).parent_path();
+  if (!dir.empty() && !std::filesystem::exists(dir)) {
+    std::filesystem::create_directories(dir);
+  }
+
+  LockedFile file(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC);
+  if (file.fd < 0) {
+    return std::unexpected(system_error("Failed to open", path));
+  }
+  if (!file.lock(LOCK_EX)) {
+    return std::unexpected(system_error("Failed to lock", path));
+  }
+  if (!write_all(file.fd, lines.data(), lines.size())) {
+    return std::unexpected(system_error("Failed to write", path));
+  }
+  return {};
+}
+
+auto ResultReader::open(const std::string& path)
+    -> std::expected<ResultReader, error_t> {
+  LockedFile file(path, O_RDONLY | O_CLOEXEC);
+  if (file.fd < 0) {
+    return std::unexpected(system_error("Failed to open", path));
+  }
+  // appends are atomic with respect to a shared lock
+  if (!file.lock(LOCK_SH)) {
+    return std::unexpected(system_error("Failed to lock", path));
+  }
+  struct stat status{};
+  if (fstat(file.fd, &status) < 0) {
+    return std::unexpected(system_error("Failed to stat", path));
+  }
+  auto size = static_cast<size_t>(status.st_size);
+  ResultHeader header{};
+  if (size < sizeof(header) ||
+      !read_all(file.fd, reinterpret_cast<char*>(&header), sizeof(header)) ||
+      !valid_header(header)) {
+    return std::unexpected(std::format("{} is not a results store", path));
+  }
+
+  ResultReader reader;
+  reader.path = path;
+  reader.record_count = (size - sizeof(header)) / sizeof(ResultRecord);
+  auto add = [&](const IndexEntry& entry) {
+    if (entry.first + entry.steps <= reader.record_count) {
+      reader.index.insert_or_assign(
+          {entry.kind, entry.run, std::string(alg_name(entry))},
+          std::pair{static_cast<size_t>(entry.first),
+                    static_cast<size_t>(entry.steps)});
+    }
+  };
+
+  // the index, read under the store's lock as appends update it
+  size_t indexed = 0;
+  LockedFile index(index_path(path), O_RDONLY | O_CLOEXEC);
+  IndexHeader index_head{};
+  if (index.fd >= 0 && fstat(index.fd, &status) == 0 &&
+      static_cast<size_t>(status.st_size) >= sizeof(IndexHeader) &&
+      read_all(index.fd, reinterpret_cast<char*>(&index_head),
+               sizeof(index_head)) &&
+      valid_index_header(index_head) &&
+      index_head.records <= reader.record_count) {
+    std::vector<IndexEntry> entries(
+        (static_cast<size_t>(status.st_size) - sizeof(IndexHeader)) /
+        sizeof(IndexEntry));
+    if (read_all(index.fd, reinterpret_cast<char*>(entries.data()),
+                 entries.size() * sizeof(IndexEntry))) {
+      std::ranges::for_each(entries, add);
+      indexed = index_head.records;
+    }
+  }
+
+  // records appended without the index
+  std::vector<ResultRecord> rest(reader.record_count - indexed);
+  if (!read_records(file.fd, indexed, rest)) {
+    return std::unexpected(system_error("Failed to read", path));
+  }
+  std::ranges::for_each(index_records(rest, indexed), add);
+  return reader;
+}
+
+auto ResultReader::find(RecordKind kind, int run, std::string_view alg) const
+    -> std::vector<ResultRecord> {
+  auto it = index.find({kind, run, std::string(alg)});
+  if (it == index.end()) {
+    return {};
+  }
+  auto [first, count] = it->second;
+  std::vector<ResultRecord> found(count);
+  LockedFile file(path, O_RDONLY | O_CLOEXEC);
+  if (file.fd < 0 || !read_records(file.fd, first, found)) {
+    log_warn("{}", system_error("Failed to read", path));
+    return {};
+  }
+  // an index left by another store points elsewhere
+  for (size_t i = 0; i < found.size(); i++) {
+    if (found[i].kind != kind || found[i].run != run ||
+        alg_name(found[i]) != alg || found[i].step != i) {
+      log_warn("The index of {} is out of date; remove {}", path,
+               index_path(path));
+      return {};
+    }
+  }
+  return found;
+}
+
+auto ResultReader::selection(int run, std::string_view alg) const
+    -> std::optional<AlgoResult> {
+  auto found = find(RecordKind::Selection, run, alg);
+  if (found.empty()) {
+    return std::nullopt;
+  }
+  AlgoResult result{std::string(alg), {}, {}};
+  for (const auto& record : found) {
+    result.seeds.push_back(record.vertex);
+    result.used_samples.push_back(record.used_samples);
+  }
+  return result;
+}
+
+auto ResultReader::selection_cost(int run, std::string_view alg) const
+    -> std::optional<SelectionCost> {
+  auto found = find(RecordKind::Selection, run, alg);
+  if (found.empty()) {
+    return std::nullopt;
+  }
+  const auto& last = found.back();
+  return SelectionCost{last.seconds, last.used_samples, last.peak_rss_kib};
+}
+
+auto ResultReader::evaluation(int run, std::string_view alg) const
+    -> std::optional<std::vector<PrefixEstimate>> {
+  auto found = find(RecordKind::Evaluation, run, alg);
+  if (found.empty()) {
+    return std::nullopt;
+  }
+  std::vector<PrefixEstimate> prefixes;
+  for (const auto& record : found) {
+    prefixes.push_back({record.mean, record.half_width, record.worlds});
+  }
+  return prefixes;
+}
+
+auto ResultReader::runs() const -> std::vector<std::pair<int, std::string>> {
+  std::vector<std::pair<int, std::string>> list;
+  for (const auto& [key, location] : index) {
+    const auto& [kind, run, alg] = key;
+    if (kind == RecordKind::Selection) {
+      list.emplace_back(run, alg);
+    }
+  }
+  return list;
+}
+
+auto ResultReader::write_csv(std::ostream& out) const -> void {
+  out << "run,alg,step,vertex,used_samples,select_seconds,eval_mean,"
+         "eval_half_width,eval_worlds,eval_seconds,select_peak_rss_kib\n";
+  for (const auto& [run, alg] : runs()) {
+    auto selection = find(RecordKind::Selection, run, alg);
+    auto evaluation = find(RecordKind::Evaluation, run, alg);
+    for (size_t i = 0; i < selection.size(); i++) {
+      const auto& record = selection[i];
+      out << std::format("{},{},{},{},{},{}", run, alg, i + 1, record.vertex,
+                         record.used_samples, record.seconds);
+      if (i < evaluation.size()) {
+        const auto& prefix = evaluation[i];
+        out << std::format(",{},{},{},{}", prefix.mean, prefix.half_width,
+                           prefix.worlds, prefix.seconds);
+      } else {
+        out << ",,,,";
+      }
+      if (record.peak_rss_kib > 0) {
+        out << std::format(",{}\n", record.peak_rss_kib);
+      } else {
+        out << ",\n";
+      }
+    }
+  }
+}
+
+}  // namespace im
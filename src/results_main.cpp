@@ -0,0 +1,62 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <argparse/argparse.hpp>
+
+#include "report.hpp"
+#include "results.hpp"
+
+int main(int argc, char** argv) {
+  argparse::ArgumentParser program("bandit-im-results");
+  program.add_argument("dataset").help("Dataset whose results to export");
+  program.add_argument("--store")
+      .help("Results store to read (default: results/<dataset>.imr)");
+  program.add_argument("--output")
+      .help("File to write (default: standard output)");
+  program.add_argument("--report")
+      .help("Summarize the runs per algorithm instead, as json or csv: "
+            "medians of time, samples and peak RSS, influence per prefix "
+            "and the time-quality frontier")
+      .choices("json", "csv");
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::exception& err) {
+    std::cerr << err.what() << '\n';
+    std::cerr << program;
+    return 1;
+  }
+
+  auto path = program.present<std::string>("--store").value_or(
+      im::results_path(program.get<std::string>("dataset")));
+  auto store = ResultReader::open(path);
+  if (!store) {
+    std::cerr << store.error() << '\n';
+    return 1;
+  }
+
+  auto report = program.present<std::string>("--report");
+  auto write = [&](std::ostream& out) {
+    if (!report) {
+      store->write_csv(out);
+    } else if (*report == "json") {
+      im::write_report_json(out, im::summarize_results(*store));
+    } else {
+      im::write_report_csv(out, im::summarize_results(*store));
+    }
+  };
+
+  auto output = program.present<std::string>("--output");
+  if (!output) {
+    write(std::cout);
+    return 0;
+  }
+  std::ofstream f(*output);
+  if (!f.is_open()) {
+    std::cerr << "Failed to open output file " << *output << '\n';
+    return 1;
+  }
+  write(f);
+  return 0;
+}
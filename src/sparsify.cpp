@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <format>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "sparsify.hpp"
+#include "trace.hpp"
+
+namespace im {
+
+auto parse_sparsify_method(std::string_view name)
+    -> std::expected<SparsifyMethod, error_t> {
+  if (name == "probability") {
+    return SparsifyMethod::Probability;
+  }
+  if (name == "contribution") {
+    return SparsifyMethod::Contribution;
+  }
+  return std::unexpected(std::format("Unknown sparsify method '{}'", name));
+}
+
+auto sparsify_graph(const Graph& g,
+                    const SparsifyOptions& options,
+                    ThreadPool* pool) -> SparsifiedGraph {
+  TraceSpan span("sparsify");
+  SparsifiedGraph sparse{Graph(g.n), 0, std::vector<double>(g.n, 1.0)};
+
+  // sigma(v) of every vertex with in-edges
+  std::vector<char> targets(g.n, 0);
+  for (int u = 0; u < g.n; u++) {
+    for (const auto& e : g[u]) {
+      targets[e.to] = 1;
+    }
+  }
+  WorkerLocal<DiffusionSolver> solvers(
+      pool, [&] { return DiffusionSolver(g, options.seed); });
+  auto estimate = [&](size_t worker, size_t v) {
+    if (!targets[v] || options.samples == 0) {
+      return;
+    }
+    auto& solver = solvers[worker];
+    solver.seed(mix64(options.seed + mix64(v)));
+    double total = 0;
+    for (size_t i = 0; i < options.samples; i++) {
+      total += solver.run(options.type, static_cast<int>(v));
+    }
+    sparse.influence[v] = total / static_cast<double>(options.samples);
+  };
+  if (pool == nullptr) {
+    for (size_t v = 0; v < static_cast<size_t>(g.n); v++) {
+      estimate(0, v);
+    }
+  } else {
+    pool->parallel_for(static_cast<size_t>(g.n), estimate);
+  }
+
+  // edges by decreasing score, then in input order
+  struct Scored {
+    int u;
+    int index;  // in u's adjacency list
+    double score;
+  };
+  std::vector<Scored> edges;
+  edges.reserve(static_cast<size_t>(g.m));
+  for (int u = 0; u < g.n; u++) {
+    for (int i = 0; i < std::ssize(g[u]); i++) {
+      const auto& e = g[u][i];
+      auto score = options.method == SparsifyMethod::Probability
+                       ? e.weight
+                       : e.weight * sparse.influence[e.to];
+      edges.push_back({u, i, score});
+    }
+  }
+  std::ranges::stable_sort(edges, std::greater{}, &Scored::score);
+
+  auto kept = std::min(options.edges, edges.size());
+  std::vector<std::vector<char>> keep(g.n);
+  for (int u = 0; u < g.n; u++) {
+    keep[u].assign(g[u].size(), 0);
+  }
+  for (size_t i = 0; i < kept; i++) {
+    keep[edges[i].u][edges[i].index] = 1;
+  }
+  for (int u = 0; u < g.n; u++) {
+    for (size_t i = 0; i < g[u].size(); i++) {
+      const auto& e = g[u][i];
+      if (keep[u][i]) {
+        sparse.graph.add_edge(u, e.to, e.weight);
+      } else {
+        sparse.error_bound += e.weight * sparse.influence[e.to];
+      }
+    }
+  }
+  return sparse;
+}
+
+}  // namespace im
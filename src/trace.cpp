@@ -0,0 +1,159 @@
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "log.hpp"
+#include "trace.hpp"
+
+namespace im {
+
+namespace detail {
+
+std::atomic<bool> tracing_enabled = false;
+
+}  // namespace detail
+
+namespace {
+
+const auto trace_epoch = std::chrono::steady_clock::now();
+
+// events kept per thread; later ones are dropped and counted
+constexpr size_t max_thread_events = size_t{1} << 20;
+
+struct TraceEvent {
+  const char* name;
+  const char* arg_name;
+  std::int64_t arg;
+  std::uint64_t start;
+  std::uint64_t end;
+};
+
+// Spans of one thread. The mutex is only contended by write_trace().
+struct TraceBuffer {
+  long tid = syscall(SYS_gettid);
+  std::mutex mutex;
+  std::vector<TraceEvent> events;
+  size_t dropped = 0;
+};
+
+struct TraceRegistry {
+  std::mutex mutex;
+  std::vector<std::shared_ptr<TraceBuffer>> buffers;  // outlive their threads
+};
+
+auto registry() -> TraceRegistry& {
+  static TraceRegistry instance;
+  return instance;
+}
+
+auto thread_buffer() -> TraceBuffer& {
+  thread_local auto buffer = [] {
+    auto created = std::make_shared<TraceBuffer>();
+    auto& all = registry();
+    std::scoped_lock lock(all.mutex);
+    all.buffers.push_back(created);
+    return created;
+  }();
+  return *buffer;
+}
+
+// microseconds with nanosecond digits
+auto append_micros(std::string& out, std::uint64_t nanos) -> void {
+  out += std::format("{}.{:03}", nanos / 1000, nanos % 1000);
+}
+
+}  // namespace
+
+namespace detail {
+
+auto trace_clock() -> std::uint64_t {
+  auto elapsed = std::chrono::steady_clock::now() - trace_epoch;
+  // never 0, which marks a span opened while tracing was off
+  return static_cast<std::uint64_t>(
+             std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                 .count()) +
+         1;
+}
+
+auto record_span(const char* name,
+                 const char* arg_name,
+                 std::int64_t arg,
+                 std::uint64_t start) -> void {
+  auto end = trace_clock();
+  auto& buffer = thread_buffer();
+  std::scoped_lock lock(buffer.mutex);
+  if (buffer.events.size() == max_thread_events) {
+    buffer.dropped++;
+    return;
+  }
+  buffer.events.push_back({name, arg_name, arg, start, end});
+}
+
+}  // namespace detail
+
+auto start_tracing() -> void {
+  detail::tracing_enabled.store(true, std::memory_order_relaxed);
+}
+
+auto tracing() -> bool {
+  return detail::tracing_enabled.load(std::memory_order_relaxed);
+}
+
+auto write_trace(const std::string& path) -> std::expected<void, error_t> {
+  std::vector<std::shared_ptr<TraceBuffer>> buffers;
+  {
+    auto& all = registry();
+    std::scoped_lock lock(all.mutex);
+    buffers = all.buffers;
+  }
+
+  auto pid = getpid();
+  std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  auto first = true;
+  size_t dropped = 0;
+  for (const auto& buffer : buffers) {
+    std::scoped_lock lock(buffer->mutex);
+    dropped += buffer->dropped;
+    for (const auto& event : buffer->events) {
+      out += std::format(
+          "{}\n{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":{},\"tid\":{},\"ts\":",
+          first ? "" : ",", event.name, pid, buffer->tid);
+      append_micros(out, event.start);
+      out += ",\"dur\":";
+      append_micros(out, event.end - event.start);
+      if (event.arg_name != nullptr) {
+        out += std::format(",\"args\":{{\"{}\":{}}}", event.arg_name,
+                           event.arg);
+      }
+      out += '}';
+      first = false;
+    }
+  }
+  out += "\n]}\n";
+  if (dropped > 0) {
+    log_warn("Trace dropped {} spans beyond {} per thread", dropped,
+             max_thread_events);
+  }
+
+  std::ofstream file(path, std::ios::binary);
+  if (!file || !file.write(out.data(), static_cast<std::streamsize>(
+                                           out.size()))) {
+    return std::unexpected(
+        std::format("Failed to write {}: {}", path, std::strerror(errno)));
+  }
+  return {};
+}
+
+}  // namespace im
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <filesystem>
+#include <format>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "evaluate.hpp"
+#include "results.hpp"
+
+// Helpers shared by the tests of the results store
+
+// A fresh path for a store in the temporary directory, without its index
+inline auto temporary_store(std::string_view name) -> std::string {
+  auto path = std::filesystem::temp_directory_path() /
+              std::format("bandit-im-test-{}.imr", name);
+  std::filesystem::remove(path);
+  std::filesystem::remove(im::index_path(path.string()));
+  return path.string();
+}
+
+inline auto stats_of(std::vector<double> samples) -> RunningStats {
+  RunningStats stats;
+  for (auto sample : samples) {
+    stats.add(sample);
+  }
+  return stats;
+}
@@ -0,0 +1,89 @@
+#include <random>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include "bai.hpp"
+#include "rng.hpp"
+#include "ucb.hpp"
+using std::normal_distribution;
+
+namespace {
+
+struct NormalArms {
+  mutable RNG rng;
+  std::vector<double> means;
+  double sigma;
+  NormalArms(std::vector<double> means, double sigma, seed_type seed)
+      : rng(seed), means(means), sigma(sigma) {}
+  double operator()(int i) const {
+    return normal_distribution<double>(means[i], sigma)(rng);
+  }
+};
+
+auto make_trackers(int n, double sigma) {
+  std::vector<LILConfidenceBoundTracker> trackers;
+  trackers.reserve(n);
+  for (int i = 0; i < n; i++) {
+    trackers.emplace_back(0.01, 0.001, 2 * sigma, 1.0, -10.0, 10.0);
+  }
+  return trackers;
+}
+
+}  // namespace
+
+TEST_CASE("LUCB with Gaussian rewards", "[bai]") {
+  auto n = GENERATE(3, 6, 12);
+  std::vector<double> means(n);
+  for (int i = 0; i < n; i++) {
+    means[i] = i * 1.0 / n;
+  }
+  auto reward = NormalArms(means, 1.0, 1234567890 + n);
+  auto lucb = LUCB(n, 0.03 / n, reward, make_trackers(n, 1.0));
+  auto best_arm = lucb.best_arm();
+  CAPTURE(n, lucb.n_pulls());
+  REQUIRE(best_arm == n - 1);
+
+  lucb.disable_arm(n - 1);
+  lucb.reset();
+  REQUIRE(lucb.best_arm() == n - 2);
+}
+
+TEST_CASE("Successive elimination with Gaussian rewards", "[bai]") {
+  auto n = GENERATE(3, 6, 12);
+  std::vector<double> means(n);
+  for (int i = 0; i < n; i++) {
+    means[i] = i * 1.0 / n;
+  }
+  auto reward = NormalArms(means, 1.0, 1234567890 + n);
+  auto se = SuccessiveElimination(n, 0.03 / n, reward, make_trackers(n, 1.0));
+  auto best_arm = se.best_arm();
+  CAPTURE(n, se.n_pulls());
+  REQUIRE(best_arm == n - 1);
+  REQUIRE(se.active.size() < static_cast<size_t>(n));
+}
+
+TEST_CASE("Top-m identification with Gaussian rewards", "[bai]") {
+  auto n = GENERATE(6, 12);
+  auto m = GENERATE(2, 3);
+  std::vector<double> means(n);
+  for (int i = 0; i < n; i++) {
+    means[i] = i * 1.0 / n;
+  }
+  std::vector<int> expected;
+  for (int i = n - 1; i >= n - m; i--) {
+    expected.push_back(i);
+  }
+  auto reward = NormalArms(means, 1.0, 987654321 + n);
+
+  SECTION("LUCB") {
+    auto lucb = LUCB(n, 0.03 / n, reward, make_trackers(n, 1.0));
+    CAPTURE(n, m);
+    REQUIRE(lucb.top_arms(m) == expected);
+  }
+
+  SECTION("Successive elimination") {
+    auto se = SuccessiveElimination(n, 0.03 / n, reward, make_trackers(n, 1.0));
+    CAPTURE(n, m);
+    REQUIRE(se.top_arms(m) == expected);
+  }
+}
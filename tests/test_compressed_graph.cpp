@@ -0,0 +1,90 @@
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "compressed_graph.hpp"
+#include "diffusion.hpp"
+#include "generate.hpp"
+#include "graph.hpp"
+#include "utility.hpp"
+
+using Catch::Matchers::WithinAbs;
+
+namespace {
+
+auto generated(WeightModel weights) -> Graph {
+  GeneratorOptions options;
+  options.model = GraphModel::PowerLaw;
+  options.n = 5000;
+  options.m = 50'000;
+  WeightOptions weight_options;
+  weight_options.model = weights;
+  return im::generate_graph(options, weight_options);
+}
+
+}  // namespace
+
+TEST_CASE("Compressed graphs decode to the same edges", "[compressed]") {
+  Graph g(5);
+  g.add_edge(3, 0, 0.5);  // a gap back from the source
+  g.add_edge(3, 4, 0.25);
+  g.add_edge(3, 4, 0.125);  // parallel edges keep their order
+  g.add_edge(0, 1, 0.5);
+  g.add_edge(4, 1, 1.0);
+
+  auto c = im::compress_graph(g);
+  REQUIRE(c.n == 5);
+  REQUIRE(c.m == 5);
+  REQUIRE(c.target_codes.empty());  // two probabilities into vertex 4
+  REQUIRE(c[3].size() == 3);
+  REQUIRE(c[2].size() == 0);
+  std::vector<Edge> edges;
+  for (const auto& e : c[3]) {
+    edges.push_back(e);
+  }
+  REQUIRE(edges == std::vector<Edge>{{0, 0.5}, {4, 0.25}, {4, 0.125}});
+  REQUIRE(c.decompress().get_edges() == g.get_edges());
+
+  for (auto weights : {WeightModel::WeightedCascade, WeightModel::Trivalency}) {
+    auto big = generated(weights);
+    auto compressed = im::compress_graph(big);
+    REQUIRE(compressed.decompress().get_edges() == big.get_edges());
+    REQUIRE(compressed.target_codes.empty() ==
+            (weights == WeightModel::Trivalency));
+  }
+}
+
+TEST_CASE("Compressed graphs are smaller", "[compressed]") {
+  auto g = generated(WeightModel::WeightedCascade);
+  auto c = im::compress_graph(g);
+  REQUIRE(c.memory_bytes() * 3 < im::graph_memory_bytes(g));
+}
+
+TEST_CASE("Diffusion on a compressed graph", "[compressed]") {
+  auto g = generated(WeightModel::WeightedCascade);
+  auto c = im::compress_graph(g);
+  // the decompressed graph has the edges in the same order, so the same
+  // seed gives the same cascades
+  auto sorted = c.decompress();
+  BasicDiffusionSolver compressed(c, 5);
+  DiffusionSolver plain(sorted, 5);
+  for (int origin = 0; origin < 200; origin++) {
+    for (auto type : {DiffusionType::IndependentCascade,
+                      DiffusionType::LinearThreshold}) {
+      REQUIRE(compressed.run(type, origin) == plain.run(type, origin));
+    }
+  }
+  REQUIRE(compressed.probes == plain.probes);
+
+  Graph path(6);
+  for (int u = 0; u < 5; u++) {
+    path.add_edge(u, u + 1, 0.5);
+  }
+  auto compressed_path = im::compress_graph(path);
+  BasicDiffusionSolver solver(compressed_path, 0);
+  auto average = repeat_avg(10000, [&] {
+    return solver.run_independent_cascade({4});
+  });
+  REQUIRE_THAT(average, WithinAbs(1.50, 0.03));
+}
@@ -0,0 +1,125 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "counters.hpp"
+#include "diffusion.hpp"
+#include "graph.hpp"
+#include "greedy.hpp"
+#include "thread_pool.hpp"
+
+// The counts are only checked when compiled in; otherwise nothing may be
+// counted at all.
+
+TEST_CASE("Histogram buckets", "[counters]") {
+  REQUIRE(im::histogram_bucket(0) == 0);
+  REQUIRE(im::histogram_bucket(1) == 1);
+  REQUIRE(im::histogram_bucket(3) == 2);
+  REQUIRE(im::histogram_bucket(4) == 3);
+  REQUIRE(im::histogram_bucket(UINT64_MAX) == im::histogram_buckets - 1);
+}
+
+TEST_CASE("Counters follow runs into the pool", "[counters]") {
+  ThreadPool pool(4);
+  RunCounters counters(false);
+  {
+    CounterScope counting(counters);
+    pool.parallel_for(100, [](size_t, size_t i) {
+      im::count(Counter::EdgesProbed, i);
+    });
+    im::count_step();
+    im::count(Counter::EdgesProbed);
+  }
+  im::count(Counter::EdgesProbed);  // outside of any run
+  im::count_step();
+
+  if constexpr (im::counters_enabled) {
+    REQUIRE(counters.steps.size() == 1);
+    REQUIRE(counters.steps[0][Counter::EdgesProbed] == 4950);
+    REQUIRE(counters.total()[Counter::EdgesProbed] == 4951);
+  } else {
+    REQUIRE(counters.steps.empty());
+    REQUIRE(counters.total()[Counter::EdgesProbed] == 0);
+  }
+}
+
+TEST_CASE("A thread switching between runs keeps its blocks",
+          "[counters]") {
+  RunCounters first(false);
+  RunCounters second(false);
+  auto& block = first.block();
+  REQUIRE(&second.block() != &block);
+  REQUIRE(&first.block() == &block);
+  for (int i = 0; i < 3; i++) {
+    CounterScope counting(i % 2 == 0 ? first : second);
+    im::count(Counter::EdgesProbed);
+  }
+
+  if constexpr (im::counters_enabled) {
+    REQUIRE(first.total()[Counter::EdgesProbed] == 2);
+    REQUIRE(second.total()[Counter::EdgesProbed] == 1);
+  }
+}
+
+TEST_CASE("Solver counts", "[counters]") {
+  // the path 0 -> 1 -> 2 -> 3
+  Graph g(4);
+  g.add_edge(0, 1, 1.0);
+  g.add_edge(1, 2, 1.0);
+  g.add_edge(2, 3, 1.0);
+
+  RunCounters counters(false);
+  DiffusionSolver solver(g, 1);
+  {
+    CounterScope counting(counters);
+    REQUIRE(solver.run_independent_cascade({0}) == 4);
+    REQUIRE(solver.run_independent_cascade({2}) == 2);
+  }
+
+  auto total = counters.total();
+  if constexpr (im::counters_enabled) {
+    REQUIRE(total[Counter::Cascades] == 2);
+    REQUIRE(total[Counter::EdgesProbed] == solver.probes);
+    REQUIRE(total[Counter::RngDraws] == 4);
+    auto sizes = total.histograms[static_cast<size_t>(Histogram::CascadeSize)];
+    REQUIRE(sizes[im::histogram_bucket(2)] == 1);
+    REQUIRE(sizes[im::histogram_bucket(4)] == 1);
+  } else {
+    REQUIRE(total[Counter::Cascades] == 0);
+  }
+}
+
+TEST_CASE("CELF counts per greedy step", "[counters]") {
+  // a star around 0 and a pair 5 -> 6
+  Graph g(7);
+  for (int v = 1; v <= 4; v++) {
+    g.add_edge(0, v, 1.0);
+  }
+  g.add_edge(5, 6, 1.0);
+
+  RunCounters counters(false);
+  DiffusionSubmodular f(g, DiffusionType::IndependentCascade, 1);
+  std::vector<int> seeds;
+  {
+    CounterScope counting(counters);
+    seeds = greedy_lazy_forward(f, g.n, 2);
+  }
+  REQUIRE(seeds == std::vector<int>{0, 5});
+
+  if constexpr (im::counters_enabled) {
+    REQUIRE(counters.steps.size() == 2);
+    // the first step evaluates every vertex, later ones only re-evaluate
+    REQUIRE(counters.steps[0][Counter::LazyEvaluations] == 7);
+    REQUIRE(counters.steps[1][Counter::LazyEvaluations] < 7);
+    REQUIRE(counters.steps[0][Counter::Cascades] == 7);
+
+    auto json = counters.to_json(3, "celf");
+    REQUIRE(json.starts_with("{\"run\":3,\"alg\":\"celf\",\"steps\":[{"));
+    REQUIRE(json.ends_with("]}\n"));
+    REQUIRE(json.find("\"lazy_evaluations\":7,") != std::string::npos);
+  } else {
+    REQUIRE(counters.steps.empty());
+  }
+}
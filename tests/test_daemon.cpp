@@ -0,0 +1,188 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "daemon.hpp"
+#include "graph.hpp"
+
+namespace {
+
+// the path 0 -> 1 -> 2 -> 3 and the edge 4 -> 5, all edges live
+auto path_graph() -> Graph {
+  Graph g(6);
+  g.add_edge(0, 1, 1.0);
+  g.add_edge(1, 2, 1.0);
+  g.add_edge(2, 3, 1.0);
+  g.add_edge(4, 5, 1.0);
+  return g;
+}
+
+auto contains(const std::string& text, const std::string& part) -> bool {
+  return text.find(part) != std::string::npos;
+}
+
+// A client of the daemon at path, once it listens
+auto connect_to(const std::string& path) -> int {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  std::ranges::copy(path, address.sun_path);
+  for (int attempt = 0; attempt < 500; attempt++) {
+    auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)) == 0) {
+      return fd;
+    }
+    close(fd);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return -1;
+}
+
+}  // namespace
+
+TEST_CASE("Requests are parsed", "[daemon]") {
+  auto request = im::parse_request("  influence graph=karate\tseeds=0,33 \n");
+  REQUIRE(request);
+  REQUIRE(request->command == "influence");
+  REQUIRE(request->args.size() == 2);
+  REQUIRE(request->args.at("graph") == "karate");
+  REQUIRE(request->args.at("seeds") == "0,33");
+
+  auto empty_value = im::parse_request("gains fixed=");
+  REQUIRE(empty_value);
+  REQUIRE(empty_value->args.at("fixed").empty());
+
+  REQUIRE_FALSE(im::parse_request(""));
+  REQUIRE_FALSE(im::parse_request("   "));
+  REQUIRE_FALSE(im::parse_request("influence graph"));
+  REQUIRE_FALSE(im::parse_request("influence =karate"));
+}
+
+TEST_CASE("Queries on a warm graph", "[daemon]") {
+  QueryServer server;
+  server.add_graph("path", path_graph());
+
+  SECTION("Graphs") {
+    REQUIRE(server.handle("graphs") ==
+            R"({"ok":true,"graphs":[{"name":"path","n":6,"m":4}]})");
+  }
+
+  SECTION("Influence of every prefix") {
+    auto response = server.handle("influence graph=path seeds=1,4,0");
+    REQUIRE(contains(response, R"("ok":true)"));
+    REQUIRE(contains(response, R"("influence":6,)"));
+    REQUIRE(contains(response, R"("half_width":0,)"));
+    REQUIRE(contains(response, R"("prefix_influence":[3,5,6])"));
+  }
+
+  SECTION("Marginal gains with respect to fixed seeds") {
+    auto response = server.handle("gains graph=path fixed=1 arms=0,3,4 model=lt");
+    REQUIRE(contains(response, R"("arms":[0,3,4])"));
+    REQUIRE(contains(response, R"("gains":[1,0,2])"));
+    REQUIRE(contains(response, R"("worlds":100)"));
+
+    response = server.handle("gains graph=path fixed=0,4");
+    REQUIRE(contains(response, R"("arms":[1,2,3,5])"));
+    REQUIRE(contains(response, R"("gains":[0,0,0,0])"));
+  }
+
+  SECTION("Selection") {
+    auto response = server.handle("select graph=path k=2 alg=celf");
+    REQUIRE(contains(response, R"("ok":true)"));
+    REQUIRE(contains(response, R"("alg":"celf")"));
+    REQUIRE(contains(response, R"("seeds":[0,4])"));
+  }
+
+  SECTION("Errors") {
+    REQUIRE(contains(server.handle("frobnicate"),
+                     R"({"ok":false,"error":"Unknown command 'frobnicate'"})"));
+    REQUIRE(contains(server.handle("influence graph=road seeds=0"),
+                     "Unknown graph 'road'"));
+    REQUIRE(contains(server.handle("influence graph=path seeds=0,6"),
+                     "out of range"));
+    REQUIRE(contains(server.handle("influence graph=path seeds=0,x"),
+                     "Invalid seeds"));
+    REQUIRE(contains(server.handle("influence graph=path seeds=0 model=sis"),
+                     "Unknown model"));
+    REQUIRE(contains(server.handle("select graph=path k=7"), "k must be"));
+    REQUIRE(contains(server.handle("gains graph=path max_worlds=0"),
+                     "max_worlds must be positive"));
+    REQUIRE(contains(server.handle("select graph=path k=1 alg=magic"),
+                     R"("ok":false)"));
+    REQUIRE_FALSE(server.stopping);
+  }
+
+  SECTION("Shutdown") {
+    REQUIRE(server.handle("shutdown") == R"({"ok":true})");
+    REQUIRE(server.stopping);
+  }
+}
+
+TEST_CASE("Frames round-trip over a socket", "[daemon]") {
+  int fds[2];
+  REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+  REQUIRE(im::write_frame(fds[0], "graphs"));
+  REQUIRE(im::write_frame(fds[0], ""));
+  REQUIRE(im::write_frame(fds[0], std::string(50000, 'x')));
+  REQUIRE(im::read_frame(fds[1]).value() == "graphs");
+  REQUIRE(im::read_frame(fds[1]).value().empty());
+  REQUIRE(im::read_frame(fds[1]).value() == std::string(50000, 'x'));
+
+  // an oversized length is refused before reading the payload
+  const unsigned char header[4] = {0xff, 0xff, 0xff, 0x7f};
+  REQUIRE(write(fds[0], header, 4) == 4);
+  REQUIRE_FALSE(im::read_frame(fds[1]));
+
+  close(fds[0]);
+  REQUIRE_FALSE(im::read_frame(fds[1]));
+  close(fds[1]);
+}
+
+TEST_CASE("The daemon serves clients that stay connected", "[daemon]") {
+  auto path = (std::filesystem::temp_directory_path() /
+               std::format("bandit-im-test-{}.sock", getpid()))
+                  .string();
+  std::filesystem::remove(path);
+  QueryServer server;
+  server.add_graph("path", path_graph());
+
+  // a file that is not a socket is left alone
+  std::ofstream(path) << "data";
+  REQUIRE_FALSE(im::serve(server, path));
+  REQUIRE(std::filesystem::is_regular_file(path));
+  std::filesystem::remove(path);
+
+  std::expected<void, im::error_t> served;
+  std::jthread daemon([&] { served = im::serve(server, path); });
+  auto idle = connect_to(path);
+  auto active = connect_to(path);
+  REQUIRE(idle >= 0);
+  REQUIRE(active >= 0);
+  // the first client stays connected without asking anything
+  REQUIRE(im::write_frame(active, "graphs"));
+  REQUIRE(contains(im::read_frame(active).value(), R"("name":"path")"));
+
+  // nor is the socket of a running daemon
+  QueryServer other;
+  REQUIRE_FALSE(im::serve(other, path));
+
+  REQUIRE(im::write_frame(idle, "shutdown"));
+  REQUIRE(im::read_frame(idle).value() == R"({"ok":true})");
+  daemon.join();
+  REQUIRE(served);
+  REQUIRE_FALSE(std::filesystem::exists(path));
+  close(idle);
+  close(active);
+}
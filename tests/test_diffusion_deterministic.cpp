@@ -54,3 +54,19 @@ TEST_CASE("Deterministic diffusion on a 2 path graph", "[diffusion_deterministic
     REQUIRE(ds.run_linear_threshold({0, 4, 1}) == 6);
   }
 }
+
+TEST_CASE("Diffusion counts probed edges", "[diffusion_deterministic]") {
+  Graph g(5);
+  g.add_edge(0, 1, 1);
+  g.add_edge(0, 2, 0);
+  g.add_edge(1, 3, 1);
+  g.add_edge(3, 1, 1);
+
+  DiffusionSolver ds(g, 0);
+  REQUIRE(ds.run_independent_cascade({0}) == 3);
+  REQUIRE(ds.probes == 4);
+  REQUIRE(ds.run_linear_threshold({4}) == 1);
+  REQUIRE(ds.probes == 4);
+  REQUIRE(ds.run_independent_cascade({3}, {1}) == 0);
+  REQUIRE(ds.probes == 6);
+}
@@ -0,0 +1,60 @@
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "driver.hpp"
+#include "graph.hpp"
+#include "thread_pool.hpp"
+
+TEST_CASE("Run ranges", "[driver]") {
+  auto single = im::parse_run_range("7");
+  REQUIRE(single);
+  REQUIRE(single->first == 7);
+  REQUIRE(single->last == 7);
+  REQUIRE(single->size() == 1);
+
+  auto range = im::parse_run_range("1..1024");
+  REQUIRE(range);
+  REQUIRE(range->first == 1);
+  REQUIRE(range->last == 1024);
+  REQUIRE(range->size() == 1024);
+
+  REQUIRE_FALSE(im::parse_run_range(""));
+  REQUIRE_FALSE(im::parse_run_range("x"));
+  REQUIRE_FALSE(im::parse_run_range("1.."));
+  REQUIRE_FALSE(im::parse_run_range("3..1"));
+  REQUIRE_FALSE(im::parse_run_range("1..2..3"));
+}
+
+TEST_CASE("Result algorithms follow the options", "[driver]") {
+  RunOptions options;
+  REQUIRE(im::result_algorithms(options) ==
+          std::vector<std::string>{"greedy-cb", "celf-cb", "celf", "greedy"});
+  options.bai = "lucb";
+  options.batch = 2;
+  REQUIRE(im::result_algorithms(options) ==
+          std::vector<std::string>{"greedy-cb-lucb", "celf-cb-lucb", "celf",
+                                   "greedy", "greedy-cb-batch"});
+}
+
+TEST_CASE("CELF and greedy runs do not depend on the pool", "[driver]") {
+  Graph g(6);
+  g.add_edge(0, 1, 0.5);
+  g.add_edge(1, 2, 0.5);
+  g.add_edge(3, 5, 0.5);
+  g.add_edge(4, 5, 0.5);
+  RunOptions options;
+  options.eps = 0.2;
+  options.n_top = 2;
+  ThreadPool pool(3);
+  for (auto alg : {"celf", "greedy"}) {
+    auto serial = im::run_algorithm(g, options, alg, 5, nullptr);
+    auto parallel = im::run_algorithm(g, options, alg, 5, &pool);
+    REQUIRE(serial);
+    REQUIRE(parallel);
+    CAPTURE(alg);
+    REQUIRE(parallel->seeds == serial->seeds);
+    REQUIRE(parallel->used_samples == serial->used_samples);
+  }
+}
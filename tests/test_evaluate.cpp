@@ -0,0 +1,151 @@
+#include <cmath>
+#include <span>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+using Catch::Matchers::WithinAbs;
+
+#include "diffusion.hpp"
+#include "evaluate.hpp"
+#include "graph.hpp"
+#include "thread_pool.hpp"
+
+TEST_CASE("RunningStats", "[evaluate]") {
+  RunningStats stats;
+  REQUIRE(stats.variance() == 0);
+  for (double x : {2.0, 4.0, 4.0, 4.0, 5.0, 5.0, 7.0, 9.0}) {
+    stats.add(x);
+  }
+  REQUIRE(stats.count == 8);
+  REQUIRE_THAT(stats.mean, WithinAbs(5.0, 1e-12));
+  REQUIRE_THAT(stats.variance(), WithinAbs(32.0 / 7, 1e-12));
+  REQUIRE_THAT(stats.half_width(1.0), WithinAbs(std::sqrt(4.0 / 7), 1e-12));
+
+  RunningStats left, right;
+  for (double x : {2.0, 4.0, 4.0}) {
+    left.add(x);
+  }
+  for (double x : {4.0, 5.0, 5.0, 7.0, 9.0}) {
+    right.add(x);
+  }
+  left.merge(right);
+  left.merge(RunningStats{});
+  REQUIRE(left.count == 8);
+  REQUIRE_THAT(left.mean, WithinAbs(5.0, 1e-12));
+  REQUIRE_THAT(left.variance(), WithinAbs(32.0 / 7, 1e-12));
+}
+
+TEST_CASE("Confidence targets", "[evaluate]") {
+  RunningStats stats;
+  for (double x : {9.0, 11.0, 9.0, 11.0}) {
+    stats.add(x);
+  }
+  // half-width 1.96 * sqrt(4 / 3 / 4) = 1.13, mean 10
+  REQUIRE(ConfidenceTarget{1.2, ConfidenceMode::Absolute}.met(stats));
+  REQUIRE_FALSE(ConfidenceTarget{1.0, ConfidenceMode::Absolute}.met(stats));
+  REQUIRE(ConfidenceTarget{0.12, ConfidenceMode::Relative}.met(stats));
+  REQUIRE_FALSE(ConfidenceTarget{0.1, ConfidenceMode::Relative}.met(stats));
+  REQUIRE(ConfidenceTarget{0.12, ConfidenceMode::Either}.met(stats));
+  REQUIRE_FALSE(ConfidenceTarget{0.12, ConfidenceMode::Both}.met(stats));
+  REQUIRE(ConfidenceTarget{1.2, ConfidenceMode::Both}.met(stats));
+}
+
+TEST_CASE("Prefix evaluation on a deterministic graph", "[evaluate]") {
+  Graph g(6);
+  g.add_edge(0, 1, 1.0);
+  g.add_edge(1, 2, 1.0);
+  g.add_edge(3, 4, 1.0);
+
+  for (auto type :
+       {DiffusionType::IndependentCascade, DiffusionType::LinearThreshold}) {
+    PrefixEvaluator evaluator(g, type, 1);
+    auto stats = evaluator.evaluate({{1, 0, 3, 5}, {4, 3, 2}}, {0.01});
+    REQUIRE(stats.size() == 2);
+    std::vector<std::vector<double>> means;
+    for (const auto& list_stats : stats) {
+      auto& list_means = means.emplace_back();
+      for (const auto& prefix : list_stats) {
+        REQUIRE(prefix.count == 100);
+        list_means.push_back(prefix.mean);
+      }
+    }
+    REQUIRE(means == std::vector<std::vector<double>>{{2, 3, 5, 6}, {1, 2, 3}});
+  }
+}
+
+TEST_CASE("Prefix evaluation matches simulated cascades", "[evaluate]") {
+  Graph g(6);
+  g.add_edge(0, 1, 0.5);
+  g.add_edge(1, 2, 0.5);
+  g.add_edge(2, 0, 0.4);
+  g.add_edge(2, 3, 0.3);
+  g.add_edge(3, 4, 0.7);
+  g.add_edge(5, 3, 0.6);
+  g.add_edge(4, 5, 0.2);
+  std::vector<std::vector<int>> lists{{0, 5, 4}, {3, 1}};
+  const int repeats = 100000;
+
+  for (auto type :
+       {DiffusionType::IndependentCascade, DiffusionType::LinearThreshold}) {
+    PrefixEvaluator evaluator(g, type, 2);
+    auto stats = evaluator.evaluate(lists, {0.01, ConfidenceMode::Absolute});
+    DiffusionSolver solver(g, 3);
+    for (size_t l = 0; l < lists.size(); l++) {
+      for (size_t i = 0; i < lists[l].size(); i++) {
+        auto prefix = std::span<const int>(lists[l]).first(i + 1);
+        auto expected = 0.0;
+        for (int r = 0; r < repeats; r++) {
+          expected += solver.run(type, prefix) / repeats;
+        }
+        CAPTURE(type, l, i);
+        REQUIRE_THAT(stats[l][i].mean, WithinAbs(expected, 0.03));
+      }
+    }
+  }
+}
+
+TEST_CASE("Prefix evaluation reuses the same worlds", "[evaluate]") {
+  Graph g(4);
+  g.add_edge(0, 1, 0.5);
+  g.add_edge(1, 2, 0.5);
+  g.add_edge(2, 3, 0.5);
+  PrefixEvaluator evaluator(g, DiffusionType::IndependentCascade, 5);
+
+  std::vector<double> first(2), second(2), other(1);
+  std::vector<int> seeds{0, 2};
+  for (size_t world = 0; world < 100; world++) {
+    evaluator.sample(world, seeds, first);
+    evaluator.sample(world, std::vector<int>{1}, other);
+    evaluator.sample(world, seeds, second);
+    REQUIRE(first == second);
+    REQUIRE(first[0] <= first[1]);
+  }
+}
+
+TEST_CASE("Prefix evaluation does not depend on the number of workers",
+          "[evaluate]") {
+  Graph g(5);
+  g.add_edge(0, 1, 0.4);
+  g.add_edge(1, 2, 0.6);
+  g.add_edge(2, 3, 0.5);
+  g.add_edge(3, 4, 0.3);
+  g.add_edge(4, 0, 0.7);
+  std::vector<std::vector<int>> lists{{0, 2}, {4, 1, 3}};
+
+  auto evaluate = [&](size_t threads) {
+    ThreadPool pool(threads);
+    PrefixEvaluator evaluator(g, DiffusionType::LinearThreshold, 9, &pool);
+    return evaluator.evaluate(lists, {0.02});
+  };
+  auto serial = evaluate(1);
+  auto parallel = evaluate(4);
+  for (size_t l = 0; l < lists.size(); l++) {
+    for (size_t i = 0; i < lists[l].size(); i++) {
+      REQUIRE(serial[l][i].count == parallel[l][i].count);
+      REQUIRE(serial[l][i].mean == parallel[l][i].mean);
+      REQUIRE(serial[l][i].m2 == parallel[l][i].m2);
+    }
+  }
+}
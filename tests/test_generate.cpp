@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "generate.hpp"
+#include "graph.hpp"
+
+TEST_CASE("Generated graphs", "[generate]") {
+  auto model = GENERATE(GraphModel::ErdosRenyi, GraphModel::BarabasiAlbert,
+                        GraphModel::RMat, GraphModel::PowerLaw);
+  GeneratorOptions options;
+  options.model = model;
+  options.n = 1000;
+  options.m = 8000;
+  options.seed = 7;
+  auto g = im::generate_graph(options, {});
+
+  REQUIRE(g.n == 1000);
+  if (model == GraphModel::BarabasiAlbert) {
+    REQUIRE(std::abs(g.m - 8000) <= 80);
+  } else {
+    REQUIRE(g.m == 8000);
+  }
+  // weighted cascade: the in-edges of a vertex sum to 1
+  std::vector<double> in_weight(g.n, 0.0);
+  for (int u = 0; u < g.n; u++) {
+    for (const auto& e : g[u]) {
+      REQUIRE(e.to != u);
+      REQUIRE(e.to < g.n);
+      in_weight[e.to] += e.weight;
+    }
+  }
+  for (auto w : in_weight) {
+    REQUIRE((w == 0 || std::abs(w - 1) < 1e-9));
+  }
+
+  // the same options give the same graph
+  REQUIRE(im::generate_graph(options, {}).get_edges() == g.get_edges());
+  options.seed = 8;
+  REQUIRE(im::generate_graph(options, {}).get_edges() != g.get_edges());
+}
+
+TEST_CASE("Skewed models have hubs", "[generate]") {
+  auto model = GENERATE(GraphModel::BarabasiAlbert, GraphModel::RMat,
+                        GraphModel::PowerLaw);
+  GeneratorOptions options;
+  options.model = model;
+  options.n = 4096;
+  options.m = 40000;
+  auto g = im::generate_graph(options, {});
+
+  std::vector<int> degree(g.n, 0);
+  for (int u = 0; u < g.n; u++) {
+    degree[u] += static_cast<int>(g[u].size());
+  }
+  // far above the mean degree of about 10
+  REQUIRE(std::ranges::max(degree) > 100);
+}
+
+TEST_CASE("Weight models", "[generate]") {
+  GeneratorOptions options;
+  options.n = 100;
+  options.m = 1000;
+
+  WeightOptions weights;
+  weights.model = WeightModel::Uniform;
+  weights.probability = 0.3;
+  auto uniform = im::generate_graph(options, weights).get_edges();
+  for (const auto& [u, v, w] : uniform) {
+    REQUIRE(w == 0.3);
+  }
+
+  weights.model = WeightModel::Trivalency;
+  std::vector<double> seen;
+  auto trivalency = im::generate_graph(options, weights).get_edges();
+  for (const auto& [u, v, w] : trivalency) {
+    REQUIRE((w == 0.1 || w == 0.01 || w == 0.001));
+    seen.push_back(w);
+  }
+  std::ranges::sort(seen);
+  REQUIRE(std::ranges::unique(seen).begin() - seen.begin() == 3);
+}
+
+TEST_CASE("Streamed graphs parse back", "[generate]") {
+  GeneratorOptions options;
+  options.model = GENERATE(GraphModel::ErdosRenyi, GraphModel::BarabasiAlbert);
+  options.n = 200;
+  options.m = 1500;
+  std::stringstream text;
+  im::write_generated_graph(text, options, {});
+
+  auto parsed = load_graph(text);
+  auto g = im::generate_graph(options, {});
+  REQUIRE(parsed.n == g.n);
+  REQUIRE(parsed.m == g.m);
+  REQUIRE(parsed.get_edges() == g.get_edges());
+  REQUIRE(im::parse_graph_model("rmat") == GraphModel::RMat);
+  REQUIRE_FALSE(im::parse_weight_model("random"));
+}
@@ -1,3 +1,8 @@
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
 #include <set>
 #include <sstream>
 #include <tuple>
@@ -98,4 +103,43 @@ TEST_CASE("Graph vertex deletion", "[graph]") {
       }
     }
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Graph files in text and binary", "[graph]") {
+  Graph g(4);
+  g.add_edge(0, 1, 0.5);
+  g.add_edge(0, 3, 0.1);
+  g.add_edge(2, 0, 1.0 / 3);
+
+  std::ostringstream text;
+  im::write_graph(text, g);
+  REQUIRE(im::load_graph(text.str()).get_edges() == g.get_edges());
+
+  auto path = std::filesystem::temp_directory_path() / "im_test_graph.bin";
+  {
+    std::ofstream f(path, std::ios::binary);
+    im::write_binary_graph(f, g);
+  }
+  auto loaded = im::load_graph_expected(path.string());
+  REQUIRE(loaded);
+  REQUIRE(loaded->n == 4);
+  REQUIRE(loaded->m == 3);
+  REQUIRE(loaded->adj == g.adj);
+
+  // cut in the middle of the probabilities
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 4);
+  REQUIRE_FALSE(im::load_graph_expected(path.string()));
+
+  // a header claiming far more edges than the file holds is rejected before
+  // anything is allocated for them
+  {
+    std::fstream f(path, std::ios::binary | std::ios::in | std::ios::out);
+    std::uint64_t m = std::numeric_limits<std::int32_t>::max();
+    f.seekp(offsetof(im::BinaryGraphHeader, m));
+    f.write(reinterpret_cast<const char *>(&m), sizeof(m));
+  }
+  auto corrupt = im::load_graph_expected(path.string());
+  REQUIRE_FALSE(corrupt);
+  REQUIRE(corrupt.error().starts_with("Truncated binary graph"));
+  std::filesystem::remove(path);
+}
@@ -86,3 +86,25 @@ TEST_CASE("CELF on a simple graph", "[greedy]") {
     REQUIRE_THAT(celf_result, UnorderedRangeEquals({0, 3, 4}));
   }
 }
+
+TEST_CASE("Diffusion set function does not depend on the pool", "[greedy]") {
+  Graph g(6);
+  g.add_edge(0, 1, 0.5);
+  g.add_edge(1, 2, 0.5);
+  g.add_edge(3, 5, 0.5);
+  g.add_edge(4, 5, 0.5);
+
+  DiffusionSubmodular serial(g, DiffusionType::IndependentCascade, 1000);
+  serial.seed(3);
+  auto threads = GENERATE(1, 3, 4);
+  ThreadPool pool(threads);
+  DiffusionSubmodular parallel(g, DiffusionType::IndependentCascade, 1000,
+                               &pool);
+  parallel.seed(3);
+  for (const auto& origin : {std::vector{0}, std::vector{0, 3}}) {
+    auto value = serial(origin);
+    CAPTURE(threads, origin);
+    REQUIRE(parallel(origin) == value);
+    REQUIRE(value > static_cast<double>(origin.size()));
+  }
+}
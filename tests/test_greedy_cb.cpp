@@ -50,3 +50,86 @@ TEST_CASE("Confidence-based CELF on a simple graph", "[greedy]") {
     REQUIRE_THAT(celf_result, UnorderedRangeEquals({0, 3, 4}));
   }
 }
+
+TEST_CASE("Confidence-based Greedy with alternative best-arm algorithms",
+          "[greedy]") {
+  Graph g(6);
+  g.add_edge(0, 1, 0.5);
+  g.add_edge(1, 2, 0.5);
+  g.add_edge(3, 5, 0.5);
+  g.add_edge(4, 5, 0.5);
+
+  SECTION("LUCB") {
+    auto gcb = GreedyCBDiffusion(g, DiffusionType::IndependentCascade, 3, 0.03,
+                                 0.01, greedy_cb<DiffusionReward, LUCBPolicy>);
+    auto result = gcb.run(1);
+    CAPTURE(gcb.samples());
+    REQUIRE_THAT(result, UnorderedRangeEquals({0, 3, 4}));
+  }
+
+  SECTION("Cost-aware UCB") {
+    auto gcb =
+        GreedyCBDiffusion(g, DiffusionType::IndependentCascade, 3, 0.03, 0.01,
+                          greedy_cb<DiffusionReward, CostAwareUCBPolicy>);
+    auto result = gcb.run(1);
+    CAPTURE(gcb.samples());
+    REQUIRE_THAT(result, UnorderedRangeEquals({0, 3, 4}));
+  }
+
+  SECTION("Shared-world UCB") {
+    auto gcb =
+        GreedyCBDiffusion(g, DiffusionType::IndependentCascade, 3, 0.03, 0.01,
+                          greedy_cb<DiffusionReward, SharedWorldUCBPolicy>);
+    auto result = gcb.run(1);
+    CAPTURE(gcb.samples());
+    REQUIRE_THAT(result, UnorderedRangeEquals({0, 3, 4}));
+  }
+
+  SECTION("Successive elimination") {
+    auto gcb =
+        GreedyCBDiffusion(g, DiffusionType::IndependentCascade, 3, 0.03, 0.01,
+                          greedy_cb<DiffusionReward, EliminationPolicy>);
+    auto result = gcb.run(1);
+    CAPTURE(gcb.samples());
+    REQUIRE_THAT(result, UnorderedRangeEquals({0, 3, 4}));
+  }
+
+  SECTION("Lazy forward with LUCB") {
+    auto celf_cb =
+        GreedyCBDiffusion(g, DiffusionType::IndependentCascade, 3, 0.03, 0.01,
+                          greedy_cb_lazy<DiffusionReward, LUCBPolicy>);
+    auto result = celf_cb.run(2);
+    CAPTURE(celf_cb.samples());
+    REQUIRE_THAT(result, UnorderedRangeEquals({0, 3, 4}));
+  }
+}
+
+TEST_CASE("Confidence-based Greedy selecting seeds in batches", "[greedy]") {
+  Graph g(11);
+  for (int v : {1, 2, 3, 4}) {
+    g.add_edge(0, v, 1.0);
+  }
+  for (int v : {6, 7, 8}) {
+    g.add_edge(5, v, 1.0);
+  }
+  g.add_edge(9, 10, 1.0);
+
+  SECTION("LUCB") {
+    auto batched = GreedyCBBatch<LUCBPolicy>{2};
+    auto gcb = GreedyCBDiffusion(g, DiffusionType::IndependentCascade, 3, 0.1,
+                                 0.01, batched);
+    auto result = gcb.run(1);
+    CAPTURE(gcb.samples());
+    REQUIRE_THAT(result, UnorderedRangeEquals({0, 5, 9}));
+    REQUIRE(gcb.used_samples().size() == 3);
+  }
+
+  SECTION("Successive elimination") {
+    auto batched = GreedyCBBatch<EliminationPolicy>{2};
+    auto gcb = GreedyCBDiffusion(g, DiffusionType::IndependentCascade, 3, 0.1,
+                                 0.01, batched);
+    auto result = gcb.run(1);
+    CAPTURE(gcb.samples());
+    REQUIRE_THAT(result, UnorderedRangeEquals({0, 5, 9}));
+  }
+}
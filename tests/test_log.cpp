@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <cstdio>
+#include <format>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "log.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+
+// Lines logged by fn, in the order written
+template <typename Fn>
+auto captured_lines(Fn fn) -> std::vector<std::string> {
+  auto* file = std::tmpfile();
+  im::set_log_output(file);
+  fn();
+  im::flush_log();
+  im::set_log_output(stdout);
+
+  std::vector<std::string> lines;
+  std::rewind(file);
+  char buffer[256];
+  while (std::fgets(buffer, sizeof(buffer), file) != nullptr) {
+    std::string line = buffer;
+    if (!line.empty() && line.back() == '\n') {
+      line.pop_back();
+    }
+    lines.push_back(line);
+  }
+  std::fclose(file);
+  return lines;
+}
+
+auto count(const std::vector<std::string>& lines, const std::string& line)
+    -> size_t {
+  return std::ranges::count(lines, line);
+}
+
+}  // namespace
+
+TEST_CASE("Log levels", "[log]") {
+  static_assert(im::min_log_level == static_cast<LogLevel>(IM_LOG_LEVEL));
+  REQUIRE(im::parse_log_level("debug") == LogLevel::Debug);
+  REQUIRE(im::parse_log_level("error") == LogLevel::Error);
+  REQUIRE_FALSE(im::parse_log_level("verbose"));
+
+  auto lines = captured_lines([] {
+    LogIdentity identity("levels");
+    log_warn("kept {}", 1);
+    im::set_log_level(LogLevel::Error);
+    log_warn("dropped {}", 2);
+    log_error("kept {}", 3);
+    im::set_log_level(LogLevel::Trace);
+  });
+  REQUIRE(count(lines, "levels: kept 1") == 1);
+  REQUIRE(count(lines, "levels: dropped 2") == 0);
+  REQUIRE(count(lines, "levels: kept 3") == 1);
+}
+
+TEST_CASE("Log identities follow runs into the pool", "[log]") {
+  ThreadPool pool(4);
+  auto lines = captured_lines([&] {
+    log_warn("anonymous");
+    LogIdentity outer("run 1");
+    {
+      LogIdentity inner("run 2");
+      pool.parallel_for(100, [](size_t, size_t i) { log_warn("i = {}", i); });
+    }
+    log_warn("back");
+  });
+  REQUIRE(count(lines, "log: anonymous") == 1);
+  for (size_t i = 0; i < 100; i++) {
+    REQUIRE(count(lines, std::format("run 2: i = {}", i)) == 1);
+  }
+  REQUIRE(count(lines, "run 1: back") == 1);
+}
+
+TEST_CASE("Lines of each thread keep their order", "[log]") {
+  constexpr int threads = 4;
+  constexpr int per_thread = 500;  // fits in a ring, so nothing is dropped
+  auto lines = captured_lines([] {
+    std::vector<std::jthread> writers;
+    for (int t = 0; t < threads; t++) {
+      writers.emplace_back([t] {
+        LogIdentity identity(std::format("writer {}", t));
+        for (int i = 0; i < per_thread; i++) {
+          log_warn("{}", i);
+        }
+      });
+    }
+  });
+
+  REQUIRE(lines.size() == threads * per_thread);
+  std::vector<int> next(threads, 0);
+  for (const auto& line : lines) {
+    auto t = line[7] - '0';
+    REQUIRE(line == std::format("writer {}: {}", t, next[t]));
+    next[t]++;
+  }
+}
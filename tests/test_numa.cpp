@@ -0,0 +1,59 @@
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "graph.hpp"
+#include "numa.hpp"
+
+TEST_CASE("CPU lists", "[numa]") {
+  REQUIRE(im::parse_cpu_list("0-3,8,10-11\n").value() ==
+          std::vector<int>{0, 1, 2, 3, 8, 10, 11});
+  REQUIRE(im::parse_cpu_list("").value().empty());
+  REQUIRE_FALSE(im::parse_cpu_list("0-x"));
+
+  auto topology = NumaTopology::detect();
+  REQUIRE_FALSE(topology.nodes.empty());
+  for (const auto& node : topology.nodes) {
+    REQUIRE_FALSE(node.cpus.empty());
+  }
+}
+
+TEST_CASE("Threads pinned to a node read its replica", "[numa]") {
+  Graph g(3);
+  g.add_edge(0, 1, 0.5);
+  g.add_edge(1, 2, 0.25);
+
+  // two nodes on the first CPU of this machine
+  auto machine = NumaTopology::detect();
+  NumaNode first{machine.nodes[0].id, {machine.nodes[0].cpus[0]}};
+  NumaTopology topology{{first, first}};
+
+  // unpinned threads and single-node topologies read the original
+  REQUIRE(&im::numa_local(g) == &g);
+  {
+    GraphReplicas replicas(g, NumaTopology{{first}});
+    REQUIRE(replicas.replicas.empty());
+  }
+
+  GraphReplicas replicas(g, topology);
+  REQUIRE(replicas.replicas.size() == 2);
+  std::vector<const Graph*> seen(2);
+  std::vector<const Graph*> through_replica(2);
+  std::vector<bool> pinned(2);
+  for (size_t node = 0; node < 2; node++) {
+    std::jthread([&, node] {
+      pinned[node] = im::pin_to_node(topology, node).has_value();
+      seen[node] = &im::numa_local(g);
+      // as when a run started on the other node passes its replica down
+      through_replica[node] = &im::numa_local(*replicas.replicas[1 - node]);
+    }).join();
+  }
+  REQUIRE(pinned == std::vector<bool>{true, true});
+  REQUIRE(seen[0] == replicas.replicas[0].get());
+  REQUIRE(seen[1] == replicas.replicas[1].get());
+  REQUIRE(through_replica == seen);
+  REQUIRE(seen[1]->get_edges() == g.get_edges());
+  REQUIRE(&im::numa_local(g) == &g);
+  REQUIRE_FALSE(im::pin_to_node(topology, 2));
+}
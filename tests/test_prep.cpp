@@ -0,0 +1,116 @@
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "graph.hpp"
+#include "prep.hpp"
+
+namespace {
+
+auto prepare(const std::string& text,
+             IdMap& ids,
+             PrepOptions options = {}) -> im::PreparedGraph {
+  std::istringstream is(text);
+  auto prepared = im::prepare_graph(is, ids, options);
+  REQUIRE(prepared);
+  return *std::move(prepared);
+}
+
+using Edges = std::vector<std::tuple<int, int, weight_t>>;
+
+}  // namespace
+
+TEST_CASE("Raw edge lists are remapped and cleaned", "[prep]") {
+  auto text =
+      "# FromNodeId\tToNodeId\n"
+      "1000000000000 7 0.5\n"
+      "7\t1000000000000 0.25\n"
+      "% another comment\n"
+      "\n"
+      "7 42 0.5\n"
+      "7 42 0.5\n"  // parallel: 1 - 0.5 * 0.5
+      "42 42 0.5\n"  // self-loop
+      "42 7 0\n";  // zero probability
+  IdMap ids;
+  auto [g, stats] = prepare(text, ids);
+  REQUIRE(ids.original == std::vector<std::uint64_t>{1000000000000, 7, 42});
+  REQUIRE(g.n == 3);
+  REQUIRE(g.get_edges() == Edges{{0, 1, 0.5}, {1, 0, 0.25}, {1, 2, 0.75}});
+  REQUIRE(stats.lines == 6);
+  REQUIRE(stats.self_loops == 1);
+  REQUIRE(stats.merged == 1);
+  REQUIRE(stats.zero == 1);
+
+  std::istringstream missing("1 2\n");
+  REQUIRE_FALSE(im::prepare_graph(missing, ids, {}));
+  std::istringstream out_of_range("1 2 1.5\n");
+  REQUIRE_FALSE(im::prepare_graph(out_of_range, ids, {}));
+  std::istringstream negative_id("-1 2 0.5\n");
+  REQUIRE_FALSE(im::prepare_graph(negative_id, ids, {}));
+}
+
+TEST_CASE("Weight models of prepared graphs", "[prep]") {
+  auto text = "10 30\n20 30\n10 20\n20 10\n10 30\n";
+  IdMap ids;
+  PrepOptions options;
+
+  options.weights = PrepWeights::WeightedCascade;
+  // 30 (id 1) has two in-edges once the parallel ones are merged
+  REQUIRE(prepare(text, ids, options).graph.get_edges() ==
+          Edges{{0, 1, 0.5}, {0, 2, 1}, {2, 0, 1}, {2, 1, 0.5}});
+
+  options.weights = PrepWeights::Uniform;
+  options.probability = 0.2;
+  for (const auto& [u, v, w] : prepare(text, ids, options).graph.get_edges()) {
+    REQUIRE(w == 0.2);
+  }
+
+  options.weights = PrepWeights::Trivalency;
+  for (const auto& [u, v, w] : prepare(text, ids, options).graph.get_edges()) {
+    REQUIRE((w == 0.1 || w == 0.01 || w == 0.001));
+  }
+
+  // the input's probabilities, summing to 1 into every vertex
+  options.weights = PrepWeights::LinearThreshold;
+  auto lt = prepare("1 3 0.125\n2 3 0.375\n1 2 0.5\n", ids, options).graph;
+  REQUIRE(lt.get_edges() == Edges{{3, 4, 0.25}, {3, 5, 1}, {5, 4, 0.75}});
+
+  options.weights = PrepWeights::Input;
+  options.undirected = true;
+  auto both = prepare("1 2 0.5\n", ids, options).graph;
+  REQUIRE(both.get_edges() == Edges{{3, 5, 0.5}, {5, 3, 0.5}});
+
+  options.undirected = false;
+  options.exponent = 0.5;
+  auto root = prepare("1 2 0.25\n", ids, options).graph;
+  REQUIRE(root.get_edges() == Edges{{3, 5, 0.5}});
+
+  // LT scales the raised probabilities, still summing to 1
+  options.weights = PrepWeights::LinearThreshold;
+  auto raised = prepare("1 3 0.0625\n2 3 0.5625\n", ids, options).graph;
+  REQUIRE(raised.get_edges() == Edges{{3, 4, 0.25}, {5, 4, 0.75}});
+}
+
+TEST_CASE("Id maps keep dense ids across files", "[prep]") {
+  IdMap ids;
+  std::ignore = prepare("5 9 0.5\n9 3 0.5\n", ids);
+  std::ostringstream saved;
+  im::write_id_map(saved, ids);
+  REQUIRE(saved.str() == "5\n9\n3\n");
+
+  std::istringstream is(saved.str());
+  auto loaded = im::parse_id_map(is);
+  REQUIRE(loaded);
+  // the same vertices, listed in another order, with a new one
+  auto g = prepare("3 8 0.5\n9 3 0.1\n", *loaded).graph;
+  REQUIRE(loaded->original == std::vector<std::uint64_t>{5, 9, 3, 8});
+  REQUIRE(g.get_edges() == Edges{{1, 2, 0.1}, {2, 3, 0.5}});
+
+  std::istringstream repeated("5\n9\n5\n");
+  REQUIRE_FALSE(im::parse_id_map(repeated));
+}
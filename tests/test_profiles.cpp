@@ -0,0 +1,180 @@
+#include <format>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "diffusion.hpp"
+#include "evaluate.hpp"
+#include "generate.hpp"
+#include "graph.hpp"
+#include "profiles.hpp"
+#include "thread_pool.hpp"
+
+using Catch::Matchers::WithinAbs;
+
+namespace {
+
+// The content of a graph file with g's edges, the weights scaled
+auto graph_text(const Graph& g, double scale) -> std::string {
+  auto text = std::format("{} {}\n", g.n, g.m);
+  for (int u = 0; u < g.n; u++) {
+    for (const auto& e : g[u]) {
+      text += std::format("{} {} {}\n", u, e.to, e.weight * scale);
+    }
+  }
+  return text;
+}
+
+auto generated() -> Graph {
+  GeneratorOptions options;
+  options.model = GraphModel::PowerLaw;
+  options.n = 2000;
+  options.m = 20'000;
+  WeightOptions weight_options;
+  weight_options.model = WeightModel::WeightedCascade;
+  return im::generate_graph(options, weight_options);
+}
+
+}  // namespace
+
+TEST_CASE("Profiles share one topology", "[profiles]") {
+  std::vector<std::pair<std::string, std::string>> sources{
+      {"a", "3 3\n0 1 0.5\n0 2 0.25\n1 2 1\n"},
+      // the edges of different sources may interleave
+      {"b", "3 3\n1 2 0.5\n0 1 0.125\n0 2 0\n"},
+  };
+  auto g = im::load_profile_graph(sources);
+  REQUIRE(g);
+  REQUIRE(g->profiles() == 2);
+  REQUIRE(g->find("b") == 1);
+  REQUIRE_FALSE(g->find("c"));
+  REQUIRE(g->weights == std::vector<weight_t>{0.5, 0.125, 0.25, 0, 1, 0.5});
+  REQUIRE(g->weight(2, 1) == 0.5);
+  REQUIRE(g->graph.get_edges() ==
+          std::vector<std::tuple<int, int, weight_t>>{
+              {0, 1, 0.5}, {0, 2, 0.25}, {1, 2, 1}});
+
+  g->use(1);
+  REQUIRE(g->graph.get_edges() ==
+          std::vector<std::tuple<int, int, weight_t>>{
+              {0, 1, 0.125}, {0, 2, 0}, {1, 2, 0.5}});
+  std::vector<Edge> edges;
+  for (const auto& e : g->profile(0)[0]) {
+    edges.push_back(e);
+  }
+  REQUIRE(edges == std::vector<Edge>{{1, 0.5}, {2, 0.25}});
+
+  auto load = [&](std::string second) {
+    sources[1].second = std::move(second);
+    return im::load_profile_graph(sources);
+  };
+  REQUIRE_FALSE(load("3 2\n0 1 0.5\n0 2 0.25\n"));
+  REQUIRE_FALSE(load("3 3\n0 2 0.5\n0 1 0.25\n1 2 1\n"));
+  REQUIRE_FALSE(load("3 3\n0 1 0.5\n0 2 0.25\n0 2 1\n"));
+  sources[1].first = "a";
+  REQUIRE_FALSE(load("3 3\n0 1 0.5\n0 2 0.25\n1 2 1\n"));
+}
+
+TEST_CASE("Diffusion under one profile", "[profiles]") {
+  auto g = generated();
+  std::vector<std::pair<std::string, std::string>> sources{
+      {"full", graph_text(g, 1)}, {"half", graph_text(g, 0.5)}};
+  auto profiles = *im::load_profile_graph(sources);
+  auto half = im::load_graph(sources[1].second);
+
+  // the view reads the same probabilities as the graph, whichever profile
+  // is in use
+  auto half_view = profiles.profile(1);
+  BasicDiffusionSolver view(half_view, 3);
+  DiffusionSolver plain(half, 3);
+  for (int origin = 0; origin < 200; origin++) {
+    for (auto type : {DiffusionType::IndependentCascade,
+                      DiffusionType::LinearThreshold}) {
+      REQUIRE(view.run(type, origin) == plain.run(type, origin));
+    }
+  }
+  profiles.use(1);
+  REQUIRE(profiles.graph.get_edges() == half.get_edges());
+}
+
+TEST_CASE("Cascades under all profiles at once", "[profiles]") {
+  Graph path(5);
+  for (int u = 0; u + 1 < 5; u++) {
+    path.add_edge(u, u + 1, 1.0);
+  }
+  std::vector<std::pair<std::string, std::string>> sources{
+      {"always", graph_text(path, 1)}, {"never", graph_text(path, 0)}};
+  auto profiles = *im::load_profile_graph(sources);
+  MultiProfileSolver solver(profiles, 1);
+  for (auto type : {DiffusionType::IndependentCascade,
+                    DiffusionType::LinearThreshold}) {
+    REQUIRE(solver.run(type, std::vector{1}) == std::vector<double>{4, 1});
+    REQUIRE(solver.run(type, std::vector{0, 3, 3}) ==
+            std::vector<double>{5, 2});
+  }
+  REQUIRE(solver.probes == 14);  // every edge is read once for both
+
+  // every profile's estimate matches its own diffusion
+  auto g = generated();
+  sources = {{"full", graph_text(g, 1)}, {"half", graph_text(g, 0.5)}};
+  profiles = *im::load_profile_graph(sources);
+  std::vector<int> seeds{0, 1, 2, 3, 4};
+  for (auto type : {DiffusionType::IndependentCascade,
+                    DiffusionType::LinearThreshold}) {
+    MultiProfileSolver multi(profiles, 7);
+    std::vector<RunningStats> together(2);
+    std::vector<RunningStats> apart(2);
+    for (int i = 0; i < 20'000; i++) {
+      auto sizes = multi.run(type, seeds);
+      for (size_t p = 0; p < 2; p++) {
+        together[p].add(sizes[p]);
+      }
+    }
+    for (size_t p = 0; p < 2; p++) {
+      auto view = profiles.profile(p);
+      BasicDiffusionSolver solver(view, 11);
+      for (int i = 0; i < 20'000; i++) {
+        apart[p].add(solver.run(type, seeds));
+      }
+      auto tolerance =
+          4 * (together[p].half_width() + apart[p].half_width());
+      REQUIRE_THAT(together[p].mean, WithinAbs(apart[p].mean, tolerance));
+    }
+    REQUIRE(together[1].mean < together[0].mean);
+  }
+}
+
+TEST_CASE("Evaluation under all profiles", "[profiles]") {
+  auto g = generated();
+  std::vector<std::pair<std::string, std::string>> sources{
+      {"full", graph_text(g, 1)}, {"half", graph_text(g, 0.5)}};
+  auto profiles = *im::load_profile_graph(sources);
+  std::vector<std::vector<int>> lists{{0, 1}, {5, 6, 7}};
+  ConfidenceTarget target{0.5, ConfidenceMode::Either};
+
+  auto serial = im::evaluate_profiles(profiles,
+                                      DiffusionType::IndependentCascade,
+                                      lists, 4, target, nullptr);
+  REQUIRE(serial.size() == 2);
+  for (const auto& list : serial) {
+    REQUIRE(list.size() == 2);
+    for (const auto& stats : list) {
+      REQUIRE(target.met(stats));
+    }
+  }
+  // chunks are seeded by their first world, whichever worker runs them
+  ThreadPool pool(3);
+  auto parallel = im::evaluate_profiles(profiles,
+                                        DiffusionType::IndependentCascade,
+                                        lists, 4, target, &pool);
+  for (size_t l = 0; l < lists.size(); l++) {
+    for (size_t p = 0; p < 2; p++) {
+      REQUIRE(parallel[l][p].count == serial[l][p].count);
+      REQUIRE(parallel[l][p].mean == serial[l][p].mean);
+    }
+  }
+}
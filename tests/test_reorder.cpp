@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "driver.hpp"
+#include "generate.hpp"
+#include "graph.hpp"
+#include "reorder.hpp"
+#include "results.hpp"
+
+namespace {
+
+// The largest |u - v| over all edges
+auto bandwidth(const Graph& g) -> int {
+  int width = 0;
+  for (int u = 0; u < g.n; u++) {
+    for (const auto& e : g[u]) {
+      width = std::max(width, std::abs(u - e.to));
+    }
+  }
+  return width;
+}
+
+}  // namespace
+
+TEST_CASE("Reordered graphs are the same graph", "[reorder]") {
+  GeneratorOptions options;
+  options.model = GraphModel::BarabasiAlbert;
+  options.n = 300;
+  options.m = 1200;
+  auto g = im::generate_graph(options, {});
+  auto order = GENERATE(VertexOrder::Original, VertexOrder::Degree,
+                        VertexOrder::Rcm);
+
+  auto permutation = im::vertex_order(g, order);
+  auto sorted = permutation.to_original;
+  std::ranges::sort(sorted);
+  for (int v = 0; v < g.n; v++) {
+    REQUIRE(sorted[v] == v);
+    REQUIRE(permutation.to_graph[permutation.to_original[v]] == v);
+  }
+
+  auto reordered = im::reorder_graph(g, permutation);
+  REQUIRE(reordered.n == g.n);
+  REQUIRE(reordered.m == g.m);
+  Graph back(g.n);
+  for (auto [u, v, w] : reordered.get_edges()) {
+    back.add_edge(permutation.to_original[u], permutation.to_original[v], w);
+  }
+  REQUIRE(back.get_edges() == g.get_edges());
+}
+
+TEST_CASE("Vertex orders", "[reorder]") {
+  REQUIRE(im::parse_vertex_order("rcm").value() == VertexOrder::Rcm);
+  REQUIRE_FALSE(im::parse_vertex_order("rabbit"));
+
+  // a path labelled 0, 9, 1, 8, ...: RCM makes neighbours adjacent
+  std::vector<int> labels{0, 9, 1, 8, 2, 7, 3, 6, 4, 5};
+  Graph path(10);
+  for (size_t i = 0; i + 1 < labels.size(); i++) {
+    path.add_edge(labels[i], labels[i + 1], 0.5);
+  }
+  REQUIRE(bandwidth(path) == 9);
+  auto rcm = im::reorder_graph(path, im::vertex_order(path, VertexOrder::Rcm));
+  REQUIRE(bandwidth(rcm) == 1);
+
+  // the hub of a star comes first by degree
+  Graph star(5);
+  for (int v = 0; v < 4; v++) {
+    star.add_edge(v, 4, 0.5);
+  }
+  REQUIRE(im::vertex_order(star, VertexOrder::Degree).to_original[0] == 4);
+}
+
+TEST_CASE("Results keep the input ids", "[reorder]") {
+  Graph g(4);
+  g.add_edge(0, 1, 0.5);
+  g.add_edge(3, 2, 0.5);
+  g.add_edge(3, 1, 0.5);
+  auto permutation = im::vertex_order(g, VertexOrder::Degree);
+  REQUIRE(permutation.original(permutation.graph(std::vector{3, 0})) ==
+          std::vector{3, 0});
+
+  RunOptions options;
+  options.dataset = "bandit-im-test-reorder";
+  options.permutation = std::make_shared<const VertexPermutation>(permutation);
+  auto path = std::filesystem::temp_directory_path() /
+              std::format("{}.imr", options.dataset);
+  std::filesystem::remove(path);
+  std::filesystem::remove(im::index_path(path.string()));
+  AlgoResult saved{"celf", {3, 0}, {10, 20}};
+  REQUIRE(im::append_records(path.string(),
+                             im::selection_records(1, saved, 1.0).value()));
+  auto store = ResultReader::open(path.string());
+  REQUIRE(store);
+  auto loaded = im::load_results(*store, options, 1);
+  REQUIRE(loaded.size() == 1);
+  REQUIRE(loaded[0].seeds == permutation.graph(saved.seeds));
+  std::filesystem::remove(path);
+  std::filesystem::remove(im::index_path(path.string()));
+}
@@ -0,0 +1,95 @@
+#include <cmath>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "driver.hpp"
+#include "evaluate.hpp"
+#include "report.hpp"
+#include "results.hpp"
+#include "store_helpers.hpp"
+
+namespace {
+
+// One run of alg, selected in the given time and evaluated to the given
+// influence of its two prefixes
+auto save_run(const std::string& path, int run, const std::string& alg,
+              double seconds, double first, double second) -> void {
+  AlgoResult result{alg, {1, 2}, {10, 20}};
+  REQUIRE(im::append_records(
+      path, im::selection_records(run, result, seconds, 4096).value()));
+  std::vector<RunningStats> stats{stats_of({first}), stats_of({second})};
+  REQUIRE(im::append_records(
+      path, im::evaluation_records(run, alg, stats, 1.0).value()));
+}
+
+}  // namespace
+
+TEST_CASE("Median confidence interval", "[report]") {
+  auto empty = im::median_estimate({});
+  REQUIRE(std::isnan(empty.median));
+  REQUIRE(std::isnan(empty.low));
+
+  auto one = im::median_estimate({3});
+  REQUIRE(one.median == 3);
+  REQUIRE(one.low == 3);
+  REQUIRE(one.high == 3);
+
+  REQUIRE(im::median_estimate({4, 1, 3, 2}).median == 2.5);
+
+  // ranks 9 and 22 of 30
+  std::vector<double> values;
+  for (int i = 30; i >= 1; i--) {
+    values.push_back(i);
+  }
+  auto estimate = im::median_estimate(values);
+  REQUIRE(estimate.median == 15.5);
+  REQUIRE(estimate.low == 9);
+  REQUIRE(estimate.high == 22);
+}
+
+TEST_CASE("Report per algorithm and frontier", "[report]") {
+  auto path = temporary_store("report");
+  save_run(path, 1, "celf", 4.0, 5, 9);
+  save_run(path, 2, "celf", 6.0, 5, 11);
+  save_run(path, 1, "greedy-cb", 1.0, 4, 8);
+  save_run(path, 2, "greedy-cb", 1.0, 4, 8);
+  // slower and worse than celf
+  save_run(path, 1, "greedy", 9.0, 3, 7);
+
+  auto store = ResultReader::open(path);
+  REQUIRE(store);
+  auto reports = im::summarize_results(*store);
+  REQUIRE(reports.size() == 3);
+
+  const auto& celf = reports[0];
+  REQUIRE(celf.alg == "celf");
+  REQUIRE(celf.runs == 2);
+  REQUIRE(celf.seconds.median == 5.0);
+  REQUIRE(celf.samples.median == 20);
+  REQUIRE(celf.peak_rss_mib.median == 4);
+  REQUIRE(celf.influence.size() == 2);
+  REQUIRE(celf.influence[1].count == 2);
+  REQUIRE(celf.influence[1].mean == 10.0);
+  REQUIRE(celf.influence_per_second == 2.0);
+  REQUIRE(celf.frontier);
+
+  REQUIRE(reports[1].alg == "greedy");
+  REQUIRE_FALSE(reports[1].frontier);
+  REQUIRE(reports[2].alg == "greedy-cb");
+  REQUIRE(reports[2].frontier);
+
+  std::ostringstream csv;
+  im::write_report_csv(csv, reports);
+  REQUIRE(csv.str().find("\ncelf,2,2,2,10,") != std::string::npos);
+
+  std::ostringstream json;
+  im::write_report_json(json, reports);
+  REQUIRE(json.str().find("\"alg\":\"greedy-cb\"") != std::string::npos);
+  REQUIRE(json.str().find("\"frontier\":false") != std::string::npos);
+  std::filesystem::remove(path);
+  std::filesystem::remove(im::index_path(path));
+}
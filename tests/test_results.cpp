@@ -0,0 +1,203 @@
+#include <atomic>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "driver.hpp"
+#include "evaluate.hpp"
+#include "results.hpp"
+#include "store_helpers.hpp"
+
+TEST_CASE("Results store round trip", "[results]") {
+  auto path = temporary_store("round-trip");
+  AlgoResult celf{"celf", {4, 0, 7}, {100, 150, 180}};
+  AlgoResult cb{"greedy-cb", {4, 7}, {30, 42}};
+
+  auto records = im::selection_records(1, celf, 2.5, 2048).value();
+  auto more = im::selection_records(1, cb, 0.5).value();
+  records.insert(records.end(), more.begin(), more.end());
+  REQUIRE(im::append_records(path, records));
+  std::vector<RunningStats> stats{stats_of({2, 4}), stats_of({5, 5}),
+                                  stats_of({6, 8})};
+  REQUIRE(im::append_records(
+      path, im::evaluation_records(1, "celf", stats, 1.0).value()));
+
+  auto store = ResultReader::open(path);
+  REQUIRE(store);
+  REQUIRE(store->record_count == 8);
+
+  auto loaded = store->selection(1, "celf");
+  REQUIRE(loaded);
+  REQUIRE(loaded->alg == "celf");
+  REQUIRE(loaded->seeds == celf.seeds);
+  REQUIRE(loaded->used_samples == celf.used_samples);
+  REQUIRE(store->selection(1, "greedy-cb")->seeds == cb.seeds);
+  REQUIRE_FALSE(store->selection(2, "celf"));
+  REQUIRE_FALSE(store->selection(1, "greedy"));
+  auto cost = store->selection_cost(1, "celf");
+  REQUIRE(cost);
+  REQUIRE(cost->seconds == 2.5);
+  REQUIRE(cost->samples == 180);
+  REQUIRE(cost->peak_rss_kib == 2048);
+
+  auto evaluation = store->evaluation(1, "celf");
+  REQUIRE(evaluation);
+  REQUIRE(evaluation->size() == 3);
+  REQUIRE((*evaluation)[0].mean == 3);
+  REQUIRE((*evaluation)[1].half_width == 0);
+  REQUIRE((*evaluation)[2].worlds == 2);
+  REQUIRE_FALSE(store->evaluation(1, "greedy-cb"));
+
+  std::ostringstream csv;
+  store->write_csv(csv);
+  REQUIRE(csv.str() ==
+          "run,alg,step,vertex,used_samples,select_seconds,eval_mean,"
+          "eval_half_width,eval_worlds,eval_seconds,select_peak_rss_kib\n"
+          "1,celf,1,4,100,2.5,3,1.96,2,1,2048\n"
+          "1,celf,2,0,150,2.5,5,0,2,1,2048\n"
+          "1,celf,3,7,180,2.5,7,1.96,2,1,2048\n"
+          "1,greedy-cb,1,4,30,0.5,,,,,\n"
+          "1,greedy-cb,2,7,42,0.5,,,,,\n");
+
+  std::filesystem::remove(path);
+  std::filesystem::remove(im::index_path(path));
+}
+
+TEST_CASE("Results store keeps the last append and skips torn records",
+          "[results]") {
+  auto path = temporary_store("recovery");
+  AlgoResult first{"celf", {1, 2}, {10, 20}};
+  AlgoResult second{"celf", {3, 4}, {30, 40}};
+  REQUIRE(
+      im::append_records(path, im::selection_records(5, first, 0).value()));
+  REQUIRE(
+      im::append_records(path, im::selection_records(5, second, 0).value()));
+  REQUIRE(ResultReader::open(path)->selection(5, "celf")->seeds ==
+          second.seeds);
+
+  // a writer that died halfway through a record
+  {
+    std::ofstream f(path, std::ios::binary | std::ios::app);
+    f << "partial";
+  }
+  auto store = ResultReader::open(path);
+  REQUIRE(store);
+  REQUIRE(store->record_count == 4);
+
+  // the next append cuts it off
+  REQUIRE(
+      im::append_records(path, im::selection_records(6, first, 0).value()));
+  REQUIRE(std::filesystem::file_size(path) ==
+          sizeof(im::ResultHeader) + 6 * sizeof(ResultRecord));
+  REQUIRE(ResultReader::open(path)->selection(6, "celf")->seeds ==
+          first.seeds);
+
+  REQUIRE_FALSE(im::selection_records(
+      1, {std::string(40, 'x'), {1}, {1}}, 0));
+  REQUIRE_FALSE(im::selection_records(1, {"celf", {1, 2}, {1}}, 0));
+
+  std::filesystem::remove(path);
+  REQUIRE_FALSE(ResultReader::open(path));
+  {
+    std::ofstream f(path);
+    f << "1 100\n2 200\n";
+  }
+  REQUIRE_FALSE(ResultReader::open(path));
+  REQUIRE_FALSE(im::append_records(
+      path, im::selection_records(1, first, 0).value()));
+  std::filesystem::remove(path);
+  std::filesystem::remove(im::index_path(path));
+}
+
+TEST_CASE("Concurrent appends do not interleave", "[results]") {
+  auto path = temporary_store("concurrent");
+  constexpr int writers = 4;
+  constexpr int runs = 50;
+  // every append opens the file anew, so the threads contend for the lock
+  // like separate processes do
+  std::atomic<int> failures = 0;
+  std::vector<std::thread> threads;
+  for (int w = 0; w < writers; w++) {
+    threads.emplace_back([&path, &failures, w] {
+      for (int r = 0; r < runs; r++) {
+        auto run = w * runs + r;
+        AlgoResult result{"greedy-cb", {run, run + 1, run + 2}, {1, 2, 3}};
+        auto records = im::selection_records(run, result, 0).value();
+        if (!im::append_records(path, records)) {
+          failures++;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  REQUIRE(failures == 0);
+
+  auto store = ResultReader::open(path);
+  REQUIRE(store);
+  REQUIRE(store->runs().size() == writers * runs);
+  for (int run = 0; run < writers * runs; run++) {
+    REQUIRE(store->selection(run, "greedy-cb")->seeds ==
+            std::vector<int>{run, run + 1, run + 2});
+  }
+  std::filesystem::remove(path);
+  std::filesystem::remove(im::index_path(path));
+}
+
+TEST_CASE("Results store index", "[results]") {
+  auto path = temporary_store("index");
+  auto index = im::index_path(path);
+  AlgoResult celf{"celf", {1, 2, 3}, {10, 20, 30}};
+  AlgoResult cb{"greedy-cb", {4, 5}, {40, 50}};
+  for (int run = 0; run < 3; run++) {
+    REQUIRE(
+        im::append_records(path, im::selection_records(run, celf, 0).value()));
+  }
+  // one entry per run
+  REQUIRE(std::filesystem::file_size(index) ==
+          sizeof(im::IndexHeader) + 3 * sizeof(IndexEntry));
+
+  // a store appended to without its index, e.g. by an older version
+  std::filesystem::remove(index);
+  REQUIRE(
+      im::append_records(path, im::selection_records(3, cb, 0).value()));
+  REQUIRE(std::filesystem::file_size(index) ==
+          sizeof(im::IndexHeader) + 4 * sizeof(IndexEntry));
+
+  // a writer that died after the records and before the index
+  auto before = std::filesystem::file_size(index);
+  {
+    std::ofstream f(path, std::ios::binary | std::ios::app);
+    auto records = im::selection_records(4, cb, 0).value();
+    f.write(reinterpret_cast<const char*>(records.data()),
+            static_cast<std::streamsize>(records.size() * sizeof(ResultRecord)));
+  }
+  auto store = ResultReader::open(path);
+  REQUIRE(store);
+  REQUIRE(std::filesystem::file_size(index) == before);
+  REQUIRE(store->runs().size() == 5);
+  REQUIRE(store->selection(0, "celf")->seeds == celf.seeds);
+  REQUIRE(store->selection(3, "greedy-cb")->seeds == cb.seeds);
+  REQUIRE(store->selection(4, "greedy-cb")->seeds == cb.seeds);
+
+  // the next append indexes them too, and a torn entry is cut off
+  {
+    std::ofstream f(index, std::ios::binary | std::ios::app);
+    f << "torn";
+  }
+  REQUIRE(
+      im::append_records(path, im::selection_records(5, cb, 0).value()));
+  REQUIRE(std::filesystem::file_size(index) ==
+          sizeof(im::IndexHeader) + 6 * sizeof(IndexEntry));
+  REQUIRE(ResultReader::open(path)->runs().size() == 6);
+
+  std::filesystem::remove(path);
+  std::filesystem::remove(index);
+}
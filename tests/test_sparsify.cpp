@@ -0,0 +1,75 @@
+#include <tuple>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "graph.hpp"
+#include "sparsify.hpp"
+#include "thread_pool.hpp"
+
+using Catch::Matchers::WithinAbs;
+
+namespace {
+
+// 0 reaches a star through an uncertain edge, and a leaf through a likelier
+// one
+auto star() -> Graph {
+  Graph g(7);
+  g.add_edge(0, 1, 0.5);
+  g.add_edge(0, 6, 0.6);
+  for (int v = 2; v <= 5; v++) {
+    g.add_edge(1, v, 1);
+  }
+  return g;
+}
+
+using Edges = std::vector<std::tuple<int, int, weight_t>>;
+
+}  // namespace
+
+TEST_CASE("Sparsification keeps the edges influence depends on",
+          "[sparsify]") {
+  auto g = star();
+  SparsifyOptions options;
+  options.edges = 5;
+
+  // sigma(1) = 5 and sigma(6) = 1, exactly as the cascades are certain
+  auto contribution = im::sparsify_graph(g, options, nullptr);
+  REQUIRE(contribution.graph.get_edges() ==
+          Edges{{0, 1, 0.5}, {1, 2, 1}, {1, 3, 1}, {1, 4, 1}, {1, 5, 1}});
+  REQUIRE(contribution.influence[1] == 5);
+  REQUIRE_THAT(contribution.error_bound, WithinAbs(0.6, 1e-12));
+
+  options.method = SparsifyMethod::Probability;
+  auto probability = im::sparsify_graph(g, options, nullptr);
+  REQUIRE(probability.graph.get_edges() ==
+          Edges{{0, 6, 0.6}, {1, 2, 1}, {1, 3, 1}, {1, 4, 1}, {1, 5, 1}});
+  REQUIRE_THAT(probability.error_bound, WithinAbs(2.5, 1e-12));
+
+  options.edges = 100;
+  auto all = im::sparsify_graph(g, options, nullptr);
+  REQUIRE(all.graph.get_edges() == g.get_edges());
+  REQUIRE(all.error_bound == 0);
+}
+
+TEST_CASE("Sparsification does not depend on the pool", "[sparsify]") {
+  Graph g(50);
+  for (int u = 0; u < 50; u++) {
+    for (int d = 1; d <= 4; d++) {
+      g.add_edge(u, (u * 7 + d * 3) % 50, 0.1 * d);
+    }
+  }
+  SparsifyOptions options;
+  options.edges = 120;
+  auto alone = im::sparsify_graph(g, options, nullptr);
+  ThreadPool pool(4);
+  auto pooled = im::sparsify_graph(g, options, &pool);
+  REQUIRE(pooled.graph.get_edges() == alone.graph.get_edges());
+  REQUIRE(pooled.error_bound == alone.error_bound);
+  REQUIRE(alone.graph.m == 120);
+  REQUIRE(alone.error_bound > 0);
+
+  options.type = DiffusionType::LinearThreshold;
+  REQUIRE(im::sparsify_graph(g, options, &pool).graph.m == 120);
+}
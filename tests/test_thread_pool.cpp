@@ -0,0 +1,140 @@
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "cbgreedy.hpp"
+#include "diffusion.hpp"
+#include "graph.hpp"
+#include "thread_pool.hpp"
+
+TEST_CASE("ThreadPool runs every index once", "[thread_pool]") {
+  auto threads = GENERATE(1, 2, 4);
+  ThreadPool pool(threads);
+  REQUIRE(pool.size() == static_cast<size_t>(threads));
+
+  for (size_t n : {0, 1, 7, 1000}) {
+    std::vector<std::atomic<int>> hits(n);
+    std::atomic<bool> worker_in_range = true;
+    pool.parallel_for(n, [&](size_t worker, size_t i) {
+      if (worker >= pool.size()) {
+        worker_in_range = false;
+      }
+      hits[i]++;
+    });
+    REQUIRE(worker_in_range);
+    for (auto& hit : hits) {
+      REQUIRE(hit == 1);
+    }
+  }
+}
+
+TEST_CASE("ThreadPool rethrows exceptions", "[thread_pool]") {
+  ThreadPool pool(3);
+  REQUIRE_THROWS_AS(pool.parallel_for(100,
+                                      [](size_t, size_t i) {
+                                        if (i == 42) {
+                                          throw std::runtime_error("42");
+                                        }
+                                      }),
+                    std::runtime_error);
+  size_t count = 0;
+  pool.parallel_for(1, [&](size_t, size_t) { count++; });
+  REQUIRE(count == 1);
+}
+
+TEST_CASE("ThreadPool loops and task groups nest", "[thread_pool]") {
+  auto threads = GENERATE(1, 2, 4);
+  ThreadPool pool(threads);
+
+  // a worker never runs two iterations of the outer loop at once
+  std::vector<std::atomic<int>> busy(pool.size());
+  std::vector<std::atomic<int>> hits(20 * 30);
+  std::atomic<bool> exclusive = true;
+  pool.parallel_for(20, [&](size_t worker, size_t i) {
+    if (busy[worker]++ != 0) {
+      exclusive = false;
+    }
+    pool.parallel_for(30, [&](size_t, size_t j) { hits[30 * i + j]++; });
+    busy[worker]--;
+  });
+  REQUIRE(exclusive);
+  for (auto& hit : hits) {
+    REQUIRE(hit == 1);
+  }
+
+  // fork/join recursion
+  auto fib = [&](auto& self, int k) -> long {
+    if (k < 2) {
+      return k;
+    }
+    long a = 0;
+    TaskGroup group(pool);
+    group.spawn([&](size_t) { a = self(self, k - 1); });
+    auto b = self(self, k - 2);
+    group.wait();
+    return a + b;
+  };
+  REQUIRE(fib(fib, 18) == 2584);
+
+  TaskGroup failing(pool);
+  failing.spawn([](size_t) { throw std::runtime_error("spawned"); });
+  REQUIRE_THROWS_AS(failing.wait(), std::runtime_error);
+}
+
+TEST_CASE("Worker-local slots", "[thread_pool]") {
+  ThreadPool pool(4);
+  int made = 0;
+  WorkerLocal<std::vector<size_t>> seen(&pool, [&] {
+    made++;
+    return std::vector<size_t>{};
+  });
+  REQUIRE(seen.slots.size() == 4);
+  std::mutex mutex;
+  pool.parallel_for(1000, [&](size_t worker, size_t i) {
+    std::vector<size_t>* slot = nullptr;
+    {
+      std::scoped_lock lock(mutex);  // make() is not thread-safe
+      slot = &seen[worker];
+    }
+    slot->push_back(i);
+  });
+  size_t total = 0;
+  seen.for_each([&](const std::vector<size_t>& s) { total += s.size(); });
+  REQUIRE(total == 1000);
+  REQUIRE(made >= 1);
+  REQUIRE(made <= 4);
+}
+
+TEST_CASE("Bulk pulls do not depend on the number of workers",
+          "[thread_pool]") {
+  Graph g(8);
+  for (int u = 0; u < 7; u++) {
+    g.add_edge(u, u + 1, 0.5);
+    g.add_edge(u + 1, u, 0.3);
+  }
+  std::vector<int> arms{0, 2, 3, 5, 7};
+
+  // no pool pulls one arm after another on the calling thread
+  auto pull = [&](size_t threads) {
+    auto pool = threads == 0 ? nullptr : std::make_unique<ThreadPool>(threads);
+    DiffusionSolver solver(g, 7);
+    DiffusionReward reward(solver, DiffusionType::IndependentCascade, {4},
+                           pool.get());
+    std::vector<double> rewards(arms.size()), costs(arms.size());
+    reward.pull_many(arms, rewards, costs);
+    REQUIRE(reward.samples == arms.size());
+    for (auto cost : costs) {
+      REQUIRE(cost >= 1);
+    }
+    return rewards;
+  };
+  auto serial = pull(0);
+  REQUIRE(pull(1) == serial);
+  REQUIRE(pull(2) == serial);
+  REQUIRE(pull(4) == serial);
+}
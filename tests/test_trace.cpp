@@ -0,0 +1,58 @@
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "thread_pool.hpp"
+#include "trace.hpp"
+
+namespace {
+
+auto occurrences(const std::string& text, const std::string& pattern)
+    -> size_t {
+  size_t count = 0;
+  for (auto pos = text.find(pattern); pos != std::string::npos;
+       pos = text.find(pattern, pos + 1)) {
+    count++;
+  }
+  return count;
+}
+
+}  // namespace
+
+TEST_CASE("Spans of all threads are written as Chrome trace events",
+          "[trace]") {
+  {
+    TraceSpan before("untraced span");  // tracing is still off
+  }
+  im::start_tracing();
+  REQUIRE(im::tracing());
+
+  ThreadPool pool(4);
+  pool.parallel_for(100, [](size_t, size_t i) {
+    TraceSpan span("traced span", "i", static_cast<std::int64_t>(i));
+  });
+
+  auto path = (std::filesystem::temp_directory_path() / "im_test.trace.json")
+                  .string();
+  REQUIRE(im::write_trace(path));
+  std::ifstream file(path);
+  std::stringstream content;
+  content << file.rdbuf();
+  auto trace = content.str();
+  std::filesystem::remove(path);
+
+  REQUIRE(trace.starts_with("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+  REQUIRE(trace.ends_with("]}\n"));
+  REQUIRE(occurrences(trace, "untraced span") == 0);
+  REQUIRE(occurrences(trace, "\"name\":\"traced span\",\"ph\":\"X\"") == 100);
+  for (int i = 0; i < 100; i++) {
+    REQUIRE(occurrences(trace, std::format("\"args\":{{\"i\":{}}}}}", i)) ==
+            1);
+  }
+  REQUIRE(occurrences(trace, "\"name\":\"parallel_for\"") >= 1);
+}
@@ -0,0 +1,72 @@
+#include <functional>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "diffusion.hpp"
+#include "evaluate.hpp"
+#include "graph.hpp"
+#include "thread_pool.hpp"
+#include "utility.hpp"
+
+using Catch::Matchers::WithinAbs;
+
+namespace {
+
+auto path_graph() -> Graph {
+  Graph g(6);
+  for (int u = 0; u < 5; u++) {
+    g.add_edge(u, u + 1, 0.5);
+  }
+  return g;
+}
+
+}  // namespace
+
+TEST_CASE("Parallel repeat keeps the index order", "[utility]") {
+  auto threads = GENERATE(1, 3, 8);
+  ThreadPool pool(threads);
+  for (size_t n : {0, 1, 5, 100}) {
+    auto results = repeat(
+        pool, n, [](size_t block) { return block; },
+        [](size_t&, size_t i) { return 2 * i; });
+    REQUIRE(results.size() == n);
+    for (size_t i = 0; i < n; i++) {
+      REQUIRE(results[i] == 2 * i);
+    }
+  }
+  auto sum = repeat_reduce(
+      pool, 100, [](size_t) { return 0; },
+      [](int&, size_t i) { return static_cast<int>(i); }, 0, std::plus{});
+  REQUIRE(sum == 4950);
+}
+
+TEST_CASE("Parallel repeat_avg with a solver per worker", "[utility]") {
+  auto g = path_graph();
+  auto threads = GENERATE(1, 4);
+  ThreadPool pool(threads);
+  auto make_solver = [&](size_t block) { return DiffusionSolver(g, block); };
+  auto cascade = [](DiffusionSolver& solver) {
+    return solver.run_independent_cascade({4});
+  };
+
+  auto average = repeat_avg(pool, 20000, make_solver, cascade);
+  REQUIRE_THAT(average, WithinAbs(1.50, 0.03));
+  // the same seed and number of workers give the same result
+  REQUIRE(repeat_avg(pool, 20000, make_solver, cascade) == average);
+
+  auto stats = repeat_reduce(
+      pool, 20000, make_solver, cascade, RunningStats{},
+      [](RunningStats acc, double size) {
+        acc.add(size);
+        return acc;
+      },
+      [](RunningStats acc, const RunningStats& block) {
+        acc.merge(block);
+        return acc;
+      });
+  REQUIRE(stats.count == 20000);
+  REQUIRE_THAT(stats.mean, WithinAbs(average, 1e-9));
+}
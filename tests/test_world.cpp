@@ -0,0 +1,95 @@
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+using Catch::Matchers::WithinAbs;
+
+#include "diffusion.hpp"
+#include "graph.hpp"
+#include "rng.hpp"
+#include "world.hpp"
+
+namespace {
+
+auto gains_of(LiveEdgeWorld& world,
+              RNG& rng,
+              DiffusionType type,
+              std::vector<int> fixed,
+              std::vector<int> arms) -> std::vector<double> {
+  std::vector<double> gains(arms.size());
+  world.sample(rng, type, fixed);
+  world.gains(arms, gains);
+  return gains;
+}
+
+}  // namespace
+
+TEST_CASE("Live-edge worlds of deterministic graphs", "[world]") {
+  // a cycle 0 -> 1 -> 2 -> 0 feeding the path 3 -> 4 -> 5, and 6 alone
+  Graph g(7);
+  g.add_edge(0, 1, 1.0);
+  g.add_edge(1, 2, 1.0);
+  g.add_edge(2, 0, 1.0);
+  g.add_edge(2, 3, 1.0);
+  g.add_edge(3, 4, 1.0);
+  g.add_edge(4, 5, 1.0);
+
+  RNG rng(1);
+  LiveEdgeWorld world(g);
+  std::vector<int> arms{0, 1, 2, 3, 4, 5, 6};
+
+  SECTION("Independent cascade") {
+    auto type = DiffusionType::IndependentCascade;
+    REQUIRE(gains_of(world, rng, type, {}, arms) ==
+            std::vector<double>{6, 6, 6, 3, 2, 1, 1});
+    REQUIRE(gains_of(world, rng, type, {4}, arms) ==
+            std::vector<double>{4, 4, 4, 1, 0, 0, 1});
+    REQUIRE(gains_of(world, rng, type, {1, 6}, arms) ==
+            std::vector<double>{0, 0, 0, 0, 0, 0, 0});
+  }
+
+  SECTION("Linear threshold") {
+    auto type = DiffusionType::LinearThreshold;
+    REQUIRE(gains_of(world, rng, type, {}, arms) ==
+            std::vector<double>{6, 6, 6, 3, 2, 1, 1});
+    REQUIRE(gains_of(world, rng, type, {3}, arms) ==
+            std::vector<double>{3, 3, 3, 0, 0, 0, 1});
+  }
+}
+
+TEST_CASE("Live-edge worlds match simulated cascades on average", "[world]") {
+  Graph g(6);
+  g.add_edge(0, 1, 0.5);
+  g.add_edge(1, 2, 0.5);
+  g.add_edge(2, 0, 0.4);
+  g.add_edge(2, 3, 0.3);
+  g.add_edge(3, 4, 0.7);
+  g.add_edge(5, 3, 0.6);
+  g.add_edge(4, 5, 0.2);
+  std::vector<int> arms{0, 1, 2, 3, 4, 5};
+  std::vector<int> fixed{4};
+  const int repeats = 100000;
+
+  for (auto type :
+       {DiffusionType::IndependentCascade, DiffusionType::LinearThreshold}) {
+    RNG rng(2);
+    LiveEdgeWorld world(g);
+    DiffusionSolver solver(g, 3);
+    std::vector<double> world_mean(arms.size(), 0.0);
+    std::vector<double> cascade_mean(arms.size(), 0.0);
+    std::vector<double> gains(arms.size());
+    for (int r = 0; r < repeats; r++) {
+      world.sample(rng, type, fixed);
+      world.gains(arms, gains);
+      for (size_t k = 0; k < arms.size(); k++) {
+        world_mean[k] += gains[k] / repeats;
+        cascade_mean[k] += solver.run(type, arms[k], fixed) / repeats;
+      }
+    }
+    for (size_t k = 0; k < arms.size(); k++) {
+      CAPTURE(type, arms[k]);
+      REQUIRE_THAT(world_mean[k], WithinAbs(cascade_mean[k], 0.03));
+    }
+  }
+}